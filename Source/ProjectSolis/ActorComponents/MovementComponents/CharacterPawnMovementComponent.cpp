@@ -2,9 +2,21 @@
 
 
 #include "CharacterPawnMovementComponent.h"
+#include "KinematicPawnStats.h"
+#include "../../Subsystems/MovementSubsystems/CharacterPawnMovementSubsystem.h"
+#include "../../Subsystems/MovementSubsystems/CharacterPawnMovementAsyncCallback.h"
+#include "../../Subsystems/MovementSubsystems/GroundHeightGridSubsystem.h"
 #include "../../Libraries/CollisionLibrary.h"
 #include "../../Libraries/MathUtilityLibrary.h"
+#include "../../DataAssets/MovementDataAssets/CharacterPawnMovementSettings.h"
 #include "Components/SkeletalMeshComponent.h"
+#include "Components/SceneComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/Paths.h"
+#include "SignificanceManager.h"
+#include "../../Actors/Pawns/CharacterPawn.h"
 
 void UCharacterPawnMovementComponent::SetUpdatedComponent(UPrimitiveComponent* Component)
 {
@@ -14,37 +26,71 @@ void UCharacterPawnMovementComponent::SetUpdatedComponent(UPrimitiveComponent* C
 void UCharacterPawnMovementComponent::SetRootMotionMesh(USkeletalMeshComponent* Component)
 {
 	RootMotionMesh = Component;
+	MontageRootMotionSampler.Reset();
 	if (!IsValid(RootMotionMesh))
 	{
 		RootMotionMovementParams = {};
 	}
 }
 
+void UCharacterPawnMovementComponent::SetInterpolatedComponent(USceneComponent* Component)
+{
+	InterpolatedComponent = Component;
+}
+
 void UCharacterPawnMovementComponent::Jump()
 {
 	// Only valid in walking movement mode.
-	if (MovementMode != EKPCMovementMode::Walking)
+	if (HotState->MovementMode != EKPCMovementMode::Walking)
+	{
+		return;
+	}
+
+	if (IsRecording())
+	{
+		PendingRecordingEvents.Add({ EKPCMovementRecordEventType::Jump, 0.0f });
+	}
+
+	WakeUp();
+
+	// Whether the pawn is grounded is decided by the physics thread when it applies the jump.
+	if (bAsyncPhysicsTickActive)
 	{
+		PendingAsyncEvents.bJump = true;
 		return;
 	}
 
+	// Send the jump to the server with the next move.
+	if ((!bReplayingSavedMoves) && (ShouldUseNetworkPrediction()) && (GetOwnerRole() == ROLE_AutonomousProxy))
+	{
+		bPendingJump = true;
+	}
+
 	// Apply jump force if grounded.
-	if (DetermineIfGrounded(UpdatedComponent->GetCollisionShape(), UpdatedComponent->GetComponentLocation(), UpdatedComponent->GetComponentQuat()))
+	if (DetermineIfGrounded(UpdatedComponent->GetCollisionShape(), GetUpdatedComponentLocation(), GetUpdatedComponentQuat()))
 	{
-		ApplyVerticalForceWalking(JumpZForce);
+		ApplyVerticalForceWalking(Settings->JumpZForce);
 	}
 }
 
 void UCharacterPawnMovementComponent::AddMovementInput(const FVector& Direction, float Scale)
 {
-	switch (MovementMode)
+	switch (HotState->MovementMode)
 	{
 	case EKPCMovementMode::Walking:
-		MovementInputScale = Scale;
+		// Movement input is owned by the physics thread when using the async physics tick and is sent with the next input instead.
+		if (bAsyncPhysicsTickActive)
+		{
+			AsyncInputScale = Scale;
+			AsyncInputDirection = FVector(Direction.X, Direction.Y, 0.0).GetSafeNormal();
+			break;
+		}
+
+		HotState->InputScale = Scale;
 
-		MovementInputDirection = Direction;
-		MovementInputDirection.Z = 0.0;
-		MovementInputDirection.Normalize();
+		HotState->InputDirection = Direction;
+		HotState->InputDirection.Z = 0.0;
+		HotState->InputDirection.Normalize();
 
 		break;
 	}
@@ -52,846 +98,2723 @@ void UCharacterPawnMovementComponent::AddMovementInput(const FVector& Direction,
 
 bool UCharacterPawnMovementComponent::IsGrounded() const
 {
-	return ((MovementMode == EKPCMovementMode::Walking) &&
-		(DetermineIfGrounded(UpdatedComponent->GetCollisionShape(), UpdatedComponent->GetComponentLocation(), UpdatedComponent->GetComponentQuat())));
+	if (bAsyncPhysicsTickActive)
+	{
+		return bAsyncGrounded;
+	}
+
+	return ((HotState->MovementMode == EKPCMovementMode::Walking) &&
+		(DetermineIfGrounded(UpdatedComponent->GetCollisionShape(), GetUpdatedComponentLocation(), GetUpdatedComponentQuat())));
 }
 
 UCharacterPawnMovementComponent::UCharacterPawnMovementComponent()
 {
 	PrimaryComponentTick.bCanEverTick = true;
 	SetTickGroup(ETickingGroup::TG_PostPhysics);
+	SetIsReplicatedByDefault(true);
 }
 
-void UCharacterPawnMovementComponent::BeginPlay()
+void UCharacterPawnMovementComponent::OnRegister()
 {
-	Super::BeginPlay();
-
-	// Gather references.
-	World = GetWorld();
+	Super::OnRegister();
 
-	// Tick this component's owning actor after this component. The pawn this component is controlling ticks after the component meaning that on the pawn tick its updated component's 
-	// movement for the current frame will have aleady been updated.
-	GetOwner()->AddTickPrerequisiteComponent(this);
-
-	// Tick the owning pawn's controller before this component.
-	APawn* Pawn = CastChecked<APawn>(GetOwner());
-	AddTickPrerequisiteActor(Pawn->GetController());
+	ResolveMovementSettings();
 
-	// Create movement collision query params that will ensure movement traces ignore the pawn actor.
-	MovementCollisionQueryParams = FCollisionQueryParams(NAME_None, MovementTraceComplex, Pawn);
+	HitResultScratch.Reserve(HitResultScratchReserve);
+	OverlapResultScratch.Reserve(OverlapResultScratchReserve);
+}
 
-	// Initialize movement input direction.
-	MovementInputDirection = UpdatedComponent->GetForwardVector();
+void UCharacterPawnMovementComponent::ResolveMovementSettings()
+{
+	Settings = (MovementSettings != nullptr) ? MovementSettings.Get() : GetDefault<UCharacterPawnMovementSettings>();
+	WalkableFloorZ = Settings->WalkableFloorZ;
 }
 
-void UCharacterPawnMovementComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+void UCharacterPawnMovementComponent::BeginPlay()
 {
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	Super::BeginPlay();
 
-	//UE_LOG(LogTemp, Warning, TEXT("Kinematic pawn controller component tick."));
+	// Gather references.
+	World = GetWorld();
 
-	// Consume root motion data if a root motion mesh has been set. This removes root motion data from the root motion mesh for the current frame.
-	if (IsValid(RootMotionMesh))
+	APawn* Pawn = CastChecked<APawn>(GetOwner());
+
+	// Networked components are ticked individually as each network role ticks differently.
+	UCharacterPawnMovementSubsystem* MovementSubsystem = (((bUseBatchedMovementTick) || (bUseAsyncPhysicsTick)) && (!ShouldUseNetworkPrediction())) ?
+		World->GetSubsystem<UCharacterPawnMovementSubsystem>() : nullptr;
+	if ((bUseAsyncPhysicsTick) && (IsValid(MovementSubsystem)) && (MovementSubsystem->CanUseAsyncPhysicsTick()))
 	{
-		RootMotionMovementParams = RootMotionMesh->ConsumeRootMotion();
-		if (UAnimInstance* RootMotionAnimInstance = RootMotionMesh->GetAnimInstance())
+		// Hand the simulation over to the physics thread. Tick the owning actor after the movement subsystem has applied the latest results and send the input
+		// added by the owning pawn's controller with the same frame's input.
+		SetComponentTickEnabled(false);
+		MovementSubsystem->RegisterAsyncComponent(this);
+		GetOwner()->PrimaryActorTick.AddPrerequisite(MovementSubsystem, MovementSubsystem->GetAsyncTickFunction());
+		if (AController* Controller = Pawn->GetController())
 		{
-			bIsAnimMontagePlaying = RootMotionAnimInstance->IsAnyMontagePlaying();
+			MovementSubsystem->GetAsyncTickFunction().AddPrerequisite(Controller, Controller->PrimaryActorTick);
 		}
 	}
-
-	// Update the pawn's rotation.
-	UpdatePawnRotation(DeltaTime);
-
-	FCollisionShape MovementCollisionShape = UpdatedComponent->GetCollisionShape();
-	FQuat MovementCollisionRotation = UpdatedComponent->GetComponentQuat();
-
-	// Move the pawn out of collision as moving geometry may have moved into the pawn.
-	MoveOutOfCollision(UpdatedComponent->GetComponentLocation(), MovementCollisionRotation, MovementCollisionShape);
-
-	// Tick the component for the current movement mode.
-	switch (MovementMode)
+	else if ((bUseBatchedMovementTick) && (IsValid(MovementSubsystem)))
 	{
-	case EKPCMovementMode::Walking: TickMovementModeWalking(DeltaTime, UpdatedComponent->GetComponentLocation(), MovementCollisionShape, MovementCollisionRotation); break;
+		// Hand ticking over to the movement subsystem. Tick the owning actor after the batch tick so the updated component has already been moved when the pawn ticks.
+		SetComponentTickEnabled(false);
+		MovementSubsystem->RegisterComponent(this);
+		GetOwner()->PrimaryActorTick.AddPrerequisite(MovementSubsystem, MovementSubsystem->GetBatchTickFunction());
 	}
+	else
+	{
+		// Tick this component's owning actor after this component. The pawn this component is controlling ticks after the component meaning that on the pawn tick its updated component's 
+		// movement for the current frame will have aleady been updated.
+		GetOwner()->AddTickPrerequisiteComponent(this);
 
-	// Remove added movement input.
-	ClearMovementInput();
-}
+		// Tick the owning pawn's controller before this component.
+		AddTickPrerequisiteActor(Pawn->GetController());
+	}
 
-void UCharacterPawnMovementComponent::TickMovementModeWalking(float DeltaTime, const FVector& MovementCollisionLocation, const FCollisionShape& MovementCollisionShape,
-	const FQuat& MovementCollisionRotation)
-{
-	UpdateComponentAttachment(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation);
-	UpdateHorizontalMovementWalking(DeltaTime, MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation);
-	UpdateVerticalMovementWalking(DeltaTime, MovementCollisionShape, UpdatedComponent->GetComponentLocation(), MovementCollisionRotation);
-}
+	// Use the baked ground height grid if one exists for the map and was traced on the movement trace channel. The grid's tiles are mapped and unmapped on the game
+	// thread while the physics thread simulates, so pawns using the async physics tick never read it.
+	if ((bUseGroundHeightGrid) && (!bAsyncPhysicsTickActive))
+	{
+		const UGroundHeightGridSubsystem* GroundHeightGridSubsystem = World->GetSubsystem<UGroundHeightGridSubsystem>();
+		GroundHeightGrid = ((IsValid(GroundHeightGridSubsystem)) && (GroundHeightGridSubsystem->HasGrid())) ? GroundHeightGridSubsystem : nullptr;
+		if ((GroundHeightGrid != nullptr) && (GroundHeightGrid->GetCollisionChannel() != Settings->MovementTraceChannel))
+		{
+			UE_LOG(LogKinematicPawn, Warning, TEXT("%s: The ground height grid was baked on a different channel to the movement trace channel and will not be used."), *GetNameSafe(GetOwner()));
+			GroundHeightGrid = nullptr;
+		}
+	}
 
-void UCharacterPawnMovementComponent::UpdateHorizontalMovementWalking(float Time, const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation,
-	const FQuat& MovementCollisionRotation)
-{
-	const bool bGroundedBeforeMove = DetermineIfGrounded(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation);
-	const bool bIsRequestingMovement = IsRequestingMovement();
+	// Create movement collision query params that will ensure movement traces ignore the pawn actor.
+	MovementCollisionQueryParams = FCollisionQueryParams(NAME_None, Settings->MovementTraceComplex, Pawn);
 
-	FVector HorizontalDisplacement(0.0);
+	// Initialize movement input direction.
+	HotState->InputDirection = UpdatedComponent->GetForwardVector();
 
-	// If root motion is present for this frame apply translation delta from root bone as displacement for this frame.
-	if (HasRootMotion())
+	// Allocate the saved move ring buffer.
+	if ((ShouldUseNetworkPrediction()) && (GetOwnerRole() == ROLE_AutonomousProxy))
 	{
-		FVector Translation = RootMotionMovementParams.GetRootMotionTransform().GetTranslation();
-		Translation.Z = 0.0; // Remove vertical translation.
-		HorizontalDisplacement = MovementCollisionRotation.GetForwardVector() * Translation.Length();
+		SavedMoves.SetNum(MaxSavedMoves);
+	}
 
-		// Calculate initial velocity for the next frame.
-		InitialHorizontalVelocityWalking = HorizontalDisplacement / static_cast<double>(Time);
+	// Initialize interpolation state. Capture the interpolated component's offset after construction scripts and blueprint defaults have been applied.
+	PreviousSimulatedLocation = UpdatedComponent->GetComponentLocation();
+	PreviousSimulatedRotation = UpdatedComponent->GetComponentQuat();
+	InterpolatedLocation = PreviousSimulatedLocation;
+	InterpolatedRotation = PreviousSimulatedRotation;
+	if (IsValid(InterpolatedComponent))
+	{
+		InterpolatedComponentRelativeTransform = InterpolatedComponent->GetRelativeTransform();
 	}
-	else
+
+	// Listen for anything that moves the pawn or overlaps it while it is asleep.
+	if ((bAllowSleep) && (!bAsyncPhysicsTickActive))
 	{
-		// Calculate acceleration for this frame.
-		FVector Acceleration(0.0);
-		FVector Friction(0.0);
+		UpdatedComponent->TransformUpdated.AddUObject(this, &UCharacterPawnMovementComponent::OnUpdatedComponentTransformUpdated);
+		UpdatedComponent->OnComponentBeginOverlap.AddDynamic(this, &UCharacterPawnMovementComponent::OnUpdatedComponentBeginOverlap);
+	}
 
-		// If requesting movement ensure that the movement input scale is large enough to accelerate up to MinAnalogWalkSpeed.
-		if (bIsRequestingMovement)
+	// Register with the significance manager to have the movement LOD updated from the local player's view.
+	if ((bUseMovementLOD) && (!bAsyncPhysicsTickActive))
+	{
+		if (USignificanceManager* SignificanceManager = FSignificanceManagerModule::Get(World))
 		{
-			MovementInputScale = FMath::Max(static_cast<double>(MinAnalogWalkSpeed / MaxWalkSpeed), MovementInputScale);
+			SignificanceManager->RegisterObject(this, TEXT("CharacterPawnMovement"),
+				[](USignificanceManager::FManagedObjectInfo* ObjectInfo, const FTransform& ViewTransform) -> float
+				{
+					// The significance manager keeps the highest significance across every view.
+					return CastChecked<UCharacterPawnMovementComponent>(ObjectInfo->GetObject())->CalculateSignificance(ViewTransform);
+				},
+				USignificanceManager::EPostSignificanceType::Sequential,
+				[](USignificanceManager::FManagedObjectInfo* ObjectInfo, float OldSignificance, float Significance, bool bFinal)
+				{
+					CastChecked<UCharacterPawnMovementComponent>(ObjectInfo->GetObject())->SetMovementLOD(
+						static_cast<EKPCMovementLOD>(2 - FMath::Clamp(FMath::RoundToInt32(Significance), 0, 2)));
+				});
 		}
+	}
+}
 
-		if (bGroundedBeforeMove)
+void UCharacterPawnMovementComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if ((bUseBatchedMovementTick) || (bAsyncPhysicsTickActive))
+	{
+		if (UCharacterPawnMovementSubsystem* MovementSubsystem = World->GetSubsystem<UCharacterPawnMovementSubsystem>())
 		{
-			// On ground so calculate friction in the opposite direction to the current direction the pawn is moving.
-			Friction = -InitialHorizontalVelocityWalking * static_cast<double>(FrictionCoefficient * GroundFriction);
-
-			// If not requesting movement and velocity is greater than zero then only apply braking force.
-			if ((!bIsRequestingMovement) && (InitialHorizontalVelocityWalking.Length() > 0.0))
+			if (bAsyncPhysicsTickActive)
 			{
-				FVector Braking = -InitialHorizontalVelocityWalking.GetSafeNormal() * static_cast<double>(BrakingDecelerationRate);
-
-				Acceleration += Braking;
-
-				if (!bApplySeperateBrakingForce)
-				{
-					Acceleration += Friction;
-				}
-
-				// Stop reversing when backwards acceleration overtakes remaining forward velocity. Take the dot product between new displacement and the current velocity and if the
-				// result is below or equal to zero, the pawn will be moving backwards so remove all acceleration and current velocity.
-				if (FVector::DotProduct(((InitialHorizontalVelocityWalking * static_cast<double>(Time)) + (0.5 * Acceleration * static_cast<double>(FMath::Square(Time)))).GetSafeNormal(),
-					InitialHorizontalVelocityWalking.GetSafeNormal()) <= 0.0)
-				{
-					Acceleration = FVector::ZeroVector;
-					InitialHorizontalVelocityWalking = FVector::ZeroVector;
-				}
+				MovementSubsystem->UnregisterAsyncComponent(this);
 			}
 			else
 			{
-				// Calculate total acceleration as the sum of movement and friction accelerations.
-				Acceleration = ((MovementInputDirection * static_cast<double>(MaxAccelerationRate * MovementInputScale)) + Friction);
+				MovementSubsystem->UnregisterComponent(this);
 			}
 		}
-		else
+	}
+
+	if ((bUseMovementLOD) && (!bAsyncPhysicsTickActive))
+	{
+		if (USignificanceManager* SignificanceManager = FSignificanceManagerModule::Get(World))
 		{
-			// In air so apply no friction and scale movement force by air control factor.
-			Acceleration = (MovementInputDirection * static_cast<double>(MaxAccelerationRate * MovementInputScale * AirControl));
+			SignificanceManager->UnregisterObject(this);
 		}
+	}
 
-		// Calculate final velocity for this frame.
-		FVector FinalHorizontalVelocity = (InitialHorizontalVelocityWalking + (Acceleration * static_cast<double>(Time)));
+	if ((bAllowSleep) && (IsValid(UpdatedComponent)))
+	{
+		UpdatedComponent->TransformUpdated.RemoveAll(this);
+		UpdatedComponent->OnComponentBeginOverlap.RemoveDynamic(this, &UCharacterPawnMovementComponent::OnUpdatedComponentBeginOverlap);
+	}
 
-		// If the final velocity length is greater than the max walk speed limit the acceleration to only be able to reach a length of max walk speed and recalculate final 
-		// horizontal velocity.
-		if (FinalHorizontalVelocity.Length() > static_cast<double>(MaxWalkSpeed))
-		{
-			const FVector DesiredVelocity = FinalHorizontalVelocity.GetSafeNormal() * static_cast<double>(MaxWalkSpeed);
-			Acceleration = (DesiredVelocity - InitialHorizontalVelocityWalking) / static_cast<double>(Time);
-			FinalHorizontalVelocity = (InitialHorizontalVelocityWalking + (Acceleration * static_cast<double>(Time)));
-		}
+	Super::EndPlay(EndPlayReason);
+}
 
-		// Calculate displacement for this frame.
-		HorizontalDisplacement = ((FinalHorizontalVelocity + InitialHorizontalVelocityWalking) * 0.5) * static_cast<double>(Time);
+void UCharacterPawnMovementComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
-		// Set initial velocity for next frame as final velocity on this frame.
-		InitialHorizontalVelocityWalking = FinalHorizontalVelocity;
+	//UE_LOG(LogTemp, Warning, TEXT("Kinematic pawn controller component tick."));
+
+	if (!ShouldUseNetworkPrediction())
+	{
+		TickMovement(DeltaTime);
+		return;
 	}
 
-	// Apply displacement for this frame.
-	MoveAndSlideHorizontalWalking(HorizontalDisplacement, MovementCollisionLocation, MovementCollisionRotation, MovementCollisionShape);
+	switch (GetOwnerRole())
+	{
+	case ROLE_AutonomousProxy:
+		TickAutonomousProxy(DeltaTime);
+		break;
 
-	// Try to snap down to ground surface if the pawn was grounded at the start of this movement and the move has moved the pawn into an ungrounded state.
-	if (bGroundedBeforeMove)
+	case ROLE_Authority:
 	{
-		FVector NewComponentLocation = UpdatedComponent->GetComponentLocation();
-		if (!DetermineIfGrounded(MovementCollisionShape, NewComponentLocation, MovementCollisionRotation))
+		// Pawns controlled by a remote player are simulated when their moves arrive in ServerMoveBatch.
+		const APawn* Pawn = CastChecked<APawn>(GetOwner());
+		if ((Pawn->IsLocallyControlled()) || (!Pawn->IsPlayerControlled()))
 		{
-			// Detect if walking off of a ledge. Don't step down if the pawn is walking off of a ledge.
-			FHitResult Hit = {};
-			FVector LedgeTraceStart = UCollisionLibrary::GetLowestPointOnShape(MovementCollisionShape, NewComponentLocation, MovementCollisionRotation, FVector::UpVector);
-			FVector LedgeTraceDelta = FVector(0.0, 0.0, -static_cast<double>(LedgeSearchDistance));
-			bool bFoundLedge = !World->LineTraceSingleByChannel(Hit, LedgeTraceStart, LedgeTraceStart + LedgeTraceDelta, MovementTraceChannel, MovementCollisionQueryParams);
-
-			if (!bFoundLedge)
-			{
-				SnapDownToSurface(MaxStepHeight, NewComponentLocation, MovementCollisionRotation, MovementCollisionShape);
-			}
+			TickMovement(DeltaTime);
 		}
+		break;
+	}
+
+	default:
+		// Simulated proxies follow the server's replicated movement.
+		break;
 	}
 }
 
-void UCharacterPawnMovementComponent::UpdateVerticalMovementWalking(float Time, const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation,
-	const FQuat& MovementCollisionRotation)
+#if WITH_EDITOR
+void UCharacterPawnMovementComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
 {
-	// Vertical root motion is not applied in walking mode.
+	Super::PostEditChangeProperty(PropertyChangedEvent);
 
-	// Calculate acceleration for this frame.
-	FVector VerticalAcceleration = FVector::ZeroVector;
-	if (!DetermineIfGrounded(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation))
+	if (PropertyChangedEvent.GetMemberPropertyName() == GET_MEMBER_NAME_CHECKED(UCharacterPawnMovementComponent, MovementSettings))
 	{
-		VerticalAcceleration += FVector::UpVector * static_cast<double>(CalculateGravity());
+		ResolveMovementSettings();
 	}
+}
+#endif
 
-	// Calculate final velocity for this frame.
-	FVector FinalVerticalVelocity = (InitialVerticalVelocityWalking + (VerticalAcceleration * static_cast<double>(Time)));
-	if (FinalVerticalVelocity.Z < 0.0)
+void UCharacterPawnMovementComponent::TickMovement(float DeltaTime)
+{
+	KPC_SCOPE_CYCLE_COUNTER(STAT_KPCTickMovement, KinematicPawn_TickMovement);
+	CSV_SCOPED_TIMING_STAT(KinematicPawn, TickMovement);
+
+	const int32 NumSubsteps = BeginMovementFrame(DeltaTime);
+	for (int32 i = 0; i < NumSubsteps; ++i)
 	{
-		FinalVerticalVelocity = FinalVerticalVelocity.GetClampedToMaxSize(static_cast<double>(MaxFallSpeed));
-	}
+		BeginMovementSubstep(i);
 
-	// Calculate displacement for this frame.
-	FVector VerticalDisplacement = ((FinalVerticalVelocity + InitialVerticalVelocityWalking) * 0.5) * static_cast<double>(Time);
+		// Update the pawn's rotation.
+		UpdatePawnRotation(SubstepDeltaTime);
 
-	// Set initial velocity for next frame as final velocity on this frame.
-	InitialVerticalVelocityWalking = FinalVerticalVelocity;
+		// Move the pawn out of collision as moving geometry may have moved into the pawn.
+		ResolveInitialPenetration();
 
-	// Apply displacement for this frame.
-	MoveAndSlideVerticalWalking(VerticalDisplacement, MovementCollisionLocation, MovementCollisionRotation, MovementCollisionShape);
-}
+		// Tick the component for the current movement mode.
+		TickMovementMode(SubstepDeltaTime);
+	}
 
-float UCharacterPawnMovementComponent::CalculateGravity()
-{
-	return (GravityScale * World->GetGravityZ());
+	EndMovementFrame();
 }
 
-bool UCharacterPawnMovementComponent::DetermineIfGrounded(const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation) const
+int32 UCharacterPawnMovementComponent::BeginMovementFrame(float DeltaTime)
 {
-	FHitResult Hit = FindGroundHit(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation);
-	if ((!Hit.bBlockingHit) || (!IsWalkableSurface(Hit.ImpactNormal)))
+	NumSceneQueries = 0;
+
+	if (IsRecording())
 	{
-		return false;
+		// Simulate with the input exactly as it will be read back from the recording.
+		HotState->InputDirection = FKPCMovementRecording::QuantizeInputDirection(HotState->InputDirection);
+		HotState->InputScale = FKPCMovementRecording::QuantizeInputScale(HotState->InputScale);
+
+		RecordingFrame.DeltaTime = DeltaTime;
+		RecordingFrame.InputDirection = HotState->InputDirection;
+		RecordingFrame.InputScale = HotState->InputScale;
+		RecordingFrame.Events = MoveTemp(PendingRecordingEvents);
+		PendingRecordingEvents.Reset();
 	}
-	return Hit.bBlockingHit;
-}
-
-bool UCharacterPawnMovementComponent::StepUp(const FHitResult& CollisionHitResult, const FVector& Displacement, const FCollisionShape& MovementCollisionShape,
-	const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation)
-{
-	// Check if the collision height is below the maximum step height.
-	const double CollisionHeight = UMathUtilityLibrary::NumericalDistance(CollisionHitResult.ImpactPoint.Z,
-		UCollisionLibrary::GetLowestPointOnShape(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation, FVector::UpVector).Z);
 
-	if (CollisionHeight > MaxStepHeight)
+	// Sleeping pawns skip the frame entirely unless something has woken them.
+	if (bIsAsleep)
 	{
-		return false;
+		if (!ShouldWakeUp())
+		{
+			INC_DWORD_STAT(STAT_KPCFramesSkippedAsleep);
+			NumSubstepsThisFrame = 0;
+			return 0;
+		}
+		WakeUp();
 	}
 
-	// Is the step surface walkable?
-	if (!IsWalkableSurface(FindStepSurfaceNormalFromCollision(CollisionHitResult)))
+	// Skip frames while ticking at a reduced rate and simulate the skipped time in a single catch-up step. Movement input is kept until the catch-up step runs.
+	if (MovementLOD == EKPCMovementLOD::ReducedRate)
 	{
-		return false;
+		LODSkippedTime += DeltaTime;
+		if (LODSkippedTime < ReducedRateTickInterval)
+		{
+			INC_DWORD_STAT(STAT_KPCFramesSkippedByLOD);
+			NumSubstepsThisFrame = 0;
+			return 0;
+		}
+		DeltaTime = LODSkippedTime;
+		LODSkippedTime = 0.0f;
+	}
+	else if (LODSkippedTime > 0.0f)
+	{
+		// Time skipped before leaving the reduced rate has not been simulated yet.
+		DeltaTime += LODSkippedTime;
+		LODSkippedTime = 0.0f;
 	}
 
-	// Calculate new sweep start location having teleported the collision shape up to the collision height.
-	FVector NewStartLocation = CollisionHitResult.TraceStart + FVector(0.0, 0.0, CollisionHeight + 0.01);
+	// The movement base only moves between frames, including frames that run no substeps.
+	MovementBaseDeltaTime += DeltaTime;
 
-	// Is there a ceiling blocking the teleport up?
-	FHitResult HitResult = {};
-	if (World->SweepSingleByChannel(HitResult,
-		MovementCollisionLocation,
-		NewStartLocation,
-		MovementCollisionRotation,
-		MovementTraceChannel,
-		MovementCollisionShape,
-		MovementCollisionQueryParams))
+	switch (MovementLOD)
 	{
-		return false;
+	case EKPCMovementLOD::Full: INC_DWORD_STAT(STAT_KPCFramesLOD0); break;
+	case EKPCMovementLOD::ReducedRate: INC_DWORD_STAT(STAT_KPCFramesLOD1); break;
+	case EKPCMovementLOD::GroundSnap: INC_DWORD_STAT(STAT_KPCFramesLOD2); break;
 	}
 
-	// No ceiling blocking the teleport up.
+	if (bUseFixedTimestep)
+	{
+		// Drop time that can not be simulated within the substep limit so a hitch does not carry over into the following frames.
+		FixedTimestepAccumulator += DeltaTime;
+		NumSubstepsThisFrame = FMath::FloorToInt32(FixedTimestepAccumulator / FixedTimestep);
+		if (NumSubstepsThisFrame > MaxSubstepsPerFrame)
+		{
+			NumSubstepsThisFrame = MaxSubstepsPerFrame;
+			FixedTimestepAccumulator = FMath::Fmod(FixedTimestepAccumulator, FixedTimestep);
+		}
+		else
+		{
+			FixedTimestepAccumulator -= static_cast<float>(NumSubstepsThisFrame) * FixedTimestep;
+		}
+		SubstepDeltaTime = FixedTimestep;
+	}
+	else
+	{
+		NumSubstepsThisFrame = 1;
+		SubstepDeltaTime = DeltaTime;
+	}
 
-	// Sweep original displacement from the teleported up location.
-	HitResult.Reset();
-	if (World->SweepSingleByChannel(HitResult,
-		NewStartLocation,
-		NewStartLocation + Displacement,
-		MovementCollisionRotation,
-		MovementTraceChannel,
-		MovementCollisionShape,
-		MovementCollisionQueryParams))
+	// Leave root motion and movement input in place for the next frame if there is nothing to simulate this frame.
+	if (NumSubstepsThisFrame == 0)
 	{
-		// Is there enough step available to step on.
-		double StepDepth = (FVector(HitResult.ImpactPoint.X, HitResult.ImpactPoint.Y, 0.0) -
-			FVector(CollisionHitResult.ImpactPoint.X, CollisionHitResult.ImpactPoint.Y, 0.0)).Length();
+		return 0;
+	}
 
-		// Allow step depths below the threshold when the collision height is a small number as this is a collision with a shallow slope that the pawn should walk up.
-		if ((StepDepth >= static_cast<double>(MinStepDepth)) || (CollisionHeight < static_cast<double>(StepDepthCollisionHeightThreshold)))
+	// Track the pawn's transform internally for the duration of the frame. The updated component is only moved once when the frame ends.
+	BeginDeferredTransformUpdates();
+	FrameStartLocation = GetUpdatedComponentLocation();
+	FrameStartRotation = GetUpdatedComponentQuat();
+
+	// Consume root motion data if a root motion mesh has been set. This removes root motion data from the root motion mesh for the current frame.
+	FrameRootMotionMovementParams.Clear();
+	if (IsValid(RootMotionMesh))
+	{
+		// Root motion the mesh extracted is still consumed when sampling so it does not build up on the mesh, but it is not used.
+		FrameRootMotionMovementParams = RootMotionMesh->ConsumeRootMotion();
+		if (UAnimInstance* RootMotionAnimInstance = RootMotionMesh->GetAnimInstance())
 		{
-			FVector NewLocation = HitResult.TraceStart + PullBackMovement(HitResult.Location - HitResult.TraceStart);
-			UpdatedComponent->SetWorldLocation(NewLocation);
-			SnapDownToSurface(MaxSnapDownDistance, NewLocation, MovementCollisionRotation, MovementCollisionShape);
+			HotState->bIsAnimMontagePlaying = RootMotionAnimInstance->IsAnyMontagePlaying();
+		}
 
-			return true;
+		if (bSampleMontageRootMotion)
+		{
+			FrameRootMotionMovementParams.Clear();
+			MontageRootMotionSampler.Sync(RootMotionMesh->GetAnimInstance());
 		}
+	}
 
-		// Not enough step available so fail to step up.
+	return NumSubstepsThisFrame;
+}
 
-		return false;
-	}
+void UCharacterPawnMovementComponent::BeginMovementSubstep(int32 SubstepIndex)
+{
+	// Ground probes only live for a single substep.
+	InvalidateGroundProbeCache();
 
-	FVector NewLocation = HitResult.TraceEnd;
-	UpdatedComponent->SetWorldLocation(NewLocation);
-	SnapDownToSurface(MaxSnapDownDistance, NewLocation, MovementCollisionRotation, MovementCollisionShape);
+	// Move with the surface the pawn is standing on before anything is gathered or probed at the pawn's location.
+	ApplyMovementBaseDelta();
 
-	return true;
+	GatherCollisionNeighbourhood(SubstepDeltaTime);
+
+	// Remember where this substep started to interpolate from.
+	PreviousSimulatedLocation = GetUpdatedComponentLocation();
+	PreviousSimulatedRotation = GetUpdatedComponentQuat();
+
+	// Spread the frame's root motion translation over its substeps and apply the rotation on the first substep. Sampled root motion is extracted for each substep.
+	if (MontageRootMotionSampler.IsSampling())
+	{
+		RootMotionMovementParams.Set(MontageRootMotionSampler.Advance(SubstepDeltaTime));
+	}
+	else if (FrameRootMotionMovementParams.bHasRootMotion)
+	{
+		const FTransform& FrameRootMotionTransform = FrameRootMotionMovementParams.GetRootMotionTransform();
+		RootMotionMovementParams.Set(FTransform(((SubstepIndex == 0) ? FrameRootMotionTransform.GetRotation() : FQuat::Identity),
+			FrameRootMotionTransform.GetTranslation() / static_cast<double>(NumSubstepsThisFrame)));
+	}
+	else
+	{
+		RootMotionMovementParams.Clear();
+	}
 }
 
-void UCharacterPawnMovementComponent::SnapDownToSurface(float InMaxSnapDownDistance, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation,
-	const FCollisionShape& MovementCollisionShape)
+void UCharacterPawnMovementComponent::ResolveInitialPenetration()
 {
-	FHitResult HitResult = {};
-	if (World->SweepSingleByChannel(HitResult, MovementCollisionLocation, MovementCollisionLocation - FVector(0.0, 0.0, static_cast<double>(InMaxSnapDownDistance)),
-		MovementCollisionRotation, MovementTraceChannel, MovementCollisionShape, MovementCollisionQueryParams))
+	// Pawns at the lowest LOD do not depenetrate.
+	if (MovementLOD == EKPCMovementLOD::GroundSnap)
 	{
-		UpdatedComponent->SetWorldLocation(HitResult.TraceStart + PullBackMovement(HitResult.Location - HitResult.TraceStart));
+		return;
 	}
+
+	MoveOutOfCollision(GetUpdatedComponentLocation(), GetUpdatedComponentQuat(), GetMovementCollisionShape());
 }
 
-void UCharacterPawnMovementComponent::MoveAndSlideHorizontalWalking(const FVector& Displacement, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation,
-	const FCollisionShape& MovementCollisionShape)
+void UCharacterPawnMovementComponent::TickMovementMode(float DeltaTime)
 {
-	// Cap out at max slide iterations.
-	FVector CurrentMovementCollisionLocation = MovementCollisionLocation;
+	FCollisionShape MovementCollisionShape = GetMovementCollisionShape();
+	FQuat MovementCollisionRotation = GetUpdatedComponentQuat();
+	// Inflated once per substep instead of for every sweep.
+	InflatedMovementCollisionShape = UCollisionLibrary::InflateShape(MovementCollisionShape, Settings->SweepShapeInflationAmount);
+
+	switch (HotState->MovementMode)
+	{
+	case EKPCMovementMode::Walking:
+		if (MovementLOD == EKPCMovementLOD::GroundSnap)
+		{
+			TickMovementModeWalkingGroundSnap(DeltaTime, GetUpdatedComponentLocation(), MovementCollisionShape, MovementCollisionRotation);
+		}
+		else
+		{
+			TickMovementModeWalking(DeltaTime, GetUpdatedComponentLocation(), MovementCollisionShape, MovementCollisionRotation);
+		}
+		break;
+	}
+}
+
+float UCharacterPawnMovementComponent::CalculateSignificance(const FTransform& ViewTransform) const
+{
+	const APawn* Pawn = CastChecked<APawn>(GetOwner());
+
+	// Player controlled pawns always run the full movement algorithm.
+	EKPCMovementLOD LOD = EKPCMovementLOD::GroundSnap;
+	const double DistanceSquared = FVector::DistSquared(ViewTransform.GetLocation(), UpdatedComponent->GetComponentLocation());
+	if ((Pawn->IsPlayerControlled()) || (DistanceSquared < FMath::Square(static_cast<double>(ReducedRateDistance))))
+	{
+		LOD = EKPCMovementLOD::Full;
+	}
+	else if ((DistanceSquared < FMath::Square(static_cast<double>(GroundSnapDistance))) && (Pawn->WasRecentlyRendered(RecentlyRenderedTolerance)))
+	{
+		LOD = EKPCMovementLOD::ReducedRate;
+	}
+
+	// Higher significance for more detailed LODs.
+	return static_cast<float>(2 - static_cast<int32>(LOD));
+}
+
+void UCharacterPawnMovementComponent::SetMovementLOD(EKPCMovementLOD LOD)
+{
+	if (LOD == MovementLOD)
+	{
+		return;
+	}
+
+	// Time skipped at the reduced rate is kept when leaving it and added to the next frame at the new LOD so no movement is lost. Entering the reduced rate
+	// starts a new interval.
+	if (LOD == EKPCMovementLOD::ReducedRate)
+	{
+		LODSkippedTime = 0.0f;
+	}
+	MovementLOD = LOD;
+}
+
+void UCharacterPawnMovementComponent::EndMovementFrame()
+{
+	if (NumSubstepsThisFrame > 0)
+	{
+		// Write the working transform to the updated component.
+		CommitDeferredTransformUpdates();
+		bHasCollisionNeighbourhood = false;
+		CollisionNeighbourhood.Reset();
+		CollisionNeighbourhoodShapes.Reset();
+
+		// Check if the pawn can sleep before its movement input is cleared.
+		UpdateSleepState();
+
+		// Remove added movement input.
+		ClearMovementInput();
+	}
+
+	// Anything may move between movement frames, so ground checks made outside of the movement tick never reuse a probe made during it.
+	InvalidateGroundProbeCache();
+
+	UpdateInterpolatedTransform();
+
+	if (IsRecording())
+	{
+		RecordingFrame.Location = UpdatedComponent->GetComponentLocation();
+		RecordingFrame.Rotation = UpdatedComponent->GetComponentRotation();
+		RecordingFrame.Velocity = GetVelocity();
+		Recording->Frames.Add(MoveTemp(RecordingFrame));
+		RecordingFrame = {};
+	}
+}
+
+void UCharacterPawnMovementComponent::UpdateSleepState()
+{
+	const bool bAtRest = ((CanSleep()) &&
+		(HotState->bGrounded) &&
+		(!IsRequestingMovement()) &&
+		(!FrameRootMotionMovementParams.bHasRootMotion) &&
+		(!HotState->bIsAnimMontagePlaying) &&
+		(GetVelocity().IsNearlyZero(static_cast<double>(SleepVelocityThreshold))) &&
+		(UpdatedComponent->GetComponentLocation().Equals(FrameStartLocation, static_cast<double>(KINDA_SMALL_NUMBER))) &&
+		(UpdatedComponent->GetComponentQuat().Equals(FrameStartRotation)));
+
+	if (!bAtRest)
+	{
+		TimeAtRest = 0.0f;
+		return;
+	}
+
+	TimeAtRest += SubstepDeltaTime * static_cast<float>(NumSubstepsThisFrame);
+	if (TimeAtRest < SleepDelay)
+	{
+		return;
+	}
+
+	// Remove any remaining velocity and hold the interpolated transform at the resting transform.
+	switch (HotState->MovementMode)
+	{
+	case EKPCMovementMode::Walking:
+		HotState->HorizontalVelocity = FVector::ZeroVector;
+		HotState->VerticalVelocity = FVector::ZeroVector;
+		break;
+	}
+	FixedTimestepAccumulator = 0.0f;
+	PreviousSimulatedLocation = UpdatedComponent->GetComponentLocation();
+	PreviousSimulatedRotation = UpdatedComponent->GetComponentQuat();
+	bIsAsleep = true;
+}
+
+bool UCharacterPawnMovementComponent::CanSleep() const
+{
+	if (!bAllowSleep)
+	{
+		return false;
+	}
+
+	// Moves made by a remote player must be simulated on both the client and the server, so neither side can skip them.
+	return ((!ShouldUseNetworkPrediction()) || (!CastChecked<APawn>(GetOwner())->IsPlayerControlled()));
+}
+
+bool UCharacterPawnMovementComponent::ShouldWakeUp() const
+{
+	// Transform changes and overlaps wake the pawn as they are reported. Only check for the wake conditions that are not reported.
+	if (HotState->InputScale > 0.0f)
+	{
+		return true;
+	}
+
+	// The surface the pawn is standing on moving is not reported as the updated component moving.
+	if (const UPrimitiveComponent* Base = HotState->MovementBase.Get())
+	{
+		if (!Base->GetComponentTransform().Equals(MovementBaseTransform))
+		{
+			return true;
+		}
+	}
+
+	if (IsValid(RootMotionMesh))
+	{
+		if (const UAnimInstance* RootMotionAnimInstance = RootMotionMesh->GetAnimInstance())
+		{
+			return RootMotionAnimInstance->IsAnyMontagePlaying();
+		}
+	}
+
+	return false;
+}
+
+void UCharacterPawnMovementComponent::WakeUp()
+{
+	bIsAsleep = false;
+	TimeAtRest = 0.0f;
+}
+
+void UCharacterPawnMovementComponent::OnUpdatedComponentTransformUpdated(USceneComponent* Component, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	// The component is only moved by this component while awake, so any move while asleep was made by something else.
+	if (bIsAsleep)
+	{
+		WakeUp();
+	}
+}
+
+void UCharacterPawnMovementComponent::OnUpdatedComponentBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp,
+	int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
+	WakeUp();
+}
+
+void UCharacterPawnMovementComponent::ResetMovementState(const FVector& Location, const FQuat& Rotation, const FVector& Velocity, float FixedTimestepTime)
+{
+	// The move is sent to the physics thread with the next input as a displacement of the updated component.
+	if (bAsyncPhysicsTickActive)
+	{
+		UpdatedComponent->SetWorldLocationAndRotation(Location, Rotation);
+		PendingAsyncEvents.bHasVelocity = true;
+		PendingAsyncEvents.Velocity = Velocity;
+		return;
+	}
+
+	check(!bDeferTransformUpdates);
+
+	SetUpdatedComponentLocation(Location);
+	SetUpdatedComponentRotation(Rotation);
+
+	switch (HotState->MovementMode)
+	{
+	case EKPCMovementMode::Walking:
+		HotState->HorizontalVelocity = FVector(Velocity.X, Velocity.Y, 0.0);
+		HotState->VerticalVelocity = FVector(0.0, 0.0, Velocity.Z);
+		break;
+	}
+
+	OutOfCollisionSolver.Reset();
+	SweepDepenetrationSolver.Reset();
+
+	FixedTimestepAccumulator = FixedTimestepTime;
+	PreviousSimulatedLocation = Location;
+	PreviousSimulatedRotation = Rotation;
+	UpdateInterpolatedTransform();
+}
+
+void UCharacterPawnMovementComponent::StartRecording()
+{
+	if (bAsyncPhysicsTickActive)
+	{
+		UE_LOG(LogKinematicPawn, Warning, TEXT("Can not record the movement of %s as it uses the async physics tick."), *GetOwner()->GetName());
+		return;
+	}
+
+	Recording = MakeUnique<FKPCMovementRecording>();
+	Recording->MapPackageName = UWorld::RemovePIEPrefix(World->GetOutermost()->GetName());
+	Recording->PawnClassPath = GetOwner()->GetClass()->GetPathName();
+	Recording->InitialLocation = UpdatedComponent->GetComponentLocation();
+	Recording->InitialRotation = UpdatedComponent->GetComponentQuat();
+	Recording->InitialVelocity = GetVelocity();
+	Recording->InitialFixedTimestepAccumulator = FixedTimestepAccumulator;
+
+	RecordingFrame = {};
+	PendingRecordingEvents.Reset();
+}
+
+TUniquePtr<FKPCMovementRecording> UCharacterPawnMovementComponent::StopRecording()
+{
+	PendingRecordingEvents.Reset();
+	return MoveTemp(Recording);
+}
+
+void UCharacterPawnMovementComponent::ApplyRecordedFrameInput(const FKPCMovementRecordFrame& Frame)
+{
+	for (const FKPCMovementRecordEvent& Event : Frame.Events)
+	{
+		switch (Event.Type)
+		{
+		case EKPCMovementRecordEventType::Jump: Jump(); break;
+		case EKPCMovementRecordEventType::AddVerticalForce: AddVerticalForce(Event.Value); break;
+		}
+	}
+
+	// Set the input directly. AddMovementInput would renormalize the recorded direction.
+	HotState->InputDirection = Frame.InputDirection;
+	HotState->InputScale = Frame.InputScale;
+}
+
+void UCharacterPawnMovementComponent::UpdateInterpolatedTransform()
+{
+	const FVector SimulatedLocation = UpdatedComponent->GetComponentLocation();
+	const FQuat SimulatedRotation = UpdatedComponent->GetComponentQuat();
+
+	if (!bUseFixedTimestep)
+	{
+		InterpolatedLocation = SimulatedLocation;
+		InterpolatedRotation = SimulatedRotation;
+		return;
+	}
+
+	// Blend from the start of the last substep towards its end by the fraction of a step left in the accumulator.
+	const double Alpha = FMath::Clamp(static_cast<double>(FixedTimestepAccumulator / FixedTimestep), 0.0, 1.0);
+	InterpolatedLocation = FMath::Lerp(PreviousSimulatedLocation, SimulatedLocation, Alpha);
+	InterpolatedRotation = FQuat::Slerp(PreviousSimulatedRotation, SimulatedRotation, Alpha);
+
+	if (IsValid(InterpolatedComponent))
+	{
+		InterpolatedComponent->SetWorldTransform(InterpolatedComponentRelativeTransform * FTransform(InterpolatedRotation, InterpolatedLocation));
+	}
+}
+
+void UCharacterPawnMovementComponent::BeginAsyncPhysicsTick()
+{
+	// The working transform is owned by the physics thread from now on. It is never committed, the updated component is moved to each output instead.
+	BeginDeferredTransformUpdates();
+	bAsyncPhysicsTickActive = true;
+
+	AsyncInputDirection = UpdatedComponent->GetForwardVector();
+	AsyncBaseLocation = DeferredLocation;
+	AsyncBaseRotation = DeferredRotation;
+	AsyncPreviousLocation = DeferredLocation;
+	AsyncPreviousRotation = DeferredRotation;
+	AsyncLatestLocation = DeferredLocation;
+	AsyncLatestRotation = DeferredRotation;
+	AsyncMovementBase = HotState->MovementBase.Get();
+	AsyncMovementBaseHandle = HotState->MovementBase;
+}
+
+void UCharacterPawnMovementComponent::GatherAsyncPhysicsInput(FKPCAsyncMovementInputEntry& OutInput)
+{
+	// Consuming root motion touches the root motion mesh so must happen on the game thread.
+	bool bIsMontagePlaying = false;
+	if (IsValid(RootMotionMesh))
+	{
+		const FRootMotionMovementParams MeshRootMotion = RootMotionMesh->ConsumeRootMotion();
+		if (UAnimInstance* RootMotionAnimInstance = RootMotionMesh->GetAnimInstance())
+		{
+			bIsMontagePlaying = RootMotionAnimInstance->IsAnyMontagePlaying();
+		}
+
+		// The montage is sampled over the game thread frame and the result is sent with the frame's events.
+		if (bSampleMontageRootMotion)
+		{
+			MontageRootMotionSampler.Sync(RootMotionMesh->GetAnimInstance());
+			if (MontageRootMotionSampler.IsSampling())
+			{
+				PendingAsyncEvents.RootMotion.Accumulate(MontageRootMotionSampler.Advance(World->GetDeltaSeconds()));
+			}
+		}
+		else
+		{
+			PendingAsyncEvents.RootMotion.Accumulate(MeshRootMotion);
+		}
+	}
+
+	// Send anything that has moved the updated component since the last output was applied.
+	const FVector Location = UpdatedComponent->GetComponentLocation();
+	const FQuat Rotation = UpdatedComponent->GetComponentQuat();
+	PendingAsyncEvents.ExternalDisplacement = Location - AsyncBaseLocation;
+	PendingAsyncEvents.ExternalRotation = Rotation * AsyncBaseRotation.Inverse();
+	AsyncBaseLocation = Location;
+	AsyncBaseRotation = Rotation;
+
+	if (PendingAsyncEvents.HasEvents())
+	{
+		PendingAsyncEvents.Frame = NextAsyncEventFrame++;
+		UnacknowledgedAsyncEvents.Add(MoveTemp(PendingAsyncEvents));
+	}
+	PendingAsyncEvents = {};
+
+	OutInput.Component = this;
+	OutInput.InputDirection = AsyncInputDirection;
+	OutInput.InputScale = AsyncInputScale;
+	OutInput.bIsAnimMontagePlaying = bIsMontagePlaying;
+	OutInput.CollisionShape = UpdatedComponent->GetCollisionShape();
+	OutInput.Events = UnacknowledgedAsyncEvents;
+	GatherAsyncCollisionPrimitives(OutInput);
+
+	// Remove added movement input. The direction is kept as it is used to update the pawn rotation when there is no movement input being added.
+	AsyncInputScale = 0.0f;
+}
+
+void UCharacterPawnMovementComponent::SimulateAsyncPhysicsStep(const FKPCAsyncMovementInputEntry& Input, float DeltaTime, FKPCAsyncMovementOutputEntry& OutOutput)
+{
+	AsyncInput = &Input;
+	NumSceneQueries = 0;
+	InvalidateGroundProbeCache();
+
+	HotState->InputDirection = Input.InputDirection;
+	HotState->InputScale = Input.InputScale;
+	HotState->bIsAnimMontagePlaying = Input.bIsAnimMontagePlaying;
+
+	// Apply the events of every frame this step has not seen yet. Root motion from all of them is simulated in this step.
+	FrameRootMotionMovementParams.Clear();
+	for (const FKPCAsyncMovementEvents& Events : Input.Events)
+	{
+		if (Events.Frame <= LastAppliedAsyncEventFrame)
+		{
+			continue;
+		}
+		LastAppliedAsyncEventFrame = Events.Frame;
+
+		DeferredLocation += Events.ExternalDisplacement;
+		DeferredRotation = Events.ExternalRotation * DeferredRotation;
+		FrameRootMotionMovementParams.Accumulate(Events.RootMotion);
+
+		if (Events.bHasVelocity)
+		{
+			switch (HotState->MovementMode)
+			{
+			case EKPCMovementMode::Walking:
+				HotState->HorizontalVelocity = FVector(Events.Velocity.X, Events.Velocity.Y, 0.0);
+				HotState->VerticalVelocity = FVector(0.0, 0.0, Events.Velocity.Z);
+				break;
+			}
+		}
+
+		if ((Events.bJump) && (DetermineIfGrounded(Input.CollisionShape, DeferredLocation, DeferredRotation)))
+		{
+			ApplyVerticalForceWalking(Settings->JumpZForce);
+		}
+
+		if (Events.bHasVerticalForce)
+		{
+			ApplyVerticalForceWalking(Events.VerticalForce);
+		}
+	}
+
+	// Run the movement substep phases once with the physics step's delta time.
+	MovementBaseDeltaTime += DeltaTime;
+	NumSubstepsThisFrame = 1;
+	SubstepDeltaTime = DeltaTime;
+	BeginMovementSubstep(0);
+	UpdatePawnRotation(SubstepDeltaTime);
+	ResolveInitialPenetration();
+	TickMovementMode(SubstepDeltaTime);
+
+	bHasCollisionNeighbourhood = false;
+	CollisionNeighbourhood.Reset();
+	CollisionNeighbourhoodShapes.Reset();
+
+	OutOutput.Component = this;
+	OutOutput.Location = DeferredLocation;
+	OutOutput.Rotation = DeferredRotation;
+	OutOutput.Velocity = GetSimulatedVelocity();
+	OutOutput.bGrounded = HotState->bGrounded;
+	OutOutput.MovementBase = AsyncMovementBaseHandle;
+	OutOutput.LastAppliedEventFrame = LastAppliedAsyncEventFrame;
+
+	bHasDeferredTransform = false;
+	AsyncInput = nullptr;
+}
+
+void UCharacterPawnMovementComponent::ApplyAsyncPhysicsOutput(const FKPCAsyncMovementOutputEntry& Output, double OutputTime)
+{
+	// Stop sending events the physics thread has applied. Events are kept in frame order.
+	int32 NumAppliedEvents = 0;
+	while ((NumAppliedEvents < UnacknowledgedAsyncEvents.Num()) && (UnacknowledgedAsyncEvents[NumAppliedEvents].Frame <= Output.LastAppliedEventFrame))
+	{
+		++NumAppliedEvents;
+	}
+	UnacknowledgedAsyncEvents.RemoveAt(0, NumAppliedEvents, false);
+
+	UpdatedComponent->SetWorldLocationAndRotation(Output.Location, Output.Rotation);
+
+	AsyncBaseLocation = UpdatedComponent->GetComponentLocation();
+	AsyncBaseRotation = UpdatedComponent->GetComponentQuat();
+
+	AsyncPreviousLocation = AsyncLatestLocation;
+	AsyncPreviousRotation = AsyncLatestRotation;
+	AsyncPreviousTime = AsyncLatestTime;
+	AsyncLatestLocation = Output.Location;
+	AsyncLatestRotation = Output.Rotation;
+	AsyncLatestTime = OutputTime;
+
+	AsyncVelocity = Output.Velocity;
+	bAsyncGrounded = Output.bGrounded;
+	HotState->MovementBase = Output.MovementBase;
+}
+
+void UCharacterPawnMovementComponent::UpdateInterpolatedTransformAsync(double ResultsTime)
+{
+	// Blend between the last two outputs by how far the physics results time has reached between them. Anything that has moved the updated component since the
+	// latest output, such as a teleport, is added on top.
+	const double Interval = AsyncLatestTime - AsyncPreviousTime;
+	const double Alpha = (Interval > UE_SMALL_NUMBER) ? FMath::Clamp((ResultsTime - AsyncPreviousTime) / Interval, 0.0, 1.0) : 1.0;
+	InterpolatedLocation = FMath::Lerp(AsyncPreviousLocation, AsyncLatestLocation, Alpha) + (UpdatedComponent->GetComponentLocation() - AsyncLatestLocation);
+	InterpolatedRotation = FQuat::Slerp(AsyncPreviousRotation, AsyncLatestRotation, Alpha);
+
+	if (IsValid(InterpolatedComponent))
+	{
+		InterpolatedComponent->SetWorldTransform(InterpolatedComponentRelativeTransform * FTransform(InterpolatedRotation, InterpolatedLocation));
+	}
+}
+
+void UCharacterPawnMovementComponent::TickMovementModeWalking(float DeltaTime, const FVector& MovementCollisionLocation, const FCollisionShape& MovementCollisionShape,
+	const FQuat& MovementCollisionRotation)
+{
+	UpdateMovementBase(FindGroundHit(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation));
+	UpdateHorizontalMovementWalking(DeltaTime, MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation);
+	UpdateVerticalMovementWalking(DeltaTime, MovementCollisionShape, GetUpdatedComponentLocation(), MovementCollisionRotation);
+}
+
+void UCharacterPawnMovementComponent::UpdateHorizontalMovementWalking(float Time, const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation,
+	const FQuat& MovementCollisionRotation)
+{
+	KPC_SCOPE_CYCLE_COUNTER(STAT_KPCHorizontalMovement, KinematicPawn_HorizontalMovement);
+
+	const bool bGroundedBeforeMove = DetermineIfGrounded(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation);
+	const FVector HorizontalDisplacement = CalculateHorizontalDisplacementWalking(Time, bGroundedBeforeMove, MovementCollisionRotation);
+
+	// Apply displacement for this frame.
+	MoveAndSlideHorizontalWalking(HorizontalDisplacement, MovementCollisionLocation, MovementCollisionRotation, MovementCollisionShape);
+
+	// Try to snap down to ground surface if the pawn was grounded at the start of this movement and the move has moved the pawn into an ungrounded state.
+	if (bGroundedBeforeMove)
+	{
+		FVector NewComponentLocation = GetUpdatedComponentLocation();
+		if (!DetermineIfGrounded(MovementCollisionShape, NewComponentLocation, MovementCollisionRotation))
+		{
+			// Detect if walking off of a ledge. Don't step down if the pawn is walking off of a ledge.
+			FHitResult Hit = {};
+			FVector LedgeTraceStart = UCollisionLibrary::GetLowestPointOnShape(MovementCollisionShape, NewComponentLocation, MovementCollisionRotation, FVector::UpVector);
+			FVector LedgeTraceDelta = FVector(0.0, 0.0, -static_cast<double>(Settings->LedgeSearchDistance));
+			bool bFoundLedge = !LineTraceSingle(Hit, LedgeTraceStart, LedgeTraceStart + LedgeTraceDelta);
+
+			if (!bFoundLedge)
+			{
+				SnapDownToSurface(Settings->MaxStepHeight, NewComponentLocation, MovementCollisionRotation, MovementCollisionShape);
+			}
+		}
+	}
+}
+
+FVector UCharacterPawnMovementComponent::CalculateHorizontalDisplacementWalking(float Time, bool bGroundedBeforeMove, const FQuat& MovementCollisionRotation)
+{
+	const bool bIsRequestingMovement = IsRequestingMovement();
+
+	FVector HorizontalDisplacement(0.0);
+
+	// If root motion is present for this frame apply translation delta from root bone as displacement for this frame.
+	if (HasRootMotion())
+	{
+		FVector Translation = RootMotionMovementParams.GetRootMotionTransform().GetTranslation();
+		Translation.Z = 0.0; // Remove vertical translation.
+		HorizontalDisplacement = MovementCollisionRotation.GetForwardVector() * Translation.Length();
+
+		// Calculate initial velocity for the next frame.
+		HotState->HorizontalVelocity = HorizontalDisplacement / static_cast<double>(Time);
+	}
+	else
+	{
+		// Calculate acceleration for this frame.
+		FVector Acceleration(0.0);
+		FVector Friction(0.0);
+
+		// If requesting movement ensure that the movement input scale is large enough to accelerate up to MinAnalogWalkSpeed.
+		if (bIsRequestingMovement)
+		{
+			HotState->InputScale = FMath::Max(Settings->MinAnalogInputScale, HotState->InputScale);
+		}
+
+		if (bGroundedBeforeMove)
+		{
+			// On ground so calculate friction in the opposite direction to the current direction the pawn is moving.
+			Friction = -HotState->HorizontalVelocity * static_cast<double>(Settings->FrictionCoefficient * Settings->GroundFriction);
+
+			// If not requesting movement and velocity is greater than zero then only apply braking force.
+			if ((!bIsRequestingMovement) && (HotState->HorizontalVelocity.Length() > 0.0))
+			{
+				FVector Braking = -HotState->HorizontalVelocity.GetSafeNormal() * static_cast<double>(Settings->BrakingDecelerationRate);
+
+				Acceleration += Braking;
+
+				if (!Settings->bApplySeperateBrakingForce)
+				{
+					Acceleration += Friction;
+				}
+
+				// Stop reversing when backwards acceleration overtakes remaining forward velocity. Take the dot product between new displacement and the current velocity and if the
+				// result is below or equal to zero, the pawn will be moving backwards so remove all acceleration and current velocity.
+				if (FVector::DotProduct(((HotState->HorizontalVelocity * static_cast<double>(Time)) + (0.5 * Acceleration * static_cast<double>(FMath::Square(Time)))).GetSafeNormal(),
+					HotState->HorizontalVelocity.GetSafeNormal()) <= 0.0)
+				{
+					Acceleration = FVector::ZeroVector;
+					HotState->HorizontalVelocity = FVector::ZeroVector;
+				}
+			}
+			else
+			{
+				// Calculate total acceleration as the sum of movement and friction accelerations.
+				Acceleration = ((HotState->InputDirection * static_cast<double>(Settings->MaxAccelerationRate * HotState->InputScale)) + Friction);
+			}
+		}
+		else
+		{
+			// In air so apply no friction and scale movement force by air control factor.
+			Acceleration = (HotState->InputDirection * static_cast<double>(Settings->MaxAccelerationRate * HotState->InputScale * Settings->AirControl));
+		}
+
+		// Calculate final velocity for this frame.
+		FVector FinalHorizontalVelocity = (HotState->HorizontalVelocity + (Acceleration * static_cast<double>(Time)));
+
+		// If the final velocity length is greater than the max walk speed limit the acceleration to only be able to reach a length of max walk speed and recalculate final 
+		// horizontal velocity.
+		if (FinalHorizontalVelocity.Length() > static_cast<double>(Settings->MaxWalkSpeed))
+		{
+			const FVector DesiredVelocity = FinalHorizontalVelocity.GetSafeNormal() * static_cast<double>(Settings->MaxWalkSpeed);
+			Acceleration = (DesiredVelocity - HotState->HorizontalVelocity) / static_cast<double>(Time);
+			FinalHorizontalVelocity = (HotState->HorizontalVelocity + (Acceleration * static_cast<double>(Time)));
+		}
+
+		// Calculate displacement for this frame.
+		HorizontalDisplacement = ((FinalHorizontalVelocity + HotState->HorizontalVelocity) * 0.5) * static_cast<double>(Time);
+
+		// Set initial velocity for next frame as final velocity on this frame.
+		HotState->HorizontalVelocity = FinalHorizontalVelocity;
+	}
+
+	return HorizontalDisplacement;
+}
+
+void UCharacterPawnMovementComponent::UpdateVerticalMovementWalking(float Time, const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation,
+	const FQuat& MovementCollisionRotation)
+{
+	KPC_SCOPE_CYCLE_COUNTER(STAT_KPCVerticalMovement, KinematicPawn_VerticalMovement);
+
+	// Vertical root motion is not applied in walking mode.
+
+	// Calculate acceleration for this frame.
+	FVector VerticalAcceleration = FVector::ZeroVector;
+	const bool bGroundedBeforeMove = DetermineIfGrounded(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation);
+	if (!bGroundedBeforeMove)
+	{
+		VerticalAcceleration += FVector::UpVector * static_cast<double>(CalculateGravity());
+	}
+
+	// Calculate final velocity for this frame.
+	FVector FinalVerticalVelocity = (HotState->VerticalVelocity + (VerticalAcceleration * static_cast<double>(Time)));
+	if (FinalVerticalVelocity.Z < 0.0)
+	{
+		FinalVerticalVelocity = FinalVerticalVelocity.GetClampedToMaxSize(static_cast<double>(Settings->MaxFallSpeed));
+	}
+
+	// Calculate displacement for this frame.
+	FVector VerticalDisplacement = ((FinalVerticalVelocity + HotState->VerticalVelocity) * 0.5) * static_cast<double>(Time);
+
+	// Set initial velocity for next frame as final velocity on this frame.
+	HotState->VerticalVelocity = FinalVerticalVelocity;
+
+	// Remains grounded unless moving away from the ground. Landing during the move below also marks the pawn as grounded.
+	HotState->bGrounded = ((bGroundedBeforeMove) && (FinalVerticalVelocity.Z <= 0.0));
+
+	// Apply displacement for this frame.
+	MoveAndSlideVerticalWalking(VerticalDisplacement, MovementCollisionLocation, MovementCollisionRotation, MovementCollisionShape);
+}
+
+void UCharacterPawnMovementComponent::TickMovementModeWalkingGroundSnap(float DeltaTime, const FVector& MovementCollisionLocation, const FCollisionShape& MovementCollisionShape,
+	const FQuat& MovementCollisionRotation)
+{
+	// Use the grounded state from the last tick instead of probing for ground.
+	const FVector HorizontalDisplacement = CalculateHorizontalDisplacementWalking(DeltaTime, HotState->bGrounded, MovementCollisionRotation);
+
+	// Integrate gravity while falling.
+	FVector FinalVerticalVelocity = HotState->VerticalVelocity;
+	if (!HotState->bGrounded)
+	{
+		FinalVerticalVelocity += FVector::UpVector * static_cast<double>(CalculateGravity() * DeltaTime);
+		if (FinalVerticalVelocity.Z < 0.0)
+		{
+			FinalVerticalVelocity = FinalVerticalVelocity.GetClampedToMaxSize(static_cast<double>(Settings->MaxFallSpeed));
+		}
+	}
+	const FVector VerticalDisplacement = ((FinalVerticalVelocity + HotState->VerticalVelocity) * 0.5) * static_cast<double>(DeltaTime);
+	HotState->VerticalVelocity = FinalVerticalVelocity;
+
+	FVector NewLocation = MovementCollisionLocation + HorizontalDisplacement + VerticalDisplacement;
+
+	// Snap to the ground with a single trace down from the bottom of the shape raised by the max step height. Moving up keeps the pawn in the air.
+	bool bGrounded = false;
+	FHitResult Hit = {};
+	if (FinalVerticalVelocity.Z <= 0.0)
+	{
+		const FVector LowestPoint = UCollisionLibrary::GetLowestPointOnShape(MovementCollisionShape, NewLocation, MovementCollisionRotation, FVector::UpVector);
+		const FVector TraceStart = LowestPoint + FVector(0.0, 0.0, static_cast<double>(Settings->MaxStepHeight));
+		const double SnapDistance = (HotState->bGrounded) ? static_cast<double>(Settings->MaxStepHeight * 2.0f) : static_cast<double>(Settings->MaxStepHeight);
+
+		if ((LineTraceSingle(Hit, TraceStart, TraceStart - FVector(0.0, 0.0, SnapDistance))) && (IsWalkableSurface(Hit.ImpactNormal)))
+		{
+			NewLocation.Z += Hit.ImpactPoint.Z - LowestPoint.Z;
+			bGrounded = true;
+		}
+	}
+
+	// The snap trace doubles as the ground probe for the movement base.
+	UpdateMovementBase(Hit);
+
+	if (bGrounded)
+	{
+		HotState->VerticalVelocity = FVector::ZeroVector;
+	}
+	HotState->bGrounded = bGrounded;
+
+	SetUpdatedComponentLocation(NewLocation);
+}
+
+float UCharacterPawnMovementComponent::CalculateGravity()
+{
+	return (Settings->GravityScale * World->GetGravityZ());
+}
+
+bool UCharacterPawnMovementComponent::DetermineIfGrounded(const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation) const
+{
+	FHitResult Hit = FindGroundHit(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation);
+	if ((!Hit.bBlockingHit) || (!IsWalkableSurface(Hit.ImpactNormal)))
+	{
+		return false;
+	}
+	return Hit.bBlockingHit;
+}
+
+bool UCharacterPawnMovementComponent::StepUp(const FHitResult& CollisionHitResult, const FVector& Displacement, const FCollisionShape& MovementCollisionShape,
+	const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation)
+{
+	KPC_SCOPE_CYCLE_COUNTER(STAT_KPCStepUp, KinematicPawn_StepUp);
+
+	// Check if the collision height is below the maximum step height.
+	const double CollisionHeight = UMathUtilityLibrary::NumericalDistance(CollisionHitResult.ImpactPoint.Z,
+		UCollisionLibrary::GetLowestPointOnShape(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation, FVector::UpVector).Z);
+
+	if (CollisionHeight > Settings->MaxStepHeight)
+	{
+		return false;
+	}
+
+	// Is the step surface walkable? The next step of a staircase being climbed has the same surface as the last step so does not need to be probed.
+	const bool bPredictedStep = IsPredictedStep(CollisionHitResult, CollisionHeight);
+	const FVector StepSurfaceNormal = (bPredictedStep) ? StepCache.SurfaceNormal : FindStepSurfaceNormalFromCollision(CollisionHitResult);
+	if (bPredictedStep)
+	{
+		INC_DWORD_STAT(STAT_KPCStepCacheHits);
+	}
+
+	if (!IsWalkableSurface(StepSurfaceNormal))
+	{
+		return false;
+	}
+
+	// The pawn was raised by at most the step height so never needs to search further than that to land on the step.
+	const float StepSnapDownDistance = Settings->StepSnapDownDistance;
+
+	// Calculate new sweep start location having teleported the collision shape up to the collision height.
+	FVector NewStartLocation = CollisionHitResult.TraceStart + FVector(0.0, 0.0, CollisionHeight + 0.01);
+
+	// Is there a ceiling blocking the teleport up?
+	FHitResult HitResult = {};
+	if (SweepSingle(HitResult,
+		MovementCollisionLocation,
+		NewStartLocation,
+		MovementCollisionRotation,
+		MovementCollisionShape))
+	{
+		return false;
+	}
+
+	// No ceiling blocking the teleport up.
+
+	// Sweep original displacement from the teleported up location.
+	HitResult.Reset();
+	if (SweepSingle(HitResult,
+		NewStartLocation,
+		NewStartLocation + Displacement,
+		MovementCollisionRotation,
+		MovementCollisionShape))
+	{
+		// Is there enough step available to step on.
+		double StepDepth = (FVector(HitResult.ImpactPoint.X, HitResult.ImpactPoint.Y, 0.0) -
+			FVector(CollisionHitResult.ImpactPoint.X, CollisionHitResult.ImpactPoint.Y, 0.0)).Length();
+
+		// Allow step depths below the threshold when the collision height is a small number as this is a collision with a shallow slope that the pawn should walk up.
+		if ((StepDepth >= static_cast<double>(Settings->MinStepDepth)) || (CollisionHeight < static_cast<double>(Settings->StepDepthCollisionHeightThreshold)))
+		{
+			FVector NewLocation = HitResult.TraceStart + PullBackMovement(HitResult.Location - HitResult.TraceStart);
+			SetUpdatedComponentLocation(NewLocation);
+			SnapDownToSurface(StepSnapDownDistance, NewLocation, MovementCollisionRotation, MovementCollisionShape);
+			UpdateStepCache(CollisionHitResult, CollisionHeight, StepSurfaceNormal);
+
+			return true;
+		}
+
+		// Not enough step available so fail to step up.
+
+		return false;
+	}
+
+	FVector NewLocation = HitResult.TraceEnd;
+	SetUpdatedComponentLocation(NewLocation);
+	SnapDownToSurface(StepSnapDownDistance, NewLocation, MovementCollisionRotation, MovementCollisionShape);
+	UpdateStepCache(CollisionHitResult, CollisionHeight, StepSurfaceNormal);
+
+	return true;
+}
+
+bool UCharacterPawnMovementComponent::IsPredictedStep(const FHitResult& CollisionHitResult, double CollisionHeight) const
+{
+	if ((StepCacheTolerance < 0.0f) || (StepCache.StepDepth <= 0.0) || (CollisionHitResult.Component != StepCache.Component))
+	{
+		return false;
+	}
+
+	// The pawn must be standing on the last step and the edge must be one step up and one step along the staircase's run from the last step's edge. Movement
+	// along the edge is allowed.
+	const double Tolerance = static_cast<double>(StepCacheTolerance);
+	const FVector EdgeOffset = CollisionHitResult.ImpactPoint - StepCache.EdgeLocation;
+	return ((FMath::Abs(CollisionHeight - StepCache.StepHeight) <= Tolerance) &&
+		(FMath::Abs(EdgeOffset.Z - StepCache.StepHeight) <= Tolerance) &&
+		(FMath::Abs(FVector::DotProduct(EdgeOffset, StepCache.RunDirection) - StepCache.StepDepth) <= Tolerance));
+}
+
+void UCharacterPawnMovementComponent::UpdateStepCache(const FHitResult& CollisionHitResult, double CollisionHeight, const FVector& StepSurfaceNormal)
+{
+	if (StepCacheTolerance < 0.0f)
+	{
+		return;
+	}
+
+	// Learn the staircase's run when this step is one step up from the last step of the same component. A predicted step keeps the run it was predicted with.
+	if (!IsPredictedStep(CollisionHitResult, CollisionHeight))
+	{
+		const double Tolerance = static_cast<double>(StepCacheTolerance);
+		const FVector EdgeOffset = CollisionHitResult.ImpactPoint - StepCache.EdgeLocation;
+		const bool bConsecutiveStep = ((CollisionHitResult.Component == StepCache.Component) &&
+			(FMath::Abs(CollisionHeight - StepCache.StepHeight) <= Tolerance) &&
+			(FMath::Abs(EdgeOffset.Z - StepCache.StepHeight) <= Tolerance) &&
+			(EdgeOffset.Size2D() > Tolerance));
+
+		StepCache.RunDirection = (bConsecutiveStep) ? EdgeOffset.GetSafeNormal2D() : FVector::ZeroVector;
+		StepCache.StepDepth = (bConsecutiveStep) ? EdgeOffset.Size2D() : 0.0;
+	}
+
+	StepCache.Component = CollisionHitResult.Component;
+	StepCache.EdgeLocation = CollisionHitResult.ImpactPoint;
+	StepCache.SurfaceNormal = StepSurfaceNormal;
+	StepCache.StepHeight = CollisionHeight;
+}
+
+void UCharacterPawnMovementComponent::SnapDownToSurface(float InMaxSnapDownDistance, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation,
+	const FCollisionShape& MovementCollisionShape)
+{
+	KPC_SCOPE_CYCLE_COUNTER(STAT_KPCSnapDown, KinematicPawn_SnapDown);
+
+	FHitResult HitResult = {};
+	if (FindGroundHitInHeightGrid(HitResult, MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation, 0.0, static_cast<double>(InMaxSnapDownDistance)))
+	{
+		SetUpdatedComponentLocation(HitResult.TraceStart + PullBackMovement(HitResult.Location - HitResult.TraceStart));
+		return;
+	}
+
+	if (SweepSingle(HitResult, MovementCollisionLocation, MovementCollisionLocation - FVector(0.0, 0.0, static_cast<double>(InMaxSnapDownDistance)),
+		MovementCollisionRotation, MovementCollisionShape))
+	{
+		SetUpdatedComponentLocation(HitResult.TraceStart + PullBackMovement(HitResult.Location - HitResult.TraceStart));
+	}
+}
+
+void UCharacterPawnMovementComponent::MoveAndSlideHorizontalWalking(const FVector& Displacement, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation,
+	const FCollisionShape& MovementCollisionShape)
+{
+	// Cap out at max slide iterations.
+	FVector CurrentMovementCollisionLocation = MovementCollisionLocation;
+	FVector RemainingDisplacement = Displacement;
+	FHitResult Hit = {};
+	for (int32 i = 0; i < Settings->MaxMoveAndSlideIterations; ++i)
+	{
+		// Early out.
+		if (RemainingDisplacement.IsNearlyZero(UE_DOUBLE_KINDA_SMALL_NUMBER))
+		{
+			break;
+		}
+
+		INC_DWORD_STAT(STAT_KPCSlideIterations);
+
+		// Get ground surface normal.
+		const FVector GroundSurfaceNormal = FindGroundSurfaceNormal(CurrentMovementCollisionLocation, MovementCollisionRotation, MovementCollisionShape);
+		const bool bIsGroundSurfaceNormalZero = GroundSurfaceNormal.IsNearlyZero(0.01);
+
+		// If the ground normal is zero then the pawn is not grounded so do not adjust displacement vector.
+		if (!bIsGroundSurfaceNormalZero)
+		{
+			// Match displacement vector to the ground normal.
+			RemainingDisplacement = UMathUtilityLibrary::MatchVectorToSlope(FVector::UpVector, RemainingDisplacement, GroundSurfaceNormal);
+		}
+
+		// Sweep displacement.
+		if (!DepenetrateAndSweep(Hit,
+			RemainingDisplacement,
+			CurrentMovementCollisionLocation,
+			MovementCollisionRotation,
+			MovementCollisionShape))
+		{
+			CurrentMovementCollisionLocation = Hit.TraceEnd;
+			RemainingDisplacement = FVector::ZeroVector;
+			break;
+		}
+
+		// Stuck?
+		if (Hit.bStartPenetrating)
+		{
+			RemainingDisplacement = FVector::ZeroVector;
+			if (IsInGameThread())
+			{
+				DrawDebugSphere(World, Hit.TraceStart, 45.0f, 16, FColor::Red);
+			}
+			continue;
+		}
+
+		// Try to step up onto the surface if on the ground.
+		if ((!bIsGroundSurfaceNormalZero) && (StepUp(Hit, RemainingDisplacement, MovementCollisionShape, CurrentMovementCollisionLocation, MovementCollisionRotation)))
+		{
+			// Immediately stop moving and sliding after stepping up. Do not need to update pawn location as this handled by StepUp().
+			return;
+		}
+
+		// Could not step up so need to slide on the collision surface.
+
+		// Prevent sliding vertically during horizontal movement.
+		if (bIsGroundSurfaceNormalZero)
+		{
+			Hit.Normal.Z = 0.0;
+			Hit.Normal.Normalize();
+		}
+		else
+		{
+			Hit.Normal = UMathUtilityLibrary::MatchVectorToSlope(GroundSurfaceNormal, Hit.Normal, GroundSurfaceNormal);
+		}
+
+		// Update location and remaining displacement.
+		CurrentMovementCollisionLocation = Hit.TraceStart + PullBackMovement(Hit.Location - Hit.TraceStart);
+		RemainingDisplacement = FVector::VectorPlaneProject(RemainingDisplacement * (1.0 - static_cast<double>(Hit.Time)), Hit.Normal);
+
+		// Prevent the pawn sliding back on itself.
+		if (FVector::DotProduct(RemainingDisplacement.GetSafeNormal(), Displacement.GetSafeNormal()) < 0.0)
+		{
+			RemainingDisplacement = FVector::ZeroVector;
+		}
+	}
+
+	SetUpdatedComponentLocation(CurrentMovementCollisionLocation);
+}
+
+void UCharacterPawnMovementComponent::MoveAndSlideVerticalWalking(const FVector& Displacement, const FVector& MovementCollisionLocation,
+	const FQuat& MovementCollisionRotation, const FCollisionShape& MovementCollisionShape)
+{
+	// Cap out at max slide iterations.
+	FVector CurrentMovementCollisionLocation = MovementCollisionLocation;
 	FVector RemainingDisplacement = Displacement;
 	FHitResult Hit = {};
-	for (int32 i = 0; i < MaxMoveAndSlideIterations; ++i)
+	for (int32 i = 0; i < Settings->MaxMoveAndSlideIterations; ++i)
+	{
+		// Early out.
+		if (RemainingDisplacement.IsNearlyZero(UE_DOUBLE_KINDA_SMALL_NUMBER))
+		{
+			break;
+		}
+
+		INC_DWORD_STAT(STAT_KPCSlideIterations);
+
+		// Sweep displacement.
+		if (!DepenetrateAndSweep(Hit,
+			RemainingDisplacement,
+			CurrentMovementCollisionLocation,
+			MovementCollisionRotation,
+			MovementCollisionShape))
+		{
+			CurrentMovementCollisionLocation = Hit.TraceEnd;
+			RemainingDisplacement = FVector::ZeroVector;
+			break;
+		}
+
+		// Stuck?
+		if (Hit.bStartPenetrating)
+		{
+			RemainingDisplacement = FVector::ZeroVector;
+			continue;
+		}
+
+		// Update location.
+		CurrentMovementCollisionLocation = Hit.TraceStart + PullBackMovement(Hit.Location - Hit.TraceStart);
+
+		// Do not slide on ceilings.
+		if (Hit.ImpactPoint.Z > CurrentMovementCollisionLocation.Z)
+		{
+			RemainingDisplacement = FVector::ZeroVector;
+			// Zero out vertical velocity for the next frame.
+			HotState->VerticalVelocity = FVector::ZeroVector;
+			break;
+		}
+
+		// Do not slide on walkable surfaces and generate landed event.
+		if (IsWalkableSurface(Hit.ImpactNormal))
+		{
+			RemainingDisplacement = FVector::ZeroVector;
+			// Zero out vertical velocity for the next frame.
+			HotState->VerticalVelocity = FVector::ZeroVector;
+
+			OnLandedWalking();
+
+			break;
+		}
+
+		// Update remaining displacement.
+		RemainingDisplacement = FVector::VectorPlaneProject(RemainingDisplacement * (1.0 - static_cast<double>(Hit.Time)), Hit.Normal);
+	}
+
+	SetUpdatedComponentLocation(CurrentMovementCollisionLocation);
+}
+
+bool UCharacterPawnMovementComponent::IsWalkableSurface(const FVector& SurfaceNormal) const
+{
+	return UMathUtilityLibrary::IsWalkable(SurfaceNormal, WalkableFloorZ);
+}
+
+void UCharacterPawnMovementComponent::SetMaxWalkableSlopeAngle(float Angle)
+{
+	// Only changes this pawn. The settings asset is shared.
+	WalkableFloorZ = UMathUtilityLibrary::WalkableFloorZFromAngle(Angle);
+}
+
+FVector UCharacterPawnMovementComponent::FindStepSurfaceNormalFromCollision(const FHitResult& Hit)
+{
+	FHitResult SlopeHit = {};
+	SweepSingle(SlopeHit,
+		Hit.ImpactPoint + FVector(0.0, 0.0, 1.0),
+		Hit.ImpactPoint - FVector(0.0, 0.0, 0.01),
+		FQuat::Identity,
+		FCollisionShape::MakeSphere(0.25f));
+
+	return SlopeHit.ImpactNormal;
+}
+
+FHitResult UCharacterPawnMovementComponent::FindGroundHit(const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation) const
+{
+	INC_DWORD_STAT(STAT_KPCGroundProbesRequested);
+
+	// Reuse a ground probe made earlier this tick from the same location if there is one.
+	if (const FKPCGroundProbeCacheEntry* CachedEntry = FindGroundProbeCacheEntry(MovementCollisionLocation, MovementCollisionRotation))
+	{
+		INC_DWORD_STAT(STAT_KPCGroundProbesCached);
+		INC_DWORD_STAT_BY(STAT_KPCGroundProbeQueriesSaved, CachedEntry->NumSceneQueries);
+		return CachedEntry->Hit;
+	}
+
+	if (GroundProbeCacheTolerance < 0.0f)
+	{
+		int32 NumProbeSceneQueries = 0;
+		return ProbeGround(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation, NumProbeSceneQueries);
+	}
+
+	// Probe straight into the cache entry, overwriting the oldest entry once the cache is full, so the hit is only copied once on the way out.
+	FKPCGroundProbeCacheEntry* NewEntry = nullptr;
+	if (GroundProbeCache.Num() < GroundProbeCacheSize)
+	{
+		NewEntry = &GroundProbeCache.AddDefaulted_GetRef();
+	}
+	else
+	{
+		NewEntry = &GroundProbeCache[NextGroundProbeCacheEntry];
+		NextGroundProbeCacheEntry = (NextGroundProbeCacheEntry + 1) % GroundProbeCacheSize;
+	}
+
+	NewEntry->Location = MovementCollisionLocation;
+	NewEntry->Rotation = MovementCollisionRotation;
+	NewEntry->NumSceneQueries = 0;
+	NewEntry->Hit = ProbeGround(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation, NewEntry->NumSceneQueries);
+	return NewEntry->Hit;
+}
+
+const FKPCGroundProbeCacheEntry* UCharacterPawnMovementComponent::FindGroundProbeCacheEntry(const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation) const
+{
+	if (GroundProbeCacheTolerance < 0.0f)
+	{
+		return nullptr;
+	}
+
+	const double ToleranceSquared = FMath::Square(static_cast<double>(GroundProbeCacheTolerance));
+	for (const FKPCGroundProbeCacheEntry& Entry : GroundProbeCache)
+	{
+		if ((FVector::DistSquared(Entry.Location, MovementCollisionLocation) <= ToleranceSquared) && (Entry.Rotation.Equals(MovementCollisionRotation, UE_KINDA_SMALL_NUMBER)))
+		{
+			return &Entry;
+		}
+	}
+	return nullptr;
+}
+
+void UCharacterPawnMovementComponent::InvalidateGroundProbeCache()
+{
+	GroundProbeCache.Reset();
+	NextGroundProbeCacheEntry = 0;
+}
+
+void UCharacterPawnMovementComponent::SetUpdatedComponentLocation(const FVector& NewLocation)
+{
+	if (bDeferTransformUpdates)
+	{
+		DeferredLocation = NewLocation;
+		bHasDeferredTransform = true;
+	}
+	else
+	{
+		UpdatedComponent->SetWorldLocation(NewLocation);
+	}
+	InvalidateGroundProbeCache();
+}
+
+void UCharacterPawnMovementComponent::SetUpdatedComponentRotation(const FQuat& NewRotation)
+{
+	if (bDeferTransformUpdates)
+	{
+		DeferredRotation = NewRotation;
+		bHasDeferredTransform = true;
+	}
+	else
+	{
+		UpdatedComponent->SetWorldRotation(NewRotation);
+	}
+}
+
+FVector UCharacterPawnMovementComponent::GetUpdatedComponentLocation() const
+{
+	return (bDeferTransformUpdates) ? DeferredLocation : UpdatedComponent->GetComponentLocation();
+}
+
+FQuat UCharacterPawnMovementComponent::GetUpdatedComponentQuat() const
+{
+	return (bDeferTransformUpdates) ? DeferredRotation : UpdatedComponent->GetComponentQuat();
+}
+
+void UCharacterPawnMovementComponent::BeginDeferredTransformUpdates()
+{
+	check(IsInGameThread());
+
+	DeferredLocation = UpdatedComponent->GetComponentLocation();
+	DeferredRotation = UpdatedComponent->GetComponentQuat();
+	bHasDeferredTransform = false;
+	bDeferTransformUpdates = true;
+}
+
+void UCharacterPawnMovementComponent::CommitDeferredTransformUpdates()
+{
+	check(IsInGameThread());
+	KPC_SCOPE_CYCLE_COUNTER(STAT_KPCCommitTransform, KinematicPawn_CommitTransform);
+
+	bDeferTransformUpdates = false;
+
+	// Move the updated component once so child components, bounds and overlaps are only updated once.
+	if (bHasDeferredTransform)
+	{
+		UpdatedComponent->SetWorldLocationAndRotation(DeferredLocation, DeferredRotation);
+	}
+
+	bHasDeferredTransform = false;
+}
+
+FHitResult UCharacterPawnMovementComponent::ProbeGround(const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation,
+	int32& OutNumSceneQueries) const
+{
+	OutNumSceneQueries = 0;
+
+	// Static ground found in the ground height grid does not need any scene queries.
+	FHitResult GridHit = {};
+	if (FindGroundHitInHeightGrid(GridHit, MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation, static_cast<double>(Settings->DetermineGroundedOffset),
+		static_cast<double>(Settings->DetermineGroundedOffset + Settings->DetermineGroundedDistance)))
+	{
+		return GridHit;
+	}
+
+	// Get the center bottom location of the collision shape.
+	FVector CenterBottomLocation(MovementCollisionLocation.X,
+		MovementCollisionLocation.Y,
+		UCollisionLibrary::GetLowestPointOnShape(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation, FVector::UpVector).Z);
+
+	// Get four more points extending from the center bottom location to use as ground sample points.
+	FVector SampleLocations[4] =
+	{
+		CenterBottomLocation + (MovementCollisionRotation.GetForwardVector() * static_cast<double>(Settings->DetermineGroundedSampleMod)),
+		CenterBottomLocation - (MovementCollisionRotation.GetForwardVector() * static_cast<double>(Settings->DetermineGroundedSampleMod)),
+		CenterBottomLocation + (MovementCollisionRotation.GetRightVector() * static_cast<double>(Settings->DetermineGroundedSampleMod)),
+		CenterBottomLocation - (MovementCollisionRotation.GetRightVector() * static_cast<double>(Settings->DetermineGroundedSampleMod))
+	};
+
+	// Trace from the center bottom location and additional four locations to search for ground.
+	FVector Offset = (FVector::UpVector * static_cast<double>(Settings->DetermineGroundedOffset));
+	FVector TraceDelta = (FVector::DownVector * static_cast<double>(Settings->DetermineGroundedDistance));
+
+	//DrawDebugSphere(World, CenterBottomLocation + Offset, 2.5f, 12, FColor::Red);
+	//DrawDebugSphere(World, CenterBottomLocation + TraceDelta, 2.5f, 12, FColor::Green);
+	//for (int8 i = 0; i < 4; ++i)
+	//{
+	//	DrawDebugSphere(World, SampleLocations[i] + Offset, 2.5f, 12, FColor::Red);
+	//	DrawDebugSphere(World, SampleLocations[i] + TraceDelta, 2.5f, 12, FColor::Green);
+	//}
+
+	FHitResult Hit = {};
+	++OutNumSceneQueries;
+	if (!LineTraceSingle(Hit,
+		CenterBottomLocation + Offset,
+		CenterBottomLocation + TraceDelta))
+	{
+		for (int8 i = 0; i < 4; ++i)
+		{
+			Hit.Init();
+			++OutNumSceneQueries;
+			if (LineTraceSingle(Hit,
+				SampleLocations[i] + Offset,
+				SampleLocations[i] + TraceDelta))
+			{
+				break;
+			}
+		}
+	}
+
+	if (Hit.bBlockingHit)
+	{
+		//DrawDebugSphere(World, Hit.ImpactPoint, 5.0f, 16, FColor::Blue);
+
+		return Hit;
+	}
+
+	// Fallback on shape cast if sample points fail to find ground collision. The pawn may still be grounded especially if the movement collision is longer than it is tall.
+	//UCollisionLibrary::DrawDebugShape(World, MovementCollisionLocation, MovementCollisionShape, MovementCollisionRotation, FColor::Red);
+	//UCollisionLibrary::DrawDebugShape(World, MovementCollisionLocation + TraceDelta, MovementCollisionShape, MovementCollisionRotation, FColor::Green);
+
+	Hit.Init();
+	++OutNumSceneQueries;
+	if (SweepSingle(Hit,
+		MovementCollisionLocation,
+		MovementCollisionLocation + TraceDelta,
+		MovementCollisionRotation,
+		MovementCollisionShape))
+	{
+		//UCollisionLibrary::DrawDebugShape(World, Hit.Location, MovementCollisionShape, MovementCollisionRotation, FColor::Blue);
+
+		return Hit;
+	}
+
+	Hit.Init();
+	return Hit;
+}
+
+bool UCharacterPawnMovementComponent::FindGroundHitInHeightGrid(FHitResult& OutHit, const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation,
+	const FQuat& MovementCollisionRotation, double TraceStartOffset, double TraceDistance) const
+{
+	if (GroundHeightGrid == nullptr)
+	{
+		return false;
+	}
+
+	INC_DWORD_STAT(STAT_KPCGroundGridLookups);
+
+	// Query the column the shape sweeps through.
+	const FVector Extent = MovementCollisionShape.GetExtent();
+	const double LowestPointZ = UCollisionLibrary::GetLowestPointOnShape(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation, FVector::UpVector).Z;
+	const FBox QueryBounds(FVector(MovementCollisionLocation.X - Extent.X, MovementCollisionLocation.Y - Extent.Y, LowestPointZ + TraceStartOffset - TraceDistance),
+		FVector(MovementCollisionLocation.X + Extent.X, MovementCollisionLocation.Y + Extent.Y, MovementCollisionLocation.Z + Extent.Z));
+
+	double GroundHeight = 0.0;
+	FVector GroundNormal = FVector::UpVector;
+	if (!GroundHeightGrid->SampleGround(QueryBounds, GroundHeight, GroundNormal))
+	{
+		INC_DWORD_STAT(STAT_KPCGroundGridFallbacks);
+		return false;
+	}
+
+	// A rounded bottom rests above the ground surface under its center on a slope.
+	double RestingHeight = GroundHeight;
+	if ((MovementCollisionShape.IsCapsule()) || (MovementCollisionShape.IsSphere()))
+	{
+		const double Radius = (MovementCollisionShape.IsCapsule()) ? static_cast<double>(MovementCollisionShape.GetCapsuleRadius()) :
+			static_cast<double>(MovementCollisionShape.GetSphereRadius());
+		RestingHeight += Radius * ((1.0 / FMath::Max(GroundNormal.Z, UE_KINDA_SMALL_NUMBER)) - 1.0);
+	}
+
+	// Ground outside of the trace may still be found by a scene query, for example a ledge under the edge of the shape.
+	const double TraceStartZ = LowestPointZ + TraceStartOffset;
+	const double TraceEndZ = TraceStartZ - TraceDistance;
+	if ((RestingHeight > TraceStartZ) || (RestingHeight < TraceEndZ))
+	{
+		INC_DWORD_STAT(STAT_KPCGroundGridFallbacks);
+		return false;
+	}
+
+	// Report the hit as a sweep of the shape so callers can move the shape to the hit location.
+	const double Distance = TraceStartZ - RestingHeight;
+	const FVector TraceStart = MovementCollisionLocation + FVector(0.0, 0.0, TraceStartOffset);
+	OutHit.Init(TraceStart, TraceStart - FVector(0.0, 0.0, TraceDistance));
+	OutHit.bBlockingHit = true;
+	OutHit.Time = (TraceDistance > 0.0) ? static_cast<float>(Distance / TraceDistance) : 0.0f;
+	OutHit.Distance = static_cast<float>(Distance);
+	OutHit.Location = TraceStart - FVector(0.0, 0.0, Distance);
+	OutHit.ImpactPoint = FVector(MovementCollisionLocation.X, MovementCollisionLocation.Y, GroundHeight);
+	OutHit.Normal = GroundNormal;
+	OutHit.ImpactNormal = GroundNormal;
+	return true;
+}
+
+FVector UCharacterPawnMovementComponent::FindGroundSurfaceNormal(const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation, const FCollisionShape& MovementCollisionShape)
+{
+	FHitResult Hit = FindGroundHit(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation);
+	if (IsWalkableSurface(Hit.ImpactNormal))
+	{
+		return Hit.ImpactNormal;
+	}
+	return FVector::ZeroVector;
+}
+
+void UCharacterPawnMovementComponent::ApplyMovementBaseDelta()
+{
+	const UPrimitiveComponent* Base = GetSimulatedMovementBase();
+	FTransform BaseTransform;
+	if ((Base == nullptr) || (!GetMovementBaseTransform(Base, BaseTransform)))
+	{
+		HotState->BaseVelocity = FVector::ZeroVector;
+		MovementBaseDeltaTime = 0.0f;
+		return;
+	}
+
+	KPC_SCOPE_CYCLE_COUNTER(STAT_KPCMovementBase, KinematicPawn_MovementBase);
+
+	// Carry the pawn by the change in the base's transform since it was last seen. Only the yaw of the base's rotation is applied to keep the pawn upright. The
+	// pawn is not swept, anything the base carries the pawn into is resolved by ResolveInitialPenetration().
+	const FVector Location = GetUpdatedComponentLocation();
+	const FVector NewLocation = BaseTransform.TransformPosition(MovementBaseTransform.InverseTransformPosition(Location));
+	const double DeltaYaw = (BaseTransform.GetRotation() * MovementBaseTransform.GetRotation().Inverse()).Rotator().Yaw;
+	MovementBaseTransform = BaseTransform;
+
+	// The first substep of a frame sees the base's movement over the whole frame. Later substeps see none and keep the velocity found by the first.
+	if (MovementBaseDeltaTime > 0.0f)
+	{
+		HotState->BaseVelocity = (NewLocation - Location) / static_cast<double>(MovementBaseDeltaTime);
+		MovementBaseDeltaTime = 0.0f;
+	}
+
+	if (!NewLocation.Equals(Location))
+	{
+		SetUpdatedComponentLocation(NewLocation);
+	}
+
+	if (!FMath::IsNearlyZero(DeltaYaw))
+	{
+		SetUpdatedComponentRotation(FRotator(0.0, DeltaYaw, 0.0).Quaternion() * GetUpdatedComponentQuat());
+	}
+}
+
+void UCharacterPawnMovementComponent::UpdateMovementBase(const FHitResult& GroundHit)
+{
+	// Only walkable surfaces that can move carry the pawn. This supports sticking to walkable moving geometry such as an elevator or moving platform.
+	const bool bOnGround = ((GroundHit.bBlockingHit) && (IsWalkableSurface(GroundHit.ImpactNormal)));
+	UPrimitiveComponent* NewMovementBase = (bOnGround) ? GroundHit.Component.Get() : nullptr;
+	if ((NewMovementBase != nullptr) && (!IsMovableMovementBase(NewMovementBase)))
+	{
+		NewMovementBase = nullptr;
+	}
+
+	if (NewMovementBase != GetSimulatedMovementBase())
+	{
+		SetMovementBase(NewMovementBase, !bOnGround);
+	}
+}
+
+void UCharacterPawnMovementComponent::SetMovementBase(UPrimitiveComponent* NewMovementBase, bool bLeftGround)
+{
+	INC_DWORD_STAT(STAT_KPCMovementBaseChanges);
+
+	// Keep moving with the old base's velocity when leaving the ground from it so the pawn does not stop dead when jumping or walking off a moving platform.
+	if ((Settings->bImpartBaseVelocityOnLeave) && (bLeftGround) && (GetSimulatedMovementBase() != nullptr))
+	{
+		switch (HotState->MovementMode)
+		{
+		case EKPCMovementMode::Walking:
+			HotState->HorizontalVelocity += FVector(HotState->BaseVelocity.X, HotState->BaseVelocity.Y, 0.0);
+			HotState->VerticalVelocity += FVector(0.0, 0.0, HotState->BaseVelocity.Z);
+			break;
+		}
+	}
+
+	// The physics thread only keeps its own copy of the base. The game thread's copy is updated from the step's output.
+	if (AsyncInput != nullptr)
+	{
+		const FKPCAsyncCollisionPrimitive* Primitive = (NewMovementBase != nullptr) ? FindAsyncCollisionPrimitive(NewMovementBase) : nullptr;
+		AsyncMovementBase = NewMovementBase;
+		AsyncMovementBaseHandle = (Primitive != nullptr) ? Primitive->ComponentHandle : nullptr;
+	}
+	else
+	{
+		HotState->MovementBase = NewMovementBase;
+	}
+	if ((NewMovementBase == nullptr) || (!GetMovementBaseTransform(NewMovementBase, MovementBaseTransform)))
+	{
+		MovementBaseTransform = FTransform::Identity;
+	}
+	HotState->BaseVelocity = FVector::ZeroVector;
+	MovementBaseDeltaTime = 0.0f;
+}
+
+bool UCharacterPawnMovementComponent::GetMovementBaseTransform(const UPrimitiveComponent* Base, FTransform& OutTransform) const
+{
+	if (AsyncInput == nullptr)
+	{
+		OutTransform = Base->GetComponentTransform();
+		return true;
+	}
+
+	// A base that was not gathered with the input is out of reach or destroyed, so the pawn is not carried by it this step.
+	const FKPCAsyncCollisionPrimitive* Primitive = FindAsyncCollisionPrimitive(Base);
+	return ((Primitive != nullptr) && (UCollisionLibrary::GetParticleTransform_Internal(OutTransform, Primitive->Particle)));
+}
+
+bool UCharacterPawnMovementComponent::IsMovableMovementBase(const UPrimitiveComponent* Base) const
+{
+	if (AsyncInput == nullptr)
+	{
+		return (Base->Mobility == EComponentMobility::Movable);
+	}
+
+	const FKPCAsyncCollisionPrimitive* Primitive = FindAsyncCollisionPrimitive(Base);
+	return ((Primitive != nullptr) && (Primitive->bMovable));
+}
+
+FVector UCharacterPawnMovementComponent::AdjustDepenetrationNormalWalking(FVector Normal, const FVector& ImpactNormal)
+{
+	return ((IsWalkableSurface(ImpactNormal)) ? FVector::UpVector : Normal);
+}
+
+void UCharacterPawnMovementComponent::ApplyRootMotionRotationWalking(const FQuat& Rotation)
+{
+	// Remove pitch and roll rotation components in walking mode.
+	SetUpdatedComponentRotation(FRotator(0.0, RootMotionMovementParams.GetRootMotionTransform().GetRotation().Rotator().Yaw, 0.0).Quaternion() * GetUpdatedComponentQuat());
+}
+
+FRotator UCharacterPawnMovementComponent::GetMovementOrientationWalking()
+{
+	return HotState->HorizontalVelocity.ToOrientationRotator();
+}
+
+void UCharacterPawnMovementComponent::ApplyVerticalForceWalking(float Force)
+{
+	HotState->VerticalVelocity = FVector::ZeroVector; // Remove this line to make the pawn need to overcome any existing vertical velocity with the added force.
+
+	// Displacement initial is square root of -2 multiplied by acceleration multiplied by displacement. Vf^2 = Vi^2 + 2ad rearranged for Vi when Vf is 0 (the apex of the jump).
+	// The true equation would be FMath::Sqrt(-2.0 * ScaledPawnGravity * JumpHeightInCm).
+	// Use world gravity Z unscaled by character pawn movement component's gravity scale here to allow the character pawn to be able to jump when gravity scale is set to 0.
+	// Not mathematically correct but the displacement value (jump height) acts as a jump force/strength value.
+	HotState->VerticalVelocity += FVector::UpVector * FMath::Sqrt(-2.0 * static_cast<double>(World->GetGravityZ()) * static_cast<double>(Force));
+}
+
+FVector UCharacterPawnMovementComponent::GetVelocityWalking() const
+{
+	return HotState->HorizontalVelocity + HotState->VerticalVelocity;
+}
+
+void UCharacterPawnMovementComponent::OnLandedWalking()
+{
+	HotState->bGrounded = true;
+
+	if (Settings->bRemoveVelocityOnLand)
+	{
+		// Remove any remaining horizontal velocity to stop the pawn having to brake to a stop after landing when there is no movement input.
+		if (HotState->InputScale < 0.01)
+		{
+			HotState->HorizontalVelocity = FVector::ZeroVector;
+		}
+	}
+}
+
+bool UCharacterPawnMovementComponent::DepenetrateAndSweep(FHitResult& OutHit, const FVector& Displacement, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation,
+	const FCollisionShape& MovementCollisionShape)
+{
+	HitResultScratch.Reset();
+
+	// Sweep with inflated skin.
+	const bool bSkinHit = SweepMulti(HitResultScratch,
+		MovementCollisionLocation,
+		MovementCollisionLocation + Displacement,
+		MovementCollisionRotation,
+		InflatedMovementCollisionShape);
+
+	if (!bSkinHit)
+	{
+		OutHit.Init();
+		OutHit.TraceStart = MovementCollisionLocation;
+		OutHit.TraceEnd = MovementCollisionLocation + Displacement;
+		OutHit.Location = MovementCollisionLocation + Displacement;
+		OutHit.Time = 1.0f;
+		return false;
+	}
+
+	if (!GatherPenetrationContacts(MovementCollisionLocation, MovementCollisionRotation, InflatedMovementCollisionShape, false))
+	{
+		OutHit = HitResultScratch.Last();
+		return bSkinHit;
+	}
+
+	const FVector Fixup = SweepDepenetrationSolver.Solve(PenetrationContactScratch, Settings->MaxPenetrationResolutionIterations,
+		static_cast<double>(Settings->DepenetrationTolerance));
+
+	// Resweep from new start.
+	return SweepSingle(OutHit, MovementCollisionLocation + Fixup, MovementCollisionLocation + Fixup + Displacement, MovementCollisionRotation, MovementCollisionShape);
+}
+
+void UCharacterPawnMovementComponent::MoveOutOfCollision(const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation, const FCollisionShape& MovementCollisionShape)
+{
+	KPC_SCOPE_CYCLE_COUNTER(STAT_KPCOutOfCollision, KinematicPawn_OutOfCollision);
+
+	HitResultScratch.Reset();
+
+	// Sweep forwards a small distance.
+	if (!SweepMulti(HitResultScratch,
+		MovementCollisionLocation,
+		MovementCollisionLocation + (MovementCollisionRotation.GetForwardVector() * 0.01),
+		MovementCollisionRotation,
+		MovementCollisionShape))
 	{
-		// Early out.
-		if (RemainingDisplacement.IsNearlyZero(UE_DOUBLE_KINDA_SMALL_NUMBER))
+		return;
+	}
+
+	if (!GatherPenetrationContacts(MovementCollisionLocation, MovementCollisionRotation, MovementCollisionShape, true))
+	{
+		return;
+	}
+
+	const FVector Fixup = OutOfCollisionSolver.Solve(PenetrationContactScratch, Settings->MaxPenetrationResolutionIterations,
+		static_cast<double>(Settings->DepenetrationTolerance));
+
+	SetUpdatedComponentLocation(MovementCollisionLocation + Fixup);
+}
+
+bool UCharacterPawnMovementComponent::GatherPenetrationContacts(const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation,
+	const FCollisionShape& MovementCollisionShape, bool bAdjustNormalsForMovementMode)
+{
+	PenetrationContactScratch.Reset();
+	for (const FHitResult& It : HitResultScratch)
+	{
+		if (!It.bStartPenetrating)
 		{
-			break;
+			continue;
 		}
 
-		// Get ground surface normal.
-		const FVector GroundSurfaceNormal = FindGroundSurfaceNormal(CurrentMovementCollisionLocation, MovementCollisionRotation, MovementCollisionShape);
-		const bool bIsGroundSurfaceNormalZero = GroundSurfaceNormal.IsNearlyZero(0.01);
+		FVector Normal = It.Normal;
+		double Depth = static_cast<double>(It.PenetrationDepth);
 
-		// If the ground normal is zero then the pawn is not grounded so do not adjust displacement vector.
-		if (!bIsGroundSurfaceNormalZero)
+		// The sweep leaves the penetration depth at zero when it could not compute a minimum translation distance for the overlap, for example for a deep overlap
+		// with complex collision. If the primitive can not compute one either the pawn is still pushed out along the hit normal by the additional distance.
+		if (Depth <= 0.0)
 		{
-			// Match displacement vector to the ground normal.
-			RemainingDisplacement = UMathUtilityLibrary::MatchVectorToSlope(FVector::UpVector, RemainingDisplacement, GroundSurfaceNormal);
+			ComputePenetration(Normal, Depth, It, MovementCollisionLocation, MovementCollisionRotation, MovementCollisionShape);
 		}
 
-		// Sweep displacement.
-		if (!DepenetrateAndSweep(Hit,
-			RemainingDisplacement,
-			CurrentMovementCollisionLocation,
-			MovementCollisionRotation,
-			MovementCollisionShape))
+		if (bAdjustNormalsForMovementMode)
 		{
-			CurrentMovementCollisionLocation = Hit.TraceEnd;
-			RemainingDisplacement = FVector::ZeroVector;
-			break;
+			switch (HotState->MovementMode)
+			{
+			case EKPCMovementMode::Walking: Normal = AdjustDepenetrationNormalWalking(Normal, It.ImpactNormal); break;
+			}
 		}
 
-		// Stuck?
-		if (Hit.bStartPenetrating)
+		PenetrationContactScratch.Add({ It.GetComponent(), It.Item, Normal, Depth + static_cast<double>(Settings->AdditionalDepenetrationDistance) });
+	}
+	return (PenetrationContactScratch.Num() > 0);
+}
+
+double UCharacterPawnMovementComponent::CalculateOrientRotationComponentDelta(double Current, double Target, float DeltaTime, float Speed)
+{
+	const double Dist = static_cast<double>((((FMath::TruncToInt(Target - Current)) + 540) % 360) - 180);
+	const double Step = static_cast<double>(DeltaTime) * static_cast<double>(Speed);
+	return FMath::Clamp(Dist, -Step, Step);
+}
+
+void UCharacterPawnMovementComponent::AddVerticalForce(float Force)
+{
+	if (IsRecording())
+	{
+		PendingRecordingEvents.Add({ EKPCMovementRecordEventType::AddVerticalForce, Force });
+	}
+
+	WakeUp();
+
+	if (bAsyncPhysicsTickActive)
+	{
+		PendingAsyncEvents.bHasVerticalForce = true;
+		PendingAsyncEvents.VerticalForce = Force;
+		return;
+	}
+
+	switch (HotState->MovementMode)
+	{
+	case EKPCMovementMode::Walking: ApplyVerticalForceWalking(Force); break;
+	}
+}
+
+FVector UCharacterPawnMovementComponent::GetVelocity() const
+{
+	return (bAsyncPhysicsTickActive) ? AsyncVelocity : GetSimulatedVelocity();
+}
+
+FVector UCharacterPawnMovementComponent::GetSimulatedVelocity() const
+{
+	switch (HotState->MovementMode)
+	{
+	case EKPCMovementMode::Walking: return GetVelocityWalking();
+	}
+	return FVector::ZeroVector;
+}
+
+void UCharacterPawnMovementComponent::UpdatePawnRotation(float DeltaTime)
+{
+	KPC_SCOPE_CYCLE_COUNTER(STAT_KPCRotation, KinematicPawn_Rotation);
+
+	// If root motion is present rotate the pawn with root motion instead of movement input unless rotation from movement input has been requested.
+	if (HasRootMotion())
+	{
+		switch (HotState->MovementMode)
 		{
-			RemainingDisplacement = FVector::ZeroVector;
-			DrawDebugSphere(World, Hit.TraceStart, 45.0f, 16, FColor::Red);
-			continue;
+		case EKPCMovementMode::Walking: ApplyRootMotionRotationWalking(RootMotionMovementParams.GetRootMotionTransform().GetRotation()); break;
 		}
 
-		// Try to step up onto the surface if on the ground.
-		if ((!bIsGroundSurfaceNormalZero) && (StepUp(Hit, RemainingDisplacement, MovementCollisionShape, CurrentMovementCollisionLocation, MovementCollisionRotation)))
+		if (!Settings->bAllowMovementRotationDuringRootMotion)
 		{
-			// Immediately stop moving and sliding after stepping up. Do not need to update pawn location as this handled by StepUp().
 			return;
 		}
+	}
 
-		// Could not step up so need to slide on the collision surface.
+	if (!Settings->bOrientRotationToMovement)
+	{
+		return;
+	}
 
-		// Prevent sliding vertically during horizontal movement.
-		if (bIsGroundSurfaceNormalZero)
-		{
-			Hit.Normal.Z = 0.0;
-			Hit.Normal.Normalize();
-		}
-		else
-		{
-			Hit.Normal = UMathUtilityLibrary::MatchVectorToSlope(GroundSurfaceNormal, Hit.Normal, GroundSurfaceNormal);
-		}
+	// Only orient rotation to movement when there is movement input.
+	if (!IsRequestingMovement())
+	{
+		return;
+	}
 
-		// Update location and remaining displacement.
-		CurrentMovementCollisionLocation = Hit.TraceStart + PullBackMovement(Hit.Location - Hit.TraceStart);
-		RemainingDisplacement = FVector::VectorPlaneProject(RemainingDisplacement * (1.0 - static_cast<double>(Hit.Time)), Hit.Normal);
+	FRotator CurrentRotation = GetUpdatedComponentQuat().Rotator();
 
-		// Prevent the pawn sliding back on itself.
-		if (FVector::DotProduct(RemainingDisplacement.GetSafeNormal(), Displacement.GetSafeNormal()) < 0.0)
-		{
-			RemainingDisplacement = FVector::ZeroVector;
-		}
+	FRotator MovementOrientation(0.0);
+	switch (HotState->MovementMode)
+	{
+	case EKPCMovementMode::Walking: MovementOrientation = GetMovementOrientationWalking(); break;
 	}
 
-	UpdatedComponent->SetWorldLocation(CurrentMovementCollisionLocation);
+	FRotator NewRotation(((Settings->bOrientPitch) ? MovementOrientation.Pitch : CurrentRotation.Pitch),
+		((Settings->bOrientYaw) ? MovementOrientation.Yaw : CurrentRotation.Yaw),
+		((Settings->bOrientRoll) ? MovementOrientation.Roll : CurrentRotation.Roll));
+
+	SetUpdatedComponentRotation(FRotator(
+		CurrentRotation.Pitch + CalculateOrientRotationComponentDelta(CurrentRotation.Pitch, NewRotation.Pitch, DeltaTime, Settings->OrientRotationRate.Pitch),
+		CurrentRotation.Yaw + CalculateOrientRotationComponentDelta(CurrentRotation.Yaw, NewRotation.Yaw, DeltaTime, Settings->OrientRotationRate.Yaw),
+		CurrentRotation.Roll + CalculateOrientRotationComponentDelta(CurrentRotation.Roll, NewRotation.Roll, DeltaTime, Settings->OrientRotationRate.Roll)).Quaternion());
 }
 
-void UCharacterPawnMovementComponent::MoveAndSlideVerticalWalking(const FVector& Displacement, const FVector& MovementCollisionLocation,
-	const FQuat& MovementCollisionRotation, const FCollisionShape& MovementCollisionShape)
+void UCharacterPawnMovementComponent::ClearMovementInput()
 {
-	// Cap out at max slide iterations.
-	FVector CurrentMovementCollisionLocation = MovementCollisionLocation;
-	FVector RemainingDisplacement = Displacement;
-	FHitResult Hit = {};
-	for (int32 i = 0; i < MaxMoveAndSlideIterations; ++i)
+	// Do not clear movement input direction as the last direction is used to update the pawn rotation when there is no movement input being added.
+	//HotState->InputDirection = FVector::ZeroVector;
+
+	HotState->InputScale = 0.0f;
+}
+
+bool UCharacterPawnMovementComponent::IsRequestingMovement()
+{
+	return (HotState->InputScale > 0.0f);
+}
+
+bool UCharacterPawnMovementComponent::HasRootMotion()
+{
+	return RootMotionMovementParams.bHasRootMotion;
+}
+
+FCollisionShape UCharacterPawnMovementComponent::GetMovementCollisionShape() const
+{
+	return (AsyncInput != nullptr) ? AsyncInput->CollisionShape : UpdatedComponent->GetCollisionShape();
+}
+
+FVector UCharacterPawnMovementComponent::PullBackMovement(const FVector& Movement)
+{
+	const double Distance = Movement.Length();
+	return (Distance > static_cast<double>(Settings->PullBackMovementEpsilon)) ? Movement * ((Distance - static_cast<double>(Settings->PullBackMovementEpsilon)) / Distance) : FVector(0.0);
+}
+
+bool UCharacterPawnMovementComponent::SweepSingle(FHitResult& OutHit, const FVector& Start, const FVector& End, const FQuat& Rotation, const FCollisionShape& Shape) const
+{
+	++NumSceneQueries;
+	INC_DWORD_STAT(STAT_KPCSweeps);
+
+	if (AsyncInput != nullptr)
 	{
-		// Early out.
-		if (RemainingDisplacement.IsNearlyZero(UE_DOUBLE_KINDA_SMALL_NUMBER))
+		return SweepAsyncCollision(OutHit, Start, End, Rotation, Shape);
+	}
+
+	bool bBlockingHit = false;
+	if (SweepCollisionNeighbourhood(OutHit, bBlockingHit, Start, End, Rotation, Shape))
+	{
+		return bBlockingHit;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_KPCWorldQueries);
+	return World->SweepSingleByChannel(OutHit, Start, End, Rotation, Settings->MovementTraceChannel, Shape, MovementCollisionQueryParams);
+}
+
+bool UCharacterPawnMovementComponent::SweepMulti(TArray<FHitResult>& OutHits, const FVector& Start, const FVector& End, const FQuat& Rotation, const FCollisionShape& Shape) const
+{
+	++NumSceneQueries;
+	INC_DWORD_STAT(STAT_KPCSweeps);
+	if (AsyncInput != nullptr)
+	{
+		const bool bHit = SweepMultiAsyncCollision(OutHits, Start, End, Rotation, Shape);
+		INC_DWORD_STAT_BY(STAT_KPCMultiSweepHits, OutHits.Num());
+		return bHit;
+	}
+
+	// Multi sweeps resolve penetration from every overlapping primitive so always use the world query.
+	SCOPE_CYCLE_COUNTER(STAT_KPCWorldQueries);
+	const bool bHit = World->SweepMultiByChannel(OutHits, Start, End, Rotation, Settings->MovementTraceChannel, Shape, MovementCollisionQueryParams);
+	INC_DWORD_STAT_BY(STAT_KPCMultiSweepHits, OutHits.Num());
+	return bHit;
+}
+
+bool UCharacterPawnMovementComponent::LineTraceSingle(FHitResult& OutHit, const FVector& Start, const FVector& End) const
+{
+	++NumSceneQueries;
+	INC_DWORD_STAT(STAT_KPCLineTraces);
+
+	if (AsyncInput != nullptr)
+	{
+		return LineTraceAsyncCollision(OutHit, Start, End);
+	}
+
+	bool bBlockingHit = false;
+	if (LineTraceCollisionNeighbourhood(OutHit, bBlockingHit, Start, End))
+	{
+		return bBlockingHit;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_KPCWorldQueries);
+	return World->LineTraceSingleByChannel(OutHit, Start, End, Settings->MovementTraceChannel, MovementCollisionQueryParams);
+}
+
+bool UCharacterPawnMovementComponent::ComputePenetration(FVector& OutDirection, double& OutDepth, const FHitResult& Hit, const FVector& Location, const FQuat& Rotation,
+	const FCollisionShape& Shape) const
+{
+	++NumSceneQueries;
+
+	if (AsyncInput != nullptr)
+	{
+		const FKPCAsyncCollisionPrimitive* Primitive = AsyncInput->CollisionPrimitives.FindByPredicate([&Hit](const FKPCAsyncCollisionPrimitive& It)
+			{
+				return ((It.ComponentHandle.HasSameIndexAndSerialNumber(Hit.Component)) && (It.Item == Hit.Item));
+			});
+		return ((Primitive != nullptr) && (UCollisionLibrary::ComputePenetrationAgainstParticle_Internal(OutDirection, OutDepth, Location, Rotation, Shape, Primitive->Particle)));
+	}
+
+	UPrimitiveComponent* Primitive = Hit.GetComponent();
+	FMTDResult MTD = {};
+	if ((Primitive == nullptr) || (!Primitive->ComputePenetration(MTD, Shape, Location, Rotation)))
+	{
+		return false;
+	}
+
+	OutDirection = MTD.Direction;
+	OutDepth = static_cast<double>(MTD.Distance);
+	return true;
+}
+
+void UCharacterPawnMovementComponent::GatherCollisionNeighbourhood(float DeltaTime)
+{
+	bHasCollisionNeighbourhood = false;
+	CollisionNeighbourhood.Reset();
+	CollisionNeighbourhoodShapes.Reset();
+	// The physics thread tests the bodies gathered with its input instead.
+	if ((!bUseCollisionNeighbourhoodCache) || (AsyncInput != nullptr))
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_KPCNeighbourhoodGather);
+
+	const FCollisionShape MovementShape = GetMovementCollisionShape();
+	const bool bAnalyticShapes = ((bUseAnalyticCollision) && (!Settings->MovementTraceComplex) && (!MovementShape.IsBox()));
+	CollisionNeighbourhoodBounds = CalculateCollisionNeighbourhoodBounds(GetUpdatedComponentLocation(), GetSimulatedVelocity(), DeltaTime);
+
+	++NumSceneQueries;
+	OverlapResultScratch.Reset();
+	World->OverlapMultiByChannel(OverlapResultScratch, CollisionNeighbourhoodBounds.GetCenter(), FQuat::Identity, Settings->MovementTraceChannel,
+		FCollisionShape::MakeBox(CollisionNeighbourhoodBounds.GetExtent()), MovementCollisionQueryParams);
+
+	for (const FOverlapResult& Overlap : OverlapResultScratch)
+	{
+		UPrimitiveComponent* Primitive = Overlap.GetComponent();
+		if ((Primitive == nullptr) || (Primitive->GetCollisionResponseToChannel(Settings->MovementTraceChannel) != ECollisionResponse::ECR_Block))
 		{
-			break;
+			continue;
 		}
 
-		// Sweep displacement.
-		if (!DepenetrateAndSweep(Hit,
-			RemainingDisplacement,
-			CurrentMovementCollisionLocation,
-			MovementCollisionRotation,
-			MovementCollisionShape))
+		// Instanced primitives keep a body per instance that component queries do not test, so the neighbourhood can not stand in for the world.
+		if (Primitive->IsA<UInstancedStaticMeshComponent>())
 		{
-			CurrentMovementCollisionLocation = Hit.TraceEnd;
-			RemainingDisplacement = FVector::ZeroVector;
-			break;
+			CollisionNeighbourhood.Reset();
+			CollisionNeighbourhoodShapes.Reset();
+			return;
 		}
 
-		// Stuck?
-		if (Hit.bStartPenetrating)
+		if (!CollisionNeighbourhood.Contains(Primitive))
 		{
-			RemainingDisplacement = FVector::ZeroVector;
-			continue;
+			CollisionNeighbourhood.Add(Primitive);
+			FKPCAnalyticShape& AnalyticShape = CollisionNeighbourhoodShapes.AddDefaulted_GetRef();
+			if (bAnalyticShapes)
+			{
+				UCollisionLibrary::MakeAnalyticShape(Primitive, AnalyticShape);
+			}
 		}
+	}
 
-		// Update location.
-		CurrentMovementCollisionLocation = Hit.TraceStart + PullBackMovement(Hit.Location - Hit.TraceStart);
+	bHasCollisionNeighbourhood = true;
+	INC_DWORD_STAT_BY(STAT_KPCNeighbourhoodPrimitives, CollisionNeighbourhood.Num());
+}
 
-		// Do not slide on ceilings.
-		if (Hit.ImpactPoint.Z > CurrentMovementCollisionLocation.Z)
+FBox UCharacterPawnMovementComponent::CalculateCollisionNeighbourhoodBounds(const FVector& Location, const FVector& Velocity, float DeltaTime) const
+{
+	// Cover the shape, the distance the pawn can travel in the time and the distances the ground probes, step ups and ledge checks reach beyond the shape.
+	const double ShapeRadius = GetMovementCollisionShape().GetExtent().Size();
+	const double HorizontalReach = (FMath::Max(Velocity.Size2D(), static_cast<double>(Settings->MaxWalkSpeed)) * static_cast<double>(DeltaTime)) +
+		static_cast<double>(Settings->DetermineGroundedSampleMod);
+	const double VerticalReach = (FMath::Abs(Velocity.Z) + (FMath::Abs(static_cast<double>(CalculateGravity())) * static_cast<double>(DeltaTime))) *
+		static_cast<double>(DeltaTime);
+	const double DownReach = FMath::Max3(static_cast<double>(Settings->DetermineGroundedDistance), static_cast<double>(Settings->LedgeSearchDistance), static_cast<double>(Settings->MaxStepHeight));
+	const double Padding = static_cast<double>(CollisionNeighbourhoodPadding);
+
+	return FBox(
+		Location - FVector(ShapeRadius + HorizontalReach + Padding, ShapeRadius + HorizontalReach + Padding, ShapeRadius + VerticalReach + DownReach + Padding),
+		Location + FVector(ShapeRadius + HorizontalReach + Padding, ShapeRadius + HorizontalReach + Padding, ShapeRadius + VerticalReach + Settings->MaxStepHeight + Padding));
+}
+
+void UCharacterPawnMovementComponent::GatherAsyncCollisionPrimitives(FKPCAsyncMovementInputEntry& OutInput)
+{
+	check(IsInGameThread());
+	SCOPE_CYCLE_COUNTER(STAT_KPCNeighbourhoodGather);
+
+	// Physics steps keep simulating with this input until the next one arrives, so cover two game thread frames in case of a hitch.
+	OutInput.CollisionPrimitives.Reset();
+	OutInput.CollisionBounds = CalculateCollisionNeighbourhoodBounds(UpdatedComponent->GetComponentLocation(), AsyncVelocity, World->GetDeltaSeconds() * 2.0f);
+
+	OverlapResultScratch.Reset();
+	World->OverlapMultiByChannel(OverlapResultScratch, OutInput.CollisionBounds.GetCenter(), FQuat::Identity, Settings->MovementTraceChannel,
+		FCollisionShape::MakeBox(OutInput.CollisionBounds.GetExtent()), MovementCollisionQueryParams);
+
+	for (const FOverlapResult& Overlap : OverlapResultScratch)
+	{
+		UPrimitiveComponent* Primitive = Overlap.GetComponent();
+		if ((Primitive == nullptr) || (Primitive->GetCollisionResponseToChannel(Settings->MovementTraceChannel) != ECollisionResponse::ECR_Block))
 		{
-			RemainingDisplacement = FVector::ZeroVector;
-			// Zero out vertical velocity for the next frame.
-			InitialVerticalVelocityWalking = FVector::ZeroVector;
-			break;
+			continue;
 		}
 
-		// Do not slide on walkable surfaces and generate landed event.
-		if (IsWalkableSurface(Hit.ImpactNormal))
+		// Instanced primitives keep a particle per instance, selected by the overlap's item.
+		const FBodyInstance* BodyInstance = Primitive->GetBodyInstance(NAME_None, true, Overlap.ItemIndex);
+		const FPhysicsActorHandle Particle = (BodyInstance != nullptr) ? BodyInstance->GetPhysicsActorHandle() : nullptr;
+		if ((Particle == nullptr) || (OutInput.CollisionPrimitives.ContainsByPredicate([Particle](const FKPCAsyncCollisionPrimitive& It) { return (It.Particle == Particle); })))
 		{
-			RemainingDisplacement = FVector::ZeroVector;
-			// Zero out vertical velocity for the next frame.
-			InitialVerticalVelocityWalking = FVector::ZeroVector;
+			continue;
+		}
 
-			OnLandedWalking();
+		OutInput.CollisionPrimitives.Add({ Primitive, Primitive, Primitive->GetOwner(), Overlap.ItemIndex, Particle, (Primitive->Mobility == EComponentMobility::Movable) });
+	}
 
-			break;
+	INC_DWORD_STAT_BY(STAT_KPCNeighbourhoodPrimitives, OutInput.CollisionPrimitives.Num());
+}
+
+bool UCharacterPawnMovementComponent::SweepAsyncCollision(FHitResult& OutHit, const FVector& Start, const FVector& End, const FQuat& Rotation,
+	const FCollisionShape& Shape) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_KPCNeighbourhoodQueries);
+	CheckAsyncCollisionBounds(Start, End, Shape.GetExtent().Size());
+
+	// Keep the closest hit. Hits that start penetrating are at time zero so are always the closest.
+	OutHit = FHitResult(Start, End);
+	FHitResult Hit;
+	for (const FKPCAsyncCollisionPrimitive& Primitive : AsyncInput->CollisionPrimitives)
+	{
+		if ((UCollisionLibrary::SweepShapeAgainstParticle_Internal(Hit, Start, End, Rotation, Shape, Primitive.Particle)) && ((!OutHit.bBlockingHit) || (Hit.Time < OutHit.Time)))
+		{
+			OutHit = Hit;
+			OutHit.Component = Primitive.Component;
+			OutHit.HitObjectHandle = FActorInstanceHandle(Primitive.Owner);
+			OutHit.Item = Primitive.Item;
+		}
+	}
+	return OutHit.bBlockingHit;
+}
+
+bool UCharacterPawnMovementComponent::SweepMultiAsyncCollision(TArray<FHitResult>& OutHits, const FVector& Start, const FVector& End, const FQuat& Rotation,
+	const FCollisionShape& Shape) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_KPCNeighbourhoodQueries);
+	CheckAsyncCollisionBounds(Start, End, Shape.GetExtent().Size());
+
+	// Match the world query, every primitive the shape starts in and then the closest blocking hit last.
+	OutHits.Reset();
+	FHitResult ClosestHit(Start, End);
+	FHitResult Hit;
+	for (const FKPCAsyncCollisionPrimitive& Primitive : AsyncInput->CollisionPrimitives)
+	{
+		if (!UCollisionLibrary::SweepShapeAgainstParticle_Internal(Hit, Start, End, Rotation, Shape, Primitive.Particle))
+		{
+			continue;
 		}
 
-		// Update remaining displacement.
-		RemainingDisplacement = FVector::VectorPlaneProject(RemainingDisplacement * (1.0 - static_cast<double>(Hit.Time)), Hit.Normal);
+		Hit.Component = Primitive.Component;
+		Hit.HitObjectHandle = FActorInstanceHandle(Primitive.Owner);
+		Hit.Item = Primitive.Item;
+		if (Hit.bStartPenetrating)
+		{
+			OutHits.Add(Hit);
+		}
+		else if ((!ClosestHit.bBlockingHit) || (Hit.Time < ClosestHit.Time))
+		{
+			ClosestHit = Hit;
+		}
 	}
 
-	UpdatedComponent->SetWorldLocation(CurrentMovementCollisionLocation);
+	if (ClosestHit.bBlockingHit)
+	{
+		OutHits.Add(ClosestHit);
+	}
+	return (OutHits.Num() > 0);
 }
 
-bool UCharacterPawnMovementComponent::IsWalkableSurface(const FVector& SurfaceNormal) const
+bool UCharacterPawnMovementComponent::LineTraceAsyncCollision(FHitResult& OutHit, const FVector& Start, const FVector& End) const
 {
-	return (UMathUtilityLibrary::VectorAngleDegrees(SurfaceNormal, FVector::UpVector) <= static_cast<double>(MaxWalkableSlopeAngle));
+	SCOPE_CYCLE_COUNTER(STAT_KPCNeighbourhoodQueries);
+	CheckAsyncCollisionBounds(Start, End, 0.0);
+
+	OutHit = FHitResult(Start, End);
+	FHitResult Hit;
+	for (const FKPCAsyncCollisionPrimitive& Primitive : AsyncInput->CollisionPrimitives)
+	{
+		if ((UCollisionLibrary::LineTraceAgainstParticle_Internal(Hit, Start, End, Primitive.Particle)) && ((!OutHit.bBlockingHit) || (Hit.Time < OutHit.Time)))
+		{
+			OutHit = Hit;
+			OutHit.Component = Primitive.Component;
+			OutHit.HitObjectHandle = FActorInstanceHandle(Primitive.Owner);
+			OutHit.Item = Primitive.Item;
+		}
+	}
+	return OutHit.bBlockingHit;
 }
 
-FVector UCharacterPawnMovementComponent::FindStepSurfaceNormalFromCollision(const FHitResult& Hit)
+void UCharacterPawnMovementComponent::CheckAsyncCollisionBounds(const FVector& Start, const FVector& End, double QueryRadius) const
 {
-	FHitResult SlopeHit = {};
-	World->SweepSingleByChannel(SlopeHit,
-		Hit.ImpactPoint + FVector(0.0, 0.0, 1.0),
-		Hit.ImpactPoint - FVector(0.0, 0.0, 0.01),
-		FQuat::Identity,
-		MovementTraceChannel,
-		FCollisionShape::MakeSphere(0.25f),
-		MovementCollisionQueryParams);
+	// Bodies outside the gathered bounds are not tested. The bounds cover two frames of movement so this only happens on long hitches or teleports.
+	const FBox QueryBounds = FBox(Start.ComponentMin(End) - FVector(QueryRadius), Start.ComponentMax(End) + FVector(QueryRadius));
+	if (!AsyncInput->CollisionBounds.IsInsideOrOn(QueryBounds.Min) || !AsyncInput->CollisionBounds.IsInsideOrOn(QueryBounds.Max))
+	{
+		INC_DWORD_STAT(STAT_KPCAsyncCollisionOverruns);
+	}
+}
 
-	return SlopeHit.ImpactNormal;
+const FKPCAsyncCollisionPrimitive* UCharacterPawnMovementComponent::FindAsyncCollisionPrimitive(const UPrimitiveComponent* Primitive) const
+{
+	return AsyncInput->CollisionPrimitives.FindByPredicate([Primitive](const FKPCAsyncCollisionPrimitive& It) { return (It.Component == Primitive); });
 }
 
-FHitResult UCharacterPawnMovementComponent::FindGroundHit(const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation) const
+bool UCharacterPawnMovementComponent::SweepCollisionNeighbourhood(FHitResult& OutHit, bool& bOutBlockingHit, const FVector& Start, const FVector& End,
+	const FQuat& Rotation, const FCollisionShape& Shape) const
 {
-	// Get the center bottom location of the collision shape.
-	FVector CenterBottomLocation(MovementCollisionLocation.X,
-		MovementCollisionLocation.Y,
-		UCollisionLibrary::GetLowestPointOnShape(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation, FVector::UpVector).Z);
+	if (!bHasCollisionNeighbourhood)
+	{
+		return false;
+	}
 
-	// Get four more points extending from the center bottom location to use as ground sample points.
-	FVector SampleLocations[4] =
+	const double QueryRadius = Shape.GetExtent().Size();
+	if (!IsInCollisionNeighbourhood(Start, Start, QueryRadius))
 	{
-		CenterBottomLocation + (UpdatedComponent->GetForwardVector() * static_cast<double>(DetermineGroundedSampleMod)),
-		CenterBottomLocation - (UpdatedComponent->GetForwardVector() * static_cast<double>(DetermineGroundedSampleMod)),
-		CenterBottomLocation + (UpdatedComponent->GetRightVector() * static_cast<double>(DetermineGroundedSampleMod)),
-		CenterBottomLocation - (UpdatedComponent->GetRightVector() * static_cast<double>(DetermineGroundedSampleMod))
-	};
+		INC_DWORD_STAT(STAT_KPCNeighbourhoodFallbacks);
+		return false;
+	}
 
-	// Trace from the center bottom location and additional four locations to search for ground.
-	FVector Offset = (FVector::UpVector * static_cast<double>(DetermineGroundedOffset));
-	FVector TraceDelta = (FVector::DownVector * static_cast<double>(DetermineGroundedDistance));
+	SCOPE_CYCLE_COUNTER(STAT_KPCNeighbourhoodQueries);
 
-	//DrawDebugSphere(World, CenterBottomLocation + Offset, 2.5f, 12, FColor::Red);
-	//DrawDebugSphere(World, CenterBottomLocation + TraceDelta, 2.5f, 12, FColor::Green);
-	//for (int8 i = 0; i < 4; ++i)
-	//{
-	//	DrawDebugSphere(World, SampleLocations[i] + Offset, 2.5f, 12, FColor::Red);
-	//	DrawDebugSphere(World, SampleLocations[i] + TraceDelta, 2.5f, 12, FColor::Green);
-	//}
+	// Keep the earliest hit across every primitive.
+	// Spheres are capsules without an axis. Box sweeps always use physics queries.
+	const bool bAnalyticQuery = !Shape.IsBox();
+	const float CapsuleRadius = (Shape.IsCapsule()) ? Shape.GetCapsuleRadius() : Shape.GetSphereRadius();
+	const float CapsuleHalfLength = (Shape.IsCapsule()) ? Shape.GetCapsuleAxisHalfLength() : 0.0f;
 
+	FHitResult ClosestHit = {};
+	ClosestHit.Init(Start, End);
+	bool bBlockingHit = false;
 	FHitResult Hit = {};
-	if (!World->LineTraceSingleByChannel(Hit,
-		CenterBottomLocation + Offset,
-		CenterBottomLocation + TraceDelta,
-		MovementTraceChannel,
-		MovementCollisionQueryParams))
+	for (int32 PrimitiveIndex = 0; PrimitiveIndex < CollisionNeighbourhood.Num(); ++PrimitiveIndex)
 	{
-		for (int8 i = 0; i < 4; ++i)
+		UPrimitiveComponent* Primitive = CollisionNeighbourhood[PrimitiveIndex];
+		const FKPCAnalyticShape& AnalyticShape = CollisionNeighbourhoodShapes[PrimitiveIndex];
+
+		// Sweeps the analytic kernels can not resolve are repeated with a physics sweep.
+		EKPCAnalyticSweepResult AnalyticResult = EKPCAnalyticSweepResult::Unresolved;
+		Hit.Init(Start, End);
+		if ((bAnalyticQuery) && (AnalyticShape.Type != EKPCAnalyticShapeType::None))
 		{
-			Hit.Init();
-			if (World->LineTraceSingleByChannel(Hit,
-				SampleLocations[i] + Offset,
-				SampleLocations[i] + TraceDelta,
-				MovementTraceChannel,
-				MovementCollisionQueryParams))
+			AnalyticResult = UCollisionLibrary::SweepCapsuleAgainstShape(Hit, Start, End, Rotation, CapsuleRadius, CapsuleHalfLength, AnalyticShape);
+			if (AnalyticResult == EKPCAnalyticSweepResult::Hit)
 			{
-				break;
+				Hit.Component = Primitive;
+				Hit.HitObjectHandle = FActorInstanceHandle(Primitive->GetOwner());
 			}
 		}
-	}
 
-	if (Hit.bBlockingHit)
-	{
-		//DrawDebugSphere(World, Hit.ImpactPoint, 5.0f, 16, FColor::Blue);
+		bool bHit = (AnalyticResult == EKPCAnalyticSweepResult::Hit);
+		if (AnalyticResult == EKPCAnalyticSweepResult::Unresolved)
+		{
+			Hit.Init(Start, End);
+			bHit = Primitive->SweepComponent(Hit, Start, End, Rotation, Shape, Settings->MovementTraceComplex);
+		}
 
-		return Hit;
+		if ((bHit) && ((!bBlockingHit) || (Hit.Time < ClosestHit.Time)))
+		{
+			ClosestHit = Hit;
+			bBlockingHit = true;
+		}
 	}
 
-	// Fallback on shape cast if sample points fail to find ground collision. The pawn may still be grounded especially if the movement collision is longer than it is tall.
-	//UCollisionLibrary::DrawDebugShape(World, MovementCollisionLocation, MovementCollisionShape, MovementCollisionRotation, FColor::Red);
-	//UCollisionLibrary::DrawDebugShape(World, MovementCollisionLocation + TraceDelta, MovementCollisionShape, MovementCollisionRotation, FColor::Green);
-
-	Hit.Init();
-	if (World->SweepSingleByChannel(Hit,
-		MovementCollisionLocation,
-		MovementCollisionLocation + TraceDelta,
-		MovementCollisionRotation,
-		MovementTraceChannel,
-		MovementCollisionShape,
-		MovementCollisionQueryParams))
+	// Anything the sweep could hit before the point it stopped at lies within the neighbourhood, so the result is exact as long as that point is inside it.
+	if (!IsInCollisionNeighbourhood(Start, (bBlockingHit) ? ClosestHit.Location : End, QueryRadius))
 	{
-		//UCollisionLibrary::DrawDebugShape(World, Hit.Location, MovementCollisionShape, MovementCollisionRotation, FColor::Blue);
-
-		return Hit;
+		INC_DWORD_STAT(STAT_KPCNeighbourhoodFallbacks);
+		return false;
 	}
 
-	Hit.Init();
-	return Hit;
+	INC_DWORD_STAT(STAT_KPCNeighbourhoodHits);
+	ClosestHit.bBlockingHit = bBlockingHit;
+	OutHit = ClosestHit;
+	bOutBlockingHit = bBlockingHit;
+	return true;
 }
 
-FVector UCharacterPawnMovementComponent::FindGroundSurfaceNormal(const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation, const FCollisionShape& MovementCollisionShape)
+bool UCharacterPawnMovementComponent::LineTraceCollisionNeighbourhood(FHitResult& OutHit, bool& bOutBlockingHit, const FVector& Start, const FVector& End) const
 {
-	FHitResult Hit = FindGroundHit(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation);
-	if (IsWalkableSurface(Hit.ImpactNormal))
+	if (!bHasCollisionNeighbourhood)
 	{
-		return Hit.ImpactNormal;
+		return false;
 	}
-	return FVector::ZeroVector;
-}
-
-void UCharacterPawnMovementComponent::UpdateComponentAttachment(const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation)
-{
-	// Check for walkable surfaces below the pawn and attach the updated component to it if one is found. This is to support sticking to walkable moving geometry such as an elevator or 
-	// moving platform.
-	FHitResult Hit = FindGroundHit(MovementCollisionShape, MovementCollisionLocation, MovementCollisionRotation);
 
-	if ((!Hit.bBlockingHit) || (!IsWalkableSurface(Hit.ImpactNormal)))
+	if (!IsInCollisionNeighbourhood(Start, Start, 0.0))
 	{
-		UpdatedComponent->DetachFromComponent(FDetachmentTransformRules(EDetachmentRule::KeepWorld, false));
-		return;
+		INC_DWORD_STAT(STAT_KPCNeighbourhoodFallbacks);
+		return false;
 	}
 
-	UpdatedComponent->AttachToComponent(Hit.Component.Get(), FAttachmentTransformRules(EAttachmentRule::KeepWorld, false));
-}
+	SCOPE_CYCLE_COUNTER(STAT_KPCNeighbourhoodQueries);
 
-FVector UCharacterPawnMovementComponent::AdjustDepenetrationNormalWalking(FVector Normal, const FVector& ImpactNormal)
-{
-	return ((IsWalkableSurface(ImpactNormal)) ? FVector::UpVector : Normal);
-}
+	FHitResult ClosestHit = {};
+	ClosestHit.Init(Start, End);
+	bool bBlockingHit = false;
+	FHitResult Hit = {};
+	for (UPrimitiveComponent* Primitive : CollisionNeighbourhood)
+	{
+		Hit.Init(Start, End);
+		if ((Primitive->LineTraceComponent(Hit, Start, End, MovementCollisionQueryParams)) && ((!bBlockingHit) || (Hit.Time < ClosestHit.Time)))
+		{
+			ClosestHit = Hit;
+			bBlockingHit = true;
+		}
+	}
 
-void UCharacterPawnMovementComponent::ApplyRootMotionRotationWalking(const FQuat& Rotation)
-{
-	// Remove pitch and roll rotation components in walking mode.
-	UpdatedComponent->AddWorldRotation(FRotator(0.0, RootMotionMovementParams.GetRootMotionTransform().GetRotation().Rotator().Yaw, 0.0));
-}
+	if (!IsInCollisionNeighbourhood(Start, (bBlockingHit) ? ClosestHit.Location : End, 0.0))
+	{
+		INC_DWORD_STAT(STAT_KPCNeighbourhoodFallbacks);
+		return false;
+	}
 
-FRotator UCharacterPawnMovementComponent::GetMovementOrientationWalking()
-{
-	return InitialHorizontalVelocityWalking.ToOrientationRotator();
+	INC_DWORD_STAT(STAT_KPCNeighbourhoodHits);
+	ClosestHit.bBlockingHit = bBlockingHit;
+	OutHit = ClosestHit;
+	bOutBlockingHit = bBlockingHit;
+	return true;
 }
 
-void UCharacterPawnMovementComponent::ApplyVerticalForceWalking(float Force)
+bool UCharacterPawnMovementComponent::IsInCollisionNeighbourhood(const FVector& Start, const FVector& End, double QueryRadius) const
 {
-	InitialVerticalVelocityWalking = FVector::ZeroVector; // Remove this line to make the pawn need to overcome any existing vertical velocity with the added force.
-
-	// Displacement initial is square root of -2 multiplied by acceleration multiplied by displacement. Vf^2 = Vi^2 + 2ad rearranged for Vi when Vf is 0 (the apex of the jump).
-	// The true equation would be FMath::Sqrt(-2.0 * ScaledPawnGravity * JumpHeightInCm).
-	// Use world gravity Z unscaled by character pawn movement component's gravity scale here to allow the character pawn to be able to jump when gravity scale is set to 0.
-	// Not mathematically correct but the displacement value (jump height) acts as a jump force/strength value.
-	InitialVerticalVelocityWalking += FVector::UpVector * FMath::Sqrt(-2.0 * static_cast<double>(World->GetGravityZ()) * static_cast<double>(Force));
+	const FBox QueryBounds = (FBox(Start, Start) + End).ExpandBy(QueryRadius);
+	return CollisionNeighbourhoodBounds.IsInside(QueryBounds);
 }
 
-FVector UCharacterPawnMovementComponent::GetVelocityWalking() const
+bool UCharacterPawnMovementComponent::ShouldUseNetworkPrediction() const
 {
-	return InitialHorizontalVelocityWalking + InitialVerticalVelocityWalking;
+	return ((bUseNetworkPrediction) && (GetNetMode() != NM_Standalone));
 }
 
-void UCharacterPawnMovementComponent::OnLandedWalking()
+void UCharacterPawnMovementComponent::TickAutonomousProxy(float DeltaTime)
 {
-	if (bRemoveVelocityOnLand)
+	// Simulate with the quantized input and delta time the server will simulate the move with.
+	FKPCSavedMove Move = {};
+	Move.MoveId = NextMoveId++;
+	Move.DeltaTime = FMath::Min(DeltaTime, MaxMoveDeltaTime);
+	Move.InputDirection = FKPCMovementRecording::QuantizeInputDirection(HotState->InputDirection);
+	Move.InputScale = FKPCMovementRecording::QuantizeInputScale(HotState->InputScale);
+	Move.bJump = bPendingJump;
+	bPendingJump = false;
+
+	HotState->InputDirection = Move.InputDirection;
+	HotState->InputScale = Move.InputScale;
+	TickMovement(Move.DeltaTime);
+
+	Move.Location = UpdatedComponent->GetComponentLocation();
+	Move.Velocity = GetVelocity();
+	AddSavedMove(Move);
+
+	++NumUnsentMoves;
+
+	// Batch moves to keep the packet rate independent of frame rate. Send jumps immediately to keep their latency low.
+	TimeSinceLastMoveSend += DeltaTime;
+	if ((TimeSinceLastMoveSend >= (1.0f / ClientMoveSendRate)) || (NumUnsentMoves >= MaxMovesPerPacket) || (Move.bJump))
 	{
-		// Remove any remaining horizontal velocity to stop the pawn having to brake to a stop after landing when there is no movement input.
-		if (MovementInputScale < 0.01)
-		{
-			InitialHorizontalVelocityWalking = FVector::ZeroVector;
-		}
+		SendPendingMoves();
 	}
 }
 
-bool UCharacterPawnMovementComponent::DepenetrateAndSweep(FHitResult& OutHit, const FVector& Displacement, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation,
-	const FCollisionShape& MovementCollisionShape)
+void UCharacterPawnMovementComponent::SendPendingMoves()
 {
-	HitResultScratch.Reset();
-
-	// Sweep with inflated skin.
-	const bool bSkinHit = World->SweepMultiByChannel(HitResultScratch,
-		MovementCollisionLocation,
-		MovementCollisionLocation + Displacement,
-		MovementCollisionRotation,
-		MovementTraceChannel,
-		UCollisionLibrary::InflateShape(MovementCollisionShape, SweepShapeInflationAmount),
-		MovementCollisionQueryParams);
-
-	if (!bSkinHit)
+	if (NumUnsentMoves == 0)
 	{
-		OutHit.Init();
-		OutHit.TraceStart = MovementCollisionLocation;
-		OutHit.TraceEnd = MovementCollisionLocation + Displacement;
-		OutHit.Location = MovementCollisionLocation + Displacement;
-		OutHit.Time = 1.0f;
-		return false;
+		return;
 	}
 
-	// Have initial overlaps?
-	int32 NumInitialOverlaps = 0;
-	for (const FHitResult& It : HitResultScratch)
+	// Moves are sent unreliably, so send every unacknowledged move that fits in the packet and not only the new ones. The newest moves are always sent.
+	int32 FirstMove = NumSavedMoves;
+	while ((FirstMove > 0) && (NumSavedMoves - FirstMove < MaxMovesPerPacket) && (GetSavedMove(FirstMove - 1).MoveId > LastAcknowledgedMoveId))
 	{
-		if (It.bStartPenetrating)
-		{
-			++NumInitialOverlaps;
-		}
+		--FirstMove;
 	}
-	if (NumInitialOverlaps == 0)
+
+	NetMoveScratch.Reset();
+	for (int32 i = FirstMove; i < NumSavedMoves; ++i)
 	{
-		OutHit = HitResultScratch.Last();
-		return bSkinHit;
+		const FKPCSavedMove& Move = GetSavedMove(i);
+		FKPCNetMove& NetMove = NetMoveScratch.AddDefaulted_GetRef();
+		NetMove.DeltaTime = Move.DeltaTime;
+		NetMove.InputYaw = FKPCMovementRecording::CompressInputDirection(Move.InputDirection);
+		NetMove.InputScale = FKPCMovementRecording::CompressInputScale(Move.InputScale);
+		NetMove.Flags = ((Move.bJump) ? KPCNetMove_Jump : 0) | ((Move.InputDirection.IsNearlyZero()) ? KPCNetMove_ZeroInputDirection : 0);
 	}
 
-	// Iteratively resolve penetration.
-	FVector Fixup(0.0);
-	for (int32 i = 0; i < MaxPenetrationResolutionIterations; ++i)
+	if (!NetMoveScratch.IsEmpty())
 	{
-		double ErrorSum = 0.0;
-		for (const FHitResult& It : HitResultScratch)
-		{
-			if (It.bStartPenetrating)
-			{
-				// Take the dot product of the fixup and the normal to determine how much of the penetration has already been taken care of.
-				const double Error = FMath::Max(0.0, (It.PenetrationDepth + static_cast<double>(AdditionalDepenetrationDistance)) - (FVector::DotProduct(Fixup, It.Normal)));
-				ErrorSum += Error;
-				Fixup += Error * It.Normal;
-			}
-		}
-		// Stop iterating if a solution has been found.
-		if (ErrorSum < UE_DOUBLE_KINDA_SMALL_NUMBER)
-		{
-			break;
-		}
+		ServerMoveBatch(GetSavedMove(FirstMove).MoveId, NetMoveScratch, UpdatedComponent->GetComponentLocation());
 	}
-
-	// Resweep from new start.
-	return World->SweepSingleByChannel(OutHit, MovementCollisionLocation + Fixup, MovementCollisionLocation + Fixup + Displacement, MovementCollisionRotation,
-		MovementTraceChannel, MovementCollisionShape, MovementCollisionQueryParams);
+	NumUnsentMoves = 0;
+	TimeSinceLastMoveSend = 0.0f;
 }
 
-void UCharacterPawnMovementComponent::MoveOutOfCollision(const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation, const FCollisionShape& MovementCollisionShape)
+void UCharacterPawnMovementComponent::AddSavedMove(const FKPCSavedMove& Move)
 {
-	HitResultScratch.Reset();
-
-	// Sweep forwards a small distance.
-	if (!World->SweepMultiByChannel(HitResultScratch,
-		MovementCollisionLocation,
-		MovementCollisionLocation + (UpdatedComponent->GetForwardVector() * 0.01),
-		MovementCollisionRotation,
-		MovementTraceChannel,
-		MovementCollisionShape,
-		MovementCollisionQueryParams))
+	if (SavedMoves.IsEmpty())
 	{
 		return;
 	}
 
-	// Have initial overlaps?
-	int32 NumInitialOverlaps = 0;
-	for (const FHitResult& It : HitResultScratch)
+	// Drop the oldest move when full. The server will correct the client if it is needed to replay.
+	if (NumSavedMoves == SavedMoves.Num())
 	{
-		if (It.bStartPenetrating)
-		{
-			++NumInitialOverlaps;
-		}
+		FirstSavedMove = (FirstSavedMove + 1) % SavedMoves.Num();
+		--NumSavedMoves;
 	}
-	if (NumInitialOverlaps == 0)
+
+	++NumSavedMoves;
+	GetSavedMove(NumSavedMoves - 1) = Move;
+}
+
+void UCharacterPawnMovementComponent::DiscardSavedMovesUpTo(int32 MoveId)
+{
+	while ((NumSavedMoves > 0) && (GetSavedMove(0).MoveId <= MoveId))
 	{
-		return;
+		FirstSavedMove = (FirstSavedMove + 1) % SavedMoves.Num();
+		--NumSavedMoves;
 	}
+}
+
+void UCharacterPawnMovementComponent::ReplaySavedMoves()
+{
+	bReplayingSavedMoves = true;
 
-	// Iteratively resolve penetration.
-	FVector Fixup(0.0);
-	for (int32 i = 0; i < MaxPenetrationResolutionIterations; ++i)
+	for (int32 i = 0; i < NumSavedMoves; ++i)
 	{
-		double ErrorSum = 0.0;
-		for (const FHitResult& It : HitResultScratch)
+		FKPCSavedMove& Move = GetSavedMove(i);
+		if (Move.bJump)
 		{
-			if (It.bStartPenetrating)
-			{
-				FVector Normal = It.Normal;
+			Jump();
+		}
 
-				switch (MovementMode)
-				{
-				case EKPCMovementMode::Walking: Normal = AdjustDepenetrationNormalWalking(Normal, It.ImpactNormal); break;
-				}
+		HotState->InputDirection = Move.InputDirection;
+		HotState->InputScale = Move.InputScale;
+		TickMovement(Move.DeltaTime);
 
-				// Take the dot product of the fixup and the normal to determine how much of the penetration has already been taken care of.
-				const double Error = FMath::Max(0.0, (It.PenetrationDepth + static_cast<double>(AdditionalDepenetrationDistance)) - (FVector::DotProduct(Fixup, Normal)));
-				ErrorSum += Error;
-				Fixup += Error * Normal;
-			}
-		}
-		// Stop iterating if a solution has been found.
-		if (ErrorSum < UE_DOUBLE_KINDA_SMALL_NUMBER)
-		{
-			break;
-		}
+		Move.Location = UpdatedComponent->GetComponentLocation();
+		Move.Velocity = GetVelocity();
 	}
 
-	UpdatedComponent->SetWorldLocation(MovementCollisionLocation + Fixup);
-}
-
-double UCharacterPawnMovementComponent::CalculateOrientRotationComponentDelta(double Current, double Target, float DeltaTime, float Speed)
-{
-	const double Dist = static_cast<double>((((FMath::TruncToInt(Target - Current)) + 540) % 360) - 180);
-	const double Step = static_cast<double>(DeltaTime) * static_cast<double>(Speed);
-	return FMath::Clamp(Dist, -Step, Step);
+	bReplayingSavedMoves = false;
 }
 
-void UCharacterPawnMovementComponent::AddVerticalForce(float Force)
+void UCharacterPawnMovementComponent::ServerMoveBatch_Implementation(int32 FirstMoveId, const TArray<FKPCNetMove>& Moves, FVector_NetQuantize100 ClientLocation)
 {
-	switch (MovementMode)
+	// The client never sends more moves than this in a single batch.
+	if (Moves.Num() > MaxMovesPerPacket)
 	{
-	case EKPCMovementMode::Walking: ApplyVerticalForceWalking(Force); break;
+		return;
 	}
-}
 
-FVector UCharacterPawnMovementComponent::GetVelocity() const
-{
-	switch (MovementMode)
+	// Take the time that has passed on the server since the last batch off the time the client is ahead.
+	const double ServerTime = World->GetTimeSeconds();
+	if (LastServerMoveBatchTime >= 0.0)
 	{
-	case EKPCMovementMode::Walking: return GetVelocityWalking();
+		ClientMoveTimeAhead = FMath::Max(ClientMoveTimeAhead - static_cast<float>(ServerTime - LastServerMoveBatchTime), -MaxClientMoveTimeAhead);
 	}
-	return FVector::ZeroVector;
-}
+	LastServerMoveBatchTime = ServerTime;
 
-void UCharacterPawnMovementComponent::UpdatePawnRotation(float DeltaTime)
-{
-	// If root motion is present rotate the pawn with root motion instead of movement input unless rotation from movement input has been requested.
-	if (HasRootMotion())
+	// Moves between the last one simulated and the batch were lost, along with every packet that resent them. They can not be simulated, so continue from the
+	// batch and correct the client to the server's state.
+	bool bForceCorrection = (FirstMoveId > LastProcessedMoveId + 1);
+
+	bool bProcessedMove = false;
+	for (int32 i = 0; i < Moves.Num(); ++i)
 	{
-		switch (MovementMode)
+		// Skip moves that have already been simulated.
+		const int32 MoveId = FirstMoveId + i;
+		if (MoveId <= LastProcessedMoveId)
 		{
-		case EKPCMovementMode::Walking: ApplyRootMotionRotationWalking(RootMotionMovementParams.GetRootMotionTransform().GetRotation()); break;
+			continue;
 		}
 
-		if (!bAllowMovementRotationDuringRootMotion)
+		// Never trust the client's delta time beyond the limit the client also simulates with.
+		const FKPCNetMove& Move = Moves[i];
+		const float MoveDeltaTime = (FMath::IsFinite(Move.DeltaTime)) ? FMath::Clamp(Move.DeltaTime, 0.0f, MaxMoveDeltaTime) : 0.0f;
+
+		// Leave moves that would put the client too far ahead of the server's clock. The client resends them until they are simulated.
+		if (ClientMoveTimeAhead + MoveDeltaTime > MaxClientMoveTimeAhead)
 		{
-			return;
+			bForceCorrection = true;
+			break;
+		}
+		ClientMoveTimeAhead += MoveDeltaTime;
+
+		if (Move.Flags & KPCNetMove_Jump)
+		{
+			Jump();
 		}
+
+		HotState->InputDirection = (Move.Flags & KPCNetMove_ZeroInputDirection) ? FVector::ZeroVector : FKPCMovementRecording::DecompressInputDirection(Move.InputYaw);
+		HotState->InputScale = FKPCMovementRecording::DecompressInputScale(Move.InputScale);
+
+		TickMovement(MoveDeltaTime);
+
+		LastProcessedMoveId = MoveId;
+		bProcessedMove = true;
 	}
 
-	if (!bOrientRotationToMovement)
+	if ((!bProcessedMove) && (!bForceCorrection))
 	{
 		return;
 	}
 
-	// Only orient rotation to movement when there is movement input.
-	if (!IsRequestingMovement())
+	// The client's location is after the last move of the batch, so it can only be compared when every move of the batch was simulated.
+	const FVector ServerLocation = UpdatedComponent->GetComponentLocation();
+	if ((bForceCorrection) || (FVector::DistSquared(ServerLocation, ClientLocation) > FMath::Square(static_cast<double>(MaxClientLocationError))))
 	{
-		return;
+		ClientCorrection(LastProcessedMoveId, ServerLocation, UpdatedComponent->GetComponentRotation(), GetVelocity(), FixedTimestepAccumulator);
 	}
-
-	FRotator CurrentRotation = UpdatedComponent->GetComponentRotation();
-
-	FRotator MovementOrientation(0.0);
-	switch (MovementMode)
+	else
 	{
-	case EKPCMovementMode::Walking: MovementOrientation = GetMovementOrientationWalking(); break;
+		ClientAckMove(LastProcessedMoveId);
 	}
-
-	FRotator NewRotation(((bOrientPitch) ? MovementOrientation.Pitch : CurrentRotation.Pitch),
-		((bOrientYaw) ? MovementOrientation.Yaw : CurrentRotation.Yaw),
-		((bOrientRoll) ? MovementOrientation.Roll : CurrentRotation.Roll));
-
-	UpdatedComponent->SetWorldRotation(FRotator(
-		CurrentRotation.Pitch + CalculateOrientRotationComponentDelta(CurrentRotation.Pitch, NewRotation.Pitch, DeltaTime, OrientRotationRate.Pitch),
-		CurrentRotation.Yaw + CalculateOrientRotationComponentDelta(CurrentRotation.Yaw, NewRotation.Yaw, DeltaTime, OrientRotationRate.Yaw),
-		CurrentRotation.Roll + CalculateOrientRotationComponentDelta(CurrentRotation.Roll, NewRotation.Roll, DeltaTime, OrientRotationRate.Roll)));
 }
 
-void UCharacterPawnMovementComponent::ClearMovementInput()
+void UCharacterPawnMovementComponent::ClientAckMove_Implementation(int32 MoveId)
 {
-	// Do not clear movement input direction as the last direction is used to update the pawn rotation when there is no movement input being added.
-	//MovementInputDirection = FVector::ZeroVector;
-
-	MovementInputScale = 0.0f;
+	LastAcknowledgedMoveId = FMath::Max(LastAcknowledgedMoveId, MoveId);
+	DiscardSavedMovesUpTo(MoveId);
 }
 
-bool UCharacterPawnMovementComponent::IsRequestingMovement()
+void UCharacterPawnMovementComponent::ClientCorrection_Implementation(int32 MoveId, FVector_NetQuantize100 Location, FRotator Rotation, FVector_NetQuantize10 Velocity,
+	float FixedTimestepTime)
 {
-	return (MovementInputScale > 0.0f);
-}
+	// Responses are unreliable and can arrive out of order. Ignore corrections older than a response that has already been handled.
+	if (MoveId <= LastAcknowledgedMoveId)
+	{
+		return;
+	}
+	LastAcknowledgedMoveId = MoveId;
 
-bool UCharacterPawnMovementComponent::HasRootMotion()
-{
-	return RootMotionMovementParams.bHasRootMotion;
+	DiscardSavedMovesUpTo(MoveId);
+	ResetMovementState(Location, Rotation.Quaternion(), Velocity, FixedTimestepTime);
+	ReplaySavedMoves();
 }
 
-FVector UCharacterPawnMovementComponent::PullBackMovement(const FVector& Movement)
+namespace KPCMovementRecordingCommands
 {
-	const double Distance = Movement.Length();
-	return (Distance > static_cast<double>(PullBackMovementEpsilon)) ? Movement * ((Distance - static_cast<double>(PullBackMovementEpsilon)) / Distance) : FVector(0.0);
+	static UCharacterPawnMovementComponent* GetLocalPlayerMovementComponent(UWorld* World)
+	{
+		ACharacterPawn* Pawn = Cast<ACharacterPawn>(UGameplayStatics::GetPlayerPawn(World, 0));
+		return (IsValid(Pawn)) ? Pawn->GetCharacterPawnMovementComponent() : nullptr;
+	}
+
+	static void StartRecording(const TArray<FString>& Args, UWorld* World)
+	{
+		if (UCharacterPawnMovementComponent* Movement = GetLocalPlayerMovementComponent(World))
+		{
+			Movement->StartRecording();
+			UE_LOG(LogKinematicPawn, Display, TEXT("Started recording movement."));
+		}
+	}
+
+	static void StopRecording(const TArray<FString>& Args, UWorld* World)
+	{
+		UCharacterPawnMovementComponent* Movement = GetLocalPlayerMovementComponent(World);
+		TUniquePtr<FKPCMovementRecording> Recording = (IsValid(Movement)) ? Movement->StopRecording() : nullptr;
+		if (!Recording.IsValid())
+		{
+			UE_LOG(LogKinematicPawn, Warning, TEXT("Movement is not being recorded."));
+			return;
+		}
+
+		const FString Path = (Args.Num() > 0) ? Args[0] :
+			FPaths::ProjectSavedDir() / TEXT("MovementRecordings") / (FDateTime::Now().ToString() + TEXT(".kpcr"));
+		if (Recording->SaveToFile(Path))
+		{
+			UE_LOG(LogKinematicPawn, Display, TEXT("Saved %d recorded movement frames to %s."), Recording->Frames.Num(), *Path);
+		}
+		else
+		{
+			UE_LOG(LogKinematicPawn, Error, TEXT("Failed to save movement recording to %s."), *Path);
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs StartRecordingCommand(TEXT("KinematicPawn.StartRecording"),
+		TEXT("Starts recording the local player pawn's movement."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StartRecording));
+
+	static FAutoConsoleCommandWithWorldAndArgs StopRecordingCommand(TEXT("KinematicPawn.StopRecording"),
+		TEXT("Stops recording the local player pawn's movement and saves it. Optionally takes the file path to save to."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StopRecording));
 }
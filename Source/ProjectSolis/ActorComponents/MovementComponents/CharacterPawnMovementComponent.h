@@ -4,184 +4,430 @@
 
 #include "CoreMinimal.h"
 #include "../ProjectSolisActorComponent.h"
+#include "CharacterPawnMovementRecording.h"
+#include "MontageRootMotionSampler.h"
+#include "DepenetrationSolver.h"
+#include "Engine/NetSerialization.h"
+#include "WorldCollision.h"
+#include "../../Libraries/CollisionLibrary.h"
 #include "CharacterPawnMovementComponent.generated.h"
 
+class UGroundHeightGridSubsystem;
+class UCharacterPawnMovementSettings;
+struct FKPCAsyncMovementInputEntry;
+struct FKPCAsyncMovementOutputEntry;
+struct FKPCAsyncCollisionPrimitive;
+
 enum class EKPCMovementMode : uint8
 {
 	Walking
 };
 
-/**
- *
- */
-UCLASS()
-class PROJECTSOLIS_API UCharacterPawnMovementComponent : public UProjectSolisActorComponent
+// How much of the movement algorithm a pawn runs, chosen from its significance to the local player's view.
+enum class EKPCMovementLOD : uint8
+{
+	// LOD0. The full movement algorithm every frame.
+	Full,
+	// LOD1. The full movement algorithm at a reduced tick rate. Skipped time is integrated in a single catch-up step.
+	ReducedRate,
+	// LOD2. Velocity is integrated and the pawn is snapped to the ground with a single trace. No sliding, stepping or depenetration.
+	GroundSnap
+};
+
+// Result of a ground probe kept for the remainder of the current tick.
+struct FKPCGroundProbeCacheEntry
+{
+	FVector Location = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	FHitResult Hit = {};
+	// The number of scene queries that were issued to produce the cached hit.
+	int32 NumSceneQueries = 0;
+};
+
+// The last step the pawn climbed. Used to recognise the next step of a regular staircase and reuse what is known about it instead of probing it again.
+struct FKPCStepCacheEntry
+{
+	TWeakObjectPtr<UPrimitiveComponent> Component = nullptr;
+	// The point where the pawn collided with the step's edge.
+	FVector EdgeLocation = FVector::ZeroVector;
+	// The walkable normal of the step's surface.
+	FVector SurfaceNormal = FVector::UpVector;
+	double StepHeight = 0.0;
+	// The horizontal offset from the previous step's edge to this step's edge, split into a direction and a depth. The depth is zero until two consecutive steps
+	// of the same staircase have been climbed.
+	FVector RunDirection = FVector::ZeroVector;
+	double StepDepth = 0.0;
+};
+
+// A move sent from the owning client to the server. Movement input is quantized and the client simulates with the quantized input so the server can reproduce it.
+USTRUCT()
+struct FKPCNetMove
 {
 	GENERATED_BODY()
 
-private:
-	// Scalar value scaling world gravity applied to the pawn.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|General")
-	float GravityScale = 3.0f;
-
-	// If enabled the component will update the pawn's rotation to match movement direction. This setting is ignored if the pawn has root motion data for the current frame.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|General|Rotation", meta = (DisplayName = "Orient Rotation To Movement"))
-	bool bOrientRotationToMovement = true;
-
-	// Controls the interpolation speed (degrees/second) the pawn rotates at when orienting rotation.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|General|Rotation", meta = (EditCondition = "bOrientRotationToMovement"))
-	FRotator OrientRotationRate = FRotator(0.0, 900.0, 0.0);
-
-	// When OrientRotationToMovementInput is true, orients the pawn's pitch towards the movement input direction.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|General|Rotation", meta = (DisplayName = "Orient Pitch", EditCondition = "bOrientRotationToMovement"))
-	bool bOrientPitch = false;
-
-	// When OrientRotationToMovementInput is true, orients the pawn's yaw towards the movement input direction.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|General|Rotation", meta = (DisplayName = "Orient Yaw", EditCondition = "bOrientRotationToMovement"))
-	bool bOrientYaw = true;
-
-	// When OrientRotationToMovementInput is true, orients the pawn's roll towards the movement input direction.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|General|Rotation", meta = (DisplayName = "Orient Roll", EditCondition = "bOrientRotationToMovement"))
-	bool bOrientRoll = false;
-
-	// If enabled the pawn will still have its orientation rotated to match movement input added with AddMovementInput when a root motion animation is playing on the RootMotionMesh.
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "KinematicPawnController|General|Rotation",
-		meta = (DisplayName = "Allow Movement Rotation During Root Motion", EditCondition = "bOrientRotationToMovement", AllowPrivateAccess = "true"))
-	bool bAllowMovementRotationDuringRootMotion = false;
-
-	// The maximum speed the pawn can walk at on the horizontal plane.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Walking")
-	float MaxWalkSpeed = 500.0f;
-
-	// The maximum acceleration rate the pawn accelerates on the horizontal plane at. Represents the maximum amount of energy the pawn can exert to move in the desired direction.
-	// This value needs to be set relative to GroundFriction to obtain desired acceleration behaviour. Affects the amount of time the pawn takes to reach MaxWalkSpeed 
-	// and how quickly the pawn can change directions when walking on surfaces with low friction. This is the max acceleration rate because it can be scaled down by movement input.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Walking")
-	float MaxAccelerationRate = 4000.0f;
-
-	// A value of 0 represents a perfect smooth surface and a value of 1 represents a perfect rough surface. Applied in ground friction calculation to scale the ground friction value.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Walking")
-	float FrictionCoefficient = 0.1f;
-
-	// Represents the total friction generated by the surface when the pawn slides on it. A higher friction value will allow the pawn to make tighter turns and change directions
-	// quicker however, will require a higher MaxAccelerationRate value to be able to reach MaxWalkSpeed as the movement force must be larger than the friction force to move. 
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Walking")
-	float GroundFriction = 50.0f;
-
-	// The rate at which the pawn decelerates at on the horizontal plane when there is no movement input being added. Braking deceleration force is the only force used to
-	// slow down the character.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Walking")
-	float BrakingDecelerationRate = 3000.0f;
-
-	// If this is true only braking deceleration will be used to stop the character when there is no movement input otherwise braking force has friction added to it when stopping
-	// the pawn.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Walking")
-	bool bApplySeperateBrakingForce = true;
-
-	// The maximum speed the pawn will accelerate up to and walk at on the horizontal plane when an analog input device is being used.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Walking")
-	float MinAnalogWalkSpeed = 0.0f;
-
-	// Value used to scale the horizontal movement force when the character pawn is in the air. A value of 0 will yield no horizontal movement control in the air
-	// and a value of 1 will yield full horizontal movement control in the air. 
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Walking")
-	float AirControl = 0.175f;
-
-	// The amount of upwards force applied to the character when they jump.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Walking")
-	float JumpZForce = 400.0f;
-
-	// The maximum speed the pawn can fall at.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Walking")
-	float MaxFallSpeed = 2000.0f;
-
-	// If this is true all velocity will be removed when the pawn lands on a walkable surface removing the need for the pawn to brake to a stop and instead immediately
-	// come to a stop.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Walking", meta = (DisplayName = "Remove Velocity On Land"))
-	bool bRemoveVelocityOnLand = true;
-
-	// The maximum height the pawn can step up onto.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Walking")
-	float MaxStepHeight = 25.0f;
-
-	// The minimum amount of distance there must be available on a step to step up onto.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Walking")
-	float MinStepDepth = 10.0f;
-
-	// The maximum angle (in degrees) of slope that the pawn can walk on.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Walking")
-	float MaxWalkableSlopeAngle = 40.01f;
-
-	// Value used to offset sample points used to determine if the pawn is on the ground from the bottom center location of the movement collision primitive.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced")
-	float DetermineGroundedSampleMod = 0.15f;
+	UPROPERTY()
+	float DeltaTime = 0.0f;
 
-	// The distance to offset grounded traces upwards from the base of the movement collision before tracing downwards for ground collision.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced")
-	float DetermineGroundedOffset = 20.0f;
+	UPROPERTY()
+	uint16 InputYaw = 0;
 
-	// The distance below the pawn to check for ground collision when determining if the pawn is on the ground. This value should remain greater than the Pull 
-	// Back Movement Epsilon value and greater than the Sweep Shape Inflation Amount value added to Additional Depenetration Fixup value.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced")
-	float DetermineGroundedDistance = 1.5f;
+	UPROPERTY()
+	uint8 InputScale = 0;
 
-	// Epsilon value used in PullBackMovement() to account for floating point precision.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced")
-	float PullBackMovementEpsilon = 0.125f;
+	// EKPCNetMoveFlags.
+	UPROPERTY()
+	uint8 Flags = 0;
+};
 
-	// The amount the movement collision shape is inflated when checking for initial overlapping collisions when the pawn is attempting to move.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced")
-	float SweepShapeInflationAmount = 0.25f;
+enum EKPCNetMoveFlags : uint8
+{
+	KPCNetMove_Jump = 1 << 0,
+	KPCNetMove_ZeroInputDirection = 1 << 1
+};
 
-	// Addition value added to the found penetration depth when calculating a depenetration vector when resolving initial overlap collisions when the pawn is attempting
-	// to move.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced")
-	float AdditionalDepenetrationDistance = 0.125f;
+// A move simulated by the owning client that has not been acknowledged by the server yet. Replayed when the server corrects the client.
+struct FKPCSavedMove
+{
+	int32 MoveId = 0;
+	float DeltaTime = 0.0f;
+	FVector InputDirection = FVector::ZeroVector;
+	float InputScale = 0.0f;
+	bool bJump = false;
+	// The result of simulating the move.
+	FVector Location = FVector::ZeroVector;
+	FVector Velocity = FVector::ZeroVector;
+};
 
-	// Whether to trace movement collision traces against complex collision.
-	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced")
-	bool MovementTraceComplex = false;
+// One-shot movement events added on the game thread during a single frame when using the async physics tick. Events are resent with every input until the physics
+// thread reports them applied, so events are neither lost nor applied twice when several frames are marshalled to the same physics step or one frame's input is
+// seen by several physics steps.
+struct FKPCAsyncMovementEvents
+{
+	int32 Frame = 0;
+	bool bJump = false;
+	bool bHasVerticalForce = false;
+	float VerticalForce = 0.0f;
+	bool bHasVelocity = false;
+	FVector Velocity = FVector::ZeroVector;
+	FRootMotionMovementParams RootMotion = {};
+	// Movement applied to the updated component on the game thread, for example by a teleport.
+	FVector ExternalDisplacement = FVector::ZeroVector;
+	FQuat ExternalRotation = FQuat::Identity;
+
+	bool HasEvents() const
+	{
+		return ((bJump) || (bHasVerticalForce) || (bHasVelocity) || (RootMotion.bHasRootMotion) || (!ExternalDisplacement.IsNearlyZero()) ||
+			(!ExternalRotation.IsIdentity()));
+	}
+};
+
+// Simulation state read and written by every movement substep, packed together and aligned to a cache line so the batch tick touches as few cache lines per
+// pawn as possible. The hot states of batch ticked components are kept contiguously by the movement subsystem. Tuning values live in the shared movement
+// settings asset and colder state stays on the component.
+struct alignas(PLATFORM_CACHE_LINE_SIZE) FKPCMovementHotState
+{
+	// Walking velocity at the start of the next substep, split into its horizontal and vertical parts.
+	FVector HorizontalVelocity = FVector::ZeroVector;
+	FVector VerticalVelocity = FVector::ZeroVector;
+	FVector InputDirection = FVector::ZeroVector;
+	// The velocity the movement base carried the pawn at over the last frame.
+	FVector BaseVelocity = FVector::ZeroVector;
+	// The movable surface the pawn is standing on and moving with.
+	TWeakObjectPtr<UPrimitiveComponent> MovementBase = nullptr;
+	float InputScale = 0.0f;
+	bool bGrounded = false;
+	bool bIsAnimMontagePlaying = false;
+	EKPCMovementMode MovementMode = EKPCMovementMode::Walking;
+};
 
-	// Collision channel movement collision traces are made in.
+/**
+ *
+ */
+UCLASS()
+class PROJECTSOLIS_API UCharacterPawnMovementComponent : public UProjectSolisActorComponent
+{
+	GENERATED_BODY()
+
+	friend class UCharacterPawnMovementSubsystem;
+	friend class FCharacterPawnMovementAsyncCallback;
+
+private:
+	// Tuning values shared by every pawn using the same settings asset. The default settings are used if no asset is set.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController")
+	TObjectPtr<const UCharacterPawnMovementSettings> MovementSettings = nullptr;
+
+	// Ground probes made during a tick are cached and reused by later probes in the same tick when the probe location is within this distance (in cm) of a cached
+	// probe location. Set to a negative value to disable the ground probe cache.
 	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced")
-	TEnumAsByte<ECollisionChannel> MovementTraceChannel = ECollisionChannel::ECC_Visibility;
+	float GroundProbeCacheTolerance = 0.01f;
 
-	// The maximum distance used to search for collision when snapping the pawn down onto a surface.
+	// The next step of a staircase the pawn is climbing is predicted from the last two steps climbed. A step whose edge is within this distance (in cm) of the
+	// predicted edge reuses the last step's surface normal instead of probing for it. Set to a negative value to disable the step cache.
 	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced")
-	float MaxSnapDownDistance = 1000.0f;
+	float StepCacheTolerance = 1.0f;
 
-	// The maximum number of iterations used to move the pawn through the world while testing for collisions and sliding along collided surfaces.
+	// If enabled the component does not tick itself and is instead ticked together with every other batched component by the character pawn movement subsystem.
 	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced")
-	int32 MaxMoveAndSlideIterations = 3;
+	bool bUseBatchedMovementTick = false;
 
-	// The maximum number of iterations used to resolve initial overlapping collisions when the pawn is attempting to move.
+	// If enabled and the project ticks physics asynchronously the walking simulation runs at the start of every physics step on the physics thread instead of on the
+	// game thread. Input is marshalled to the physics thread and the results are applied to the updated component and blended between on the following frames.
+	// Sleep, movement LOD, recording and the ground height grid are not available to pawns using the async physics tick. Physics thread scene queries only test the
+	// bodies gathered around the pawn with each input. Networked pawns always tick on the game thread.
 	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced")
-	int32 MaxPenetrationResolutionIterations = 16;
+	bool bUseAsyncPhysicsTick = false;
 
-	// The pawn will be able to step up onto step surfaces with an available step depth value below MinStepDepth when the step collision height is below this value. This 
-	// helps with stepping up when colliding with shallow slopes.
+	// If enabled ground probes and snapping down to the ground read the ground height grid baked for the map instead of making scene queries where the grid has valid
+	// static ground and no movable geometry is nearby. Has no effect if no grid has been baked for the map.
 	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced")
-	float StepDepthCollisionHeightThreshold = 7.5f;
+	bool bUseGroundHeightGrid = false;
 
-	// The distance (in cm) used to search below the pawn for collision to determine if the character is walking off of a ledge.
+	// If enabled the primitives around the pawn are gathered with a single overlap query at the start of each substep and movement sweeps and traces are tested
+	// against those primitives only. Queries that would leave the gathered area, or would reach a hit outside of it, fall back to a world query.
 	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced")
-	float LedgeSearchDistance = 45.0f;
+	bool bUseCollisionNeighbourhoodCache = false;
+
+	// Extra distance (in cm) added around the area the pawn can reach in a substep when gathering the collision neighbourhood.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced", meta = (ClampMin = "0.0", EditCondition = "bUseCollisionNeighbourhoodCache"))
+	float CollisionNeighbourhoodPadding = 50.0f;
+
+	// If enabled capsule and sphere sweeps against neighbourhood primitives whose simple collision is a single box, sphere or capsule are solved analytically
+	// instead of through the primitive's physics geometry. Other primitives and complex traces still use physics queries.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced", meta = (EditCondition = "bUseCollisionNeighbourhoodCache"))
+	bool bUseAnalyticCollision = true;
+
+	// If enabled movement is simulated in steps of FixedTimestep seconds instead of once with the frame delta time, making movement independent of frame rate. The
+	// interpolated component and GetInterpolatedLocation() are blended between the last two simulated transforms to hide the difference between simulation and frame time.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced|FixedTimestep")
+	bool bUseFixedTimestep = false;
+
+	// The length of a simulation step (in seconds) when using a fixed timestep.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced|FixedTimestep", meta = (ClampMin = "0.001", EditCondition = "bUseFixedTimestep"))
+	float FixedTimestep = 1.0f / 60.0f;
+
+	// The maximum number of simulation steps run in a single frame when using a fixed timestep. Time beyond this is dropped, bounding the cost of a frame after a hitch.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced|FixedTimestep", meta = (ClampMin = "1", EditCondition = "bUseFixedTimestep"))
+	int32 MaxSubstepsPerFrame = 4;
+
+	// If enabled and the game is networked the owning client predicts its movement and sends its moves to the server, which simulates them authoritatively and
+	// corrects the client when their results differ. Other clients follow the server's replicated movement.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Networking")
+	bool bUseNetworkPrediction = true;
+
+	// The maximum number of times per second the owning client sends its moves to the server. Moves made between sends are batched into a single packet.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Networking", meta = (ClampMin = "1.0", EditCondition = "bUseNetworkPrediction"))
+	float ClientMoveSendRate = 30.0f;
+
+	// Moves are sent early when this many moves are waiting to be sent. Every packet also resends the unacknowledged moves before them, up to this many moves in
+	// total, so the server can fill in moves lost with earlier packets.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Networking", meta = (ClampMin = "1", EditCondition = "bUseNetworkPrediction"))
+	int32 MaxMovesPerPacket = 8;
+
+	// The number of unacknowledged moves the owning client keeps to replay after a correction. The oldest move is dropped when the buffer is full.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Networking", meta = (ClampMin = "1", EditCondition = "bUseNetworkPrediction"))
+	int32 MaxSavedMoves = 96;
+
+	// The distance (in cm) the client's location can differ from the server's location after a batch of moves before the server corrects the client.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Networking", meta = (ClampMin = "0.0", EditCondition = "bUseNetworkPrediction"))
+	float MaxClientLocationError = 2.0f;
+
+	// The longest delta time (in seconds) a single move can be simulated with. Applied on the client and the server.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Networking", meta = (ClampMin = "0.001", EditCondition = "bUseNetworkPrediction"))
+	float MaxMoveDeltaTime = 0.125f;
+
+	// The time (in seconds) the client's moves can get ahead of the server's clock, to absorb jitter in when packets arrive. Moves beyond it are not simulated
+	// until the server's clock catches up and the client is corrected, so a client can not move faster by speeding up its clock.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Networking", meta = (ClampMin = "0.0", EditCondition = "bUseNetworkPrediction"))
+	float MaxClientMoveTimeAhead = 0.25f;
+
+	// If enabled the pawn's movement is reduced in detail as it becomes less significant to the local player's view. Pawns controlled by a player always run at
+	// full detail.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced|LOD", meta = (DisplayName = "Use Movement LOD"))
+	bool bUseMovementLOD = false;
+
+	// Pawns further than this distance (in cm) from the nearest viewer tick at a reduced rate.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced|LOD", meta = (ClampMin = "0.0", EditCondition = "bUseMovementLOD"))
+	float ReducedRateDistance = 2500.0f;
+
+	// Pawns further than this distance (in cm) from the nearest viewer, or that have not been rendered recently, only integrate velocity and snap to the ground.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced|LOD", meta = (ClampMin = "0.0", EditCondition = "bUseMovementLOD"))
+	float GroundSnapDistance = 6000.0f;
+
+	// The time (in seconds) between movement ticks of a pawn ticking at a reduced rate.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced|LOD", meta = (ClampMin = "0.0", EditCondition = "bUseMovementLOD"))
+	float ReducedRateTickInterval = 0.1f;
+
+	// The time (in seconds) since the pawn was last rendered after which it is no longer considered visible.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced|LOD", meta = (ClampMin = "0.0", EditCondition = "bUseMovementLOD"))
+	float RecentlyRenderedTolerance = 0.25f;
+
+	// If enabled root motion of the montage playing on the RootMotionMesh is sampled from the montage's animation data at the movement timestep instead of being
+	// consumed from the mesh. The mesh then does not need to evaluate its pose for the pawn to move, so it can skip evaluation when it is not rendered or on a
+	// dedicated server with VisibilityBasedAnimTickOption set to OnlyTickMontagesWhenNotRendered.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced|RootMotion")
+	bool bSampleMontageRootMotion = true;
+
+	// If enabled a grounded pawn that has not moved and has received no input for SleepDelay seconds is put to sleep. Sleeping pawns skip the movement tick and issue
+	// no scene queries until they are woken by input, a jump, a vertical force, root motion, an overlap, the surface they are standing on moving or their transform
+	// being changed. Pawns controlled by a remote player never sleep. Disabled by default so existing pawns keep ticking every frame until sleep is opted into.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced|Sleep")
+	bool bAllowSleep = false;
+
+	// The time (in seconds) a pawn must be at rest before it is put to sleep.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced|Sleep", meta = (ClampMin = "0.0", EditCondition = "bAllowSleep"))
+	float SleepDelay = 0.25f;
+
+	// The speed (in cm/s) below which the pawn is considered to be at rest.
+	UPROPERTY(EditAnywhere, Category = "KinematicPawnController|Advanced|Sleep", meta = (ClampMin = "0.0", EditCondition = "bAllowSleep"))
+	float SleepVelocityThreshold = 0.1f;
 
 	// Variables internal to component.
+	// The hot state the component simulates with. Points at OwnHotState, or at the component's slot in the movement subsystem's packed hot states while the
+	// component is batch ticked.
+	FKPCMovementHotState* HotState = &OwnHotState;
+	FKPCMovementHotState OwnHotState = {};
 	UWorld* World = nullptr;
+	// The movement settings asset, or the default settings if none is set. Never null once the component is registered.
+	const UCharacterPawnMovementSettings* Settings = nullptr;
 	UPrimitiveComponent* UpdatedComponent = nullptr;
 	USkeletalMeshComponent* RootMotionMesh = nullptr;
 	FCollisionQueryParams MovementCollisionQueryParams = FCollisionQueryParams::DefaultQueryParam;
 	FRootMotionMovementParams RootMotionMovementParams = {};
-	bool bIsAnimMontagePlaying = false;
-	EKPCMovementMode MovementMode = EKPCMovementMode::Walking;
-	FVector MovementInputDirection = FVector::ZeroVector;
-	float MovementInputScale = 0.0f;
+	FKPCMontageRootMotionSampler MontageRootMotionSampler = {};
+	// Scene query results reused by every multi sweep. The engine query interface only fills default allocated arrays, so capacity is reserved when the component is
+	// registered and kept across ticks instead of using an inline allocator. Reset, never emptied, so a steady state tick does not allocate.
+	static constexpr int32 HitResultScratchReserve = 16;
 	TArray<FHitResult> HitResultScratch = {};
-
-	// Movement mode walking variables.
-	FVector InitialHorizontalVelocityWalking = FVector::ZeroVector;
-	FVector InitialVerticalVelocityWalking = FVector::ZeroVector;
+	// Contacts the pawn starts overlapping, gathered from the hit result scratch for the depenetration solvers.
+	TArray<FKPCPenetrationContact, TInlineAllocator<HitResultScratchReserve>> PenetrationContactScratch = {};
+	// Separate solvers for moving out of collision and for depenetrating the inflated sweep shape so each warm starts from its own contacts' last solve.
+	FKPCDepenetrationSolver OutOfCollisionSolver = {};
+	FKPCDepenetrationSolver SweepDepenetrationSolver = {};
+	// Null if not using the ground height grid or no grid was baked for the map.
+	const UGroundHeightGridSubsystem* GroundHeightGrid = nullptr;
+
+	// Ground probe cache. Entries live for a single tick and are invalidated whenever the updated component is moved and at the start and end of every movement
+	// frame. Mutable as it only memoizes FindGroundHit(), which is logically const and filled by const ground checks such as IsGrounded(). Not safe to use from
+	// more than one thread at a time, like the rest of the simulation state.
+	static constexpr int32 GroundProbeCacheSize = 4;
+	mutable TArray<FKPCGroundProbeCacheEntry, TInlineAllocator<GroundProbeCacheSize>> GroundProbeCache = {};
+	mutable int32 NextGroundProbeCacheEntry = 0;
+
+	// The last step climbed. Kept across ticks.
+	FKPCStepCacheEntry StepCache = {};
+
+	// Deferred transform state. During a movement tick every read and write of the pawn's transform goes to this working transform instead of the updated component
+	// so the updated component is only moved once per tick and the tick can run off the game thread. The result is written to the updated component when the
+	// deferred updates are committed at the end of the tick.
+	bool bDeferTransformUpdates = false;
+	bool bHasDeferredTransform = false;
+	FVector DeferredLocation = FVector::ZeroVector;
+	FQuat DeferredRotation = FQuat::Identity;
+
+	// The movement base's transform at the end of the last substep. The pawn is carried by the movable surface it is standing on by the change in the surface's
+	// transform since the last substep, instead of being attached to it.
+	FTransform MovementBaseTransform = FTransform::Identity;
+	// The time (in seconds) since the movement base's transform was last read.
+	float MovementBaseDeltaTime = 0.0f;
+
+	// The number of scene queries issued since the start of the current movement tick.
+	mutable int32 NumSceneQueries = 0;
+
+	// Collision neighbourhood gathered for the current substep. Only valid while bHasCollisionNeighbourhood is set.
+	static constexpr int32 CollisionNeighbourhoodInlineSize = 16;
+	TArray<UPrimitiveComponent*, TInlineAllocator<CollisionNeighbourhoodInlineSize>> CollisionNeighbourhood = {};
+	// Analytic shapes of the neighbourhood primitives, with a type of None for primitives that need a physics query.
+	TArray<FKPCAnalyticShape, TInlineAllocator<CollisionNeighbourhoodInlineSize>> CollisionNeighbourhoodShapes = {};
+	static constexpr int32 OverlapResultScratchReserve = 32;
+	TArray<FOverlapResult> OverlapResultScratch = {};
+	FBox CollisionNeighbourhoodBounds = FBox(ForceInit);
+	bool bHasCollisionNeighbourhood = false;
+
+	// Fixed timestep state. Root motion consumed for the frame is split evenly across the frame's substeps.
+	float FixedTimestepAccumulator = 0.0f;
+	float SubstepDeltaTime = 0.0f;
+	int32 NumSubstepsThisFrame = 0;
+	FRootMotionMovementParams FrameRootMotionMovementParams = {};
+	FVector PreviousSimulatedLocation = FVector::ZeroVector;
+	FQuat PreviousSimulatedRotation = FQuat::Identity;
+
+	// Render interpolation state. The interpolated component is moved to the interpolated transform every frame keeping its original offset from the updated component.
+	USceneComponent* InterpolatedComponent = nullptr;
+	FTransform InterpolatedComponentRelativeTransform = FTransform::Identity;
+	FVector InterpolatedLocation = FVector::ZeroVector;
+	FQuat InterpolatedRotation = FQuat::Identity;
+
+	// Movement recording state. Events are collected between frames and written with the next frame.
+	TUniquePtr<FKPCMovementRecording> Recording = nullptr;
+	FKPCMovementRecordFrame RecordingFrame = {};
+	TArray<FKPCMovementRecordEvent, TInlineAllocator<2>> PendingRecordingEvents = {};
+
+	// Client prediction state. Saved moves are kept in a ring buffer ordered by move id.
+	TArray<FKPCSavedMove> SavedMoves = {};
+	int32 FirstSavedMove = 0;
+	int32 NumSavedMoves = 0;
+	// Moves simulated since moves were last sent. The moves sent are taken from the saved moves.
+	int32 NumUnsentMoves = 0;
+	TArray<FKPCNetMove> NetMoveScratch = {};
+	int32 NextMoveId = 1;
+	float TimeSinceLastMoveSend = 0.0f;
+	bool bPendingJump = false;
+	int32 LastAcknowledgedMoveId = 0;
+	bool bReplayingSavedMoves = false;
+
+	// Server state. The id of the last move received from the owning client that has been simulated.
+	int32 LastProcessedMoveId = 0;
+	// How far (in seconds) the client's simulated moves are ahead of the server's clock. Never less than -MaxClientMoveTimeAhead, so a client can not bank time
+	// while its packets are delayed and spend it in a burst of moves later.
+	float ClientMoveTimeAhead = 0.0f;
+	double LastServerMoveBatchTime = -1.0;
+
+	// Movement LOD state. Time skipped while ticking at a reduced rate is accumulated and simulated in the next tick, or in the next frame after leaving the
+	// reduced rate.
+	EKPCMovementLOD MovementLOD = EKPCMovementLOD::Full;
+	float LODSkippedTime = 0.0f;
+
+	// Sleep state. The pawn's transform at the start of the current frame is used to detect whether the frame moved the pawn.
+	bool bIsAsleep = false;
+	float TimeAtRest = 0.0f;
+	FVector FrameStartLocation = FVector::ZeroVector;
+	FQuat FrameStartRotation = FQuat::Identity;
+
+	// Async physics tick state. While the async physics tick is active the simulation state above is owned by the physics thread, apart from the hot state's
+	// movement base which is set from each output, and the game thread only touches the state below. Deferred transform updates stay enabled so the physics thread never moves the updated component itself.
+	bool bAsyncPhysicsTickActive = false;
+	FVector AsyncInputDirection = FVector::ZeroVector;
+	float AsyncInputScale = 0.0f;
+	FKPCAsyncMovementEvents PendingAsyncEvents = {};
+	TArray<FKPCAsyncMovementEvents, TInlineAllocator<2>> UnacknowledgedAsyncEvents = {};
+	int32 NextAsyncEventFrame = 1;
+	// The updated component's transform after the last output was applied. Anything that moves it away from this transform is sent to the physics thread.
+	FVector AsyncBaseLocation = FVector::ZeroVector;
+	FQuat AsyncBaseRotation = FQuat::Identity;
+	// The last two outputs and their physics times, blended between to place the interpolated component.
+	FVector AsyncPreviousLocation = FVector::ZeroVector;
+	FQuat AsyncPreviousRotation = FQuat::Identity;
+	double AsyncPreviousTime = 0.0;
+	FVector AsyncLatestLocation = FVector::ZeroVector;
+	FQuat AsyncLatestRotation = FQuat::Identity;
+	double AsyncLatestTime = 0.0;
+	FVector AsyncVelocity = FVector::ZeroVector;
+	bool bAsyncGrounded = false;
+	// Written and read on the physics thread only.
+	int32 LastAppliedAsyncEventFrame = 0;
+	// The input of the physics step being simulated. Only set on the physics thread while a step runs, when every scene query only tests the input's collision
+	// primitives and the movement base is read from its particle.
+	const FKPCAsyncMovementInputEntry* AsyncInput = nullptr;
+	// The movement base as the physics thread sees it. Only compared against the input's collision primitives, never dereferenced. The handle is taken from the
+	// gathered primitive and sent back with every output, which is the only time the movement base in the hot state is written while the async tick is active.
+	const UPrimitiveComponent* AsyncMovementBase = nullptr;
+	TWeakObjectPtr<UPrimitiveComponent> AsyncMovementBaseHandle = nullptr;
+
+	// The minimum Z component of a walkable surface normal. Taken from the settings unless overridden with SetMaxWalkableSlopeAngle.
+	double WalkableFloorZ = 0.0;
+
+	// The updated component's collision shape inflated by SweepShapeInflationAmount for the current substep.
+	FCollisionShape InflatedMovementCollisionShape = {};
 
 public:
 	// Sets the component the kinematic pawn controller updates. This is the component that is transformed in the world by the kinematic pawn controller component.
@@ -190,6 +436,12 @@ public:
 	// Sets the skeletal mesh component the kinematic pawn controller should extract root bone animation data from if root motion is being used.
 	void SetRootMotionMesh(USkeletalMeshComponent* Component);
 
+	// Returns the movement LOD the pawn is currently simulated at.
+	EKPCMovementLOD GetMovementLOD() const { return MovementLOD; }
+
+	// Sets the component that is moved to the interpolated transform when using a fixed timestep. This should be a visual component attached to the updated component.
+	void SetInterpolatedComponent(USceneComponent* Component);
+
 	// Adds movement input to the pawn.
 	void AddMovementInput(const FVector& Direction, float Scale);
 
@@ -206,29 +458,123 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	FVector GetVelocity() const;
 
+	// Runs a single movement tick. Called by TickComponent, exposed to allow movement to be stepped manually, for example by headless tools.
+	void TickMovement(float DeltaTime);
+
+	// Returns the number of scene queries issued by the last movement tick.
+	int32 GetNumSceneQueries() const { return NumSceneQueries; }
+
+	void SetUseCollisionNeighbourhoodCache(bool bEnabled) { bUseCollisionNeighbourhoodCache = bEnabled; }
+
+	// Returns the pawn's transform blended between the last two simulation steps. Equal to the updated component's transform when not using a fixed timestep. Use
+	// this to place anything that follows the pawn visually, such as a camera.
+	FVector GetInterpolatedLocation() const { return InterpolatedLocation; }
+	FQuat GetInterpolatedRotation() const { return InterpolatedRotation; }
+
+	// Moves the pawn to the location and rotation and sets its velocity, discarding any pending fixed timestep time.
+	void ResetMovementState(const FVector& Location, const FQuat& Rotation, const FVector& Velocity, float FixedTimestepTime = 0.0f);
+
+	// Starts recording every movement frame. Movement input is quantized while recording so the recording replays exactly.
+	void StartRecording();
+
+	// Stops recording and returns the recorded session. Returns null if the component was not recording.
+	TUniquePtr<FKPCMovementRecording> StopRecording();
+
+	bool IsRecording() const { return Recording.IsValid(); }
+
+	// Replays the events and movement input of a recorded frame. Call before stepping the frame with TickMovement.
+	void ApplyRecordedFrameInput(const FKPCMovementRecordFrame& Frame);
+
+	// Returns the movable surface the pawn is standing on and moving with, or null if the pawn is not standing on a movable surface. When using the async physics
+	// tick this is the base of the latest output applied.
+	UPrimitiveComponent* GetMovementBase() const { return HotState->MovementBase.Get(); }
+
+	// Returns true if the pawn's movement is simulated on the physics thread.
+	bool IsUsingAsyncPhysicsTick() const { return bAsyncPhysicsTickActive; }
+
+	// Returns true if the pawn is at rest and is skipping its movement tick.
+	bool IsAsleep() const { return bIsAsleep; }
+
+	// Wakes the pawn if it is asleep. Call when something the pawn can not detect by itself changes, such as the surface under the pawn being destroyed.
+	void WakeUp();
+
+	// Sets the maximum angle (in degrees) of slope that the pawn can walk on, overriding the movement settings for this pawn.
+	void SetMaxWalkableSlopeAngle(float Angle);
+
 private:
 	// Constructor.
 	UCharacterPawnMovementComponent();
 
 	// UProjectSolisActorComponent interface.
+	virtual void OnRegister() override;
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	// Points Settings at the movement settings asset or the default settings.
+	void ResolveMovementSettings();
+
+	// Movement tick phases. Run in order by TickMovement or phase by phase across every batched component by the character pawn movement subsystem. A frame is
+	// made of zero or more substeps, each running UpdatePawnRotation, ResolveInitialPenetration and TickMovementMode with the substep delta time.
+	int32 BeginMovementFrame(float DeltaTime);
+	void BeginMovementSubstep(int32 SubstepIndex);
+	void ResolveInitialPenetration();
+	void TickMovementMode(float DeltaTime);
+	void EndMovementFrame();
+	float GetSubstepDeltaTime() const { return SubstepDeltaTime; }
+	// Async physics tick. Input is gathered and output applied on the game thread by the character pawn movement subsystem. The step is run on the physics thread.
+	void BeginAsyncPhysicsTick();
+	void GatherAsyncPhysicsInput(FKPCAsyncMovementInputEntry& OutInput);
+	void SimulateAsyncPhysicsStep(const FKPCAsyncMovementInputEntry& Input, float DeltaTime, FKPCAsyncMovementOutputEntry& OutOutput);
+	void ApplyAsyncPhysicsOutput(const FKPCAsyncMovementOutputEntry& Output, double OutputTime);
+	void UpdateInterpolatedTransformAsync(double ResultsTime);
+	// Significance manager callbacks used when movement LOD is enabled.
+	float CalculateSignificance(const FTransform& ViewTransform) const;
+	void SetMovementLOD(EKPCMovementLOD LOD);
+	// Moves the interpolated component and updates the interpolated transform.
+	void UpdateInterpolatedTransform();
+	// Puts the pawn to sleep once it has been at rest for long enough. Called at the end of every simulated frame.
+	void UpdateSleepState();
+	bool CanSleep() const;
+	bool ShouldWakeUp() const;
+	// Wake events reported by the updated component.
+	void OnUpdatedComponentTransformUpdated(USceneComponent* Component, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+	UFUNCTION()
+	void OnUpdatedComponentBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex,
+		bool bFromSweep, const FHitResult& SweepResult);
 
 	// General component functions.
 	void ClearMovementInput();
 	bool IsRequestingMovement();
 	bool HasRootMotion();
 	float CalculateGravity();
+	// Returns the velocity of the simulation. Unlike GetVelocity() this is the physics thread's state when using the async physics tick.
+	FVector GetSimulatedVelocity() const;
+	// Returns the updated component's collision shape. Taken from the input while simulating on the physics thread, as the shape depends on the component's scale.
+	FCollisionShape GetMovementCollisionShape() const;
 	FVector PullBackMovement(const FVector& Movement);
 	bool DepenetrateAndSweep(FHitResult& OutHit, const FVector& Displacement, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation,
 		const FCollisionShape& MovementCollisionShape);
 	void UpdatePawnRotation(float DeltaTime);
 	void MoveOutOfCollision(const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation, const FCollisionShape& MovementCollisionShape);
+	// Fills the penetration contact scratch with a contact for every hit in the hit result scratch the shape starts out penetrating. Contacts use the minimum
+	// translation distance found by the sweep, or computed against the primitive for the swept shape if the sweep did not find one. Returns false if there are no
+	// contacts.
+	bool GatherPenetrationContacts(const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation, const FCollisionShape& MovementCollisionShape,
+		bool bAdjustNormalsForMovementMode);
 	double CalculateOrientRotationComponentDelta(double Current, double Target, float DeltaTime, float Speed);
 
 	// Movement mode walking functions.
 	void TickMovementModeWalking(float DeltaTime, const FVector& MovementCollisionLocation, const FCollisionShape& MovementCollisionShape, const FQuat& MovementCollisionRotation);
 	void UpdateHorizontalMovementWalking(float Time, const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation);
+	// Integrates horizontal velocity for the frame and returns the horizontal displacement to apply.
+	FVector CalculateHorizontalDisplacementWalking(float Time, bool bGroundedBeforeMove, const FQuat& MovementCollisionRotation);
+	// Walking at movement LOD GroundSnap.
+	void TickMovementModeWalkingGroundSnap(float DeltaTime, const FVector& MovementCollisionLocation, const FCollisionShape& MovementCollisionShape,
+		const FQuat& MovementCollisionRotation);
 	void UpdateVerticalMovementWalking(float Time, const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation);
 	bool StepUp(const FHitResult& CollisionHitResult, const FVector& Velocity, const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation,
 		const FQuat& MovementCollisionRotation);
@@ -239,10 +585,88 @@ private:
 		const FCollisionShape& MovementCollisionShape);
 	bool IsWalkableSurface(const FVector& SurfaceNormal) const;
 	FVector FindStepSurfaceNormalFromCollision(const FHitResult& Hit);
+	// Returns true if the step collided with is the next step of the staircase in the step cache.
+	bool IsPredictedStep(const FHitResult& CollisionHitResult, double CollisionHeight) const;
+	void UpdateStepCache(const FHitResult& CollisionHitResult, double CollisionHeight, const FVector& StepSurfaceNormal);
+	// Returns the ground below the shape. Const but writes the result to the ground probe cache.
 	FHitResult FindGroundHit(const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation) const;
+	FHitResult ProbeGround(const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation,
+		int32& OutNumSceneQueries) const;
+	// Finds the ground below the shape in the ground height grid. The trace starts TraceStartOffset above the lowest point on the shape and is TraceDistance long.
+	// Returns false if the grid can not answer for the shape's location.
+	bool FindGroundHitInHeightGrid(FHitResult& OutHit, const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation,
+		const FQuat& MovementCollisionRotation, double TraceStartOffset, double TraceDistance) const;
+	const FKPCGroundProbeCacheEntry* FindGroundProbeCacheEntry(const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation) const;
+	void InvalidateGroundProbeCache();
+	// Networking.
+	bool ShouldUseNetworkPrediction() const;
+	void TickAutonomousProxy(float DeltaTime);
+	void SendPendingMoves();
+	void AddSavedMove(const FKPCSavedMove& Move);
+	void DiscardSavedMovesUpTo(int32 MoveId);
+	void ReplaySavedMoves();
+	FKPCSavedMove& GetSavedMove(int32 Index) { return SavedMoves[(FirstSavedMove + Index) % SavedMoves.Num()]; }
+
+	// Sends a batch of consecutive moves starting at FirstMoveId along with the client's location after the last move. Moves the server has already simulated are
+	// skipped.
+	UFUNCTION(Server, Unreliable)
+	void ServerMoveBatch(int32 FirstMoveId, const TArray<FKPCNetMove>& Moves, FVector_NetQuantize100 ClientLocation);
+
+	// Tells the client every move up to and including MoveId matched the server.
+	UFUNCTION(Client, Unreliable)
+	void ClientAckMove(int32 MoveId);
+
+	// Tells the client its state after MoveId was wrong. The client adopts the server's state and replays its later moves.
+	UFUNCTION(Client, Unreliable)
+	void ClientCorrection(int32 MoveId, FVector_NetQuantize100 Location, FRotator Rotation, FVector_NetQuantize10 Velocity, float FixedTimestepTime);
+
+	// Scene queries made by the movement tick. All movement scene queries should go through these functions.
+	bool SweepSingle(FHitResult& OutHit, const FVector& Start, const FVector& End, const FQuat& Rotation, const FCollisionShape& Shape) const;
+	bool SweepMulti(TArray<FHitResult>& OutHits, const FVector& Start, const FVector& End, const FQuat& Rotation, const FCollisionShape& Shape) const;
+	bool LineTraceSingle(FHitResult& OutHit, const FVector& Start, const FVector& End) const;
+	// Computes the minimum translation that moves the shape out of the primitive of the hit. Tests the primitive's particle while simulating on the physics thread.
+	bool ComputePenetration(FVector& OutDirection, double& OutDepth, const FHitResult& Hit, const FVector& Location, const FQuat& Rotation,
+		const FCollisionShape& Shape) const;
+	// Gathers the primitives the pawn can touch during the substep.
+	void GatherCollisionNeighbourhood(float DeltaTime);
+	// Returns the area the pawn can reach from the location within the time, including the distances ground probes, step ups and ledge checks reach.
+	FBox CalculateCollisionNeighbourhoodBounds(const FVector& Location, const FVector& Velocity, float DeltaTime) const;
+	// Gathers every body the pawn can reach before the next input into the input sent to the physics thread. Game thread only.
+	void GatherAsyncCollisionPrimitives(FKPCAsyncMovementInputEntry& OutInput);
+	// Scene queries made while simulating on the physics thread. Only the async input's collision primitives are tested, at their physics thread transforms.
+	bool SweepAsyncCollision(FHitResult& OutHit, const FVector& Start, const FVector& End, const FQuat& Rotation, const FCollisionShape& Shape) const;
+	bool SweepMultiAsyncCollision(TArray<FHitResult>& OutHits, const FVector& Start, const FVector& End, const FQuat& Rotation, const FCollisionShape& Shape) const;
+	bool LineTraceAsyncCollision(FHitResult& OutHit, const FVector& Start, const FVector& End) const;
+	void CheckAsyncCollisionBounds(const FVector& Start, const FVector& End, double QueryRadius) const;
+	const FKPCAsyncCollisionPrimitive* FindAsyncCollisionPrimitive(const UPrimitiveComponent* Primitive) const;
+	// Tests a query against the collision neighbourhood. Returns false if the result can not be trusted and a world query must be made instead. QueryRadius bounds
+	// the swept shape in every direction.
+	bool SweepCollisionNeighbourhood(FHitResult& OutHit, bool& bOutBlockingHit, const FVector& Start, const FVector& End, const FQuat& Rotation,
+		const FCollisionShape& Shape) const;
+	bool LineTraceCollisionNeighbourhood(FHitResult& OutHit, bool& bOutBlockingHit, const FVector& Start, const FVector& End) const;
+	bool IsInCollisionNeighbourhood(const FVector& Start, const FVector& End, double QueryRadius) const;
+	// Moves the updated component to the new world location. All movement of the updated component by this component should go through this function.
+	void SetUpdatedComponentLocation(const FVector& NewLocation);
+	// Rotates the updated component to the new world rotation. All rotation of the updated component by this component should go through this function.
+	void SetUpdatedComponentRotation(const FQuat& NewRotation);
+	// Returns the updated component's location and rotation as seen by the movement tick.
+	FVector GetUpdatedComponentLocation() const;
+	FQuat GetUpdatedComponentQuat() const;
+	// Start recording transform changes to the working transform instead of applying them to the updated component.
+	void BeginDeferredTransformUpdates();
+	// Apply the working transform to the updated component.
+	void CommitDeferredTransformUpdates();
 	bool DetermineIfGrounded(const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation) const;
 	FVector FindGroundSurfaceNormal(const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation, const FCollisionShape& MovementCollisionShape);
-	void UpdateComponentAttachment(const FCollisionShape& MovementCollisionShape, const FVector& MovementCollisionLocation, const FQuat& MovementCollisionRotation);
+	// Moves the pawn by the change in its movement base's transform since the last substep. The base velocity is only updated by the first substep of a frame.
+	void ApplyMovementBaseDelta();
+	// Sets the movement base to the surface of the ground hit if it is walkable and movable. The base is only changed when the surface differs from the current base.
+	void UpdateMovementBase(const FHitResult& GroundHit);
+	void SetMovementBase(UPrimitiveComponent* NewMovementBase, bool bLeftGround);
+	// Returns the movement base's transform as seen by the simulation. Read from the base's physics thread particle while simulating on the physics thread.
+	bool GetMovementBaseTransform(const UPrimitiveComponent* Base, FTransform& OutTransform) const;
+	bool IsMovableMovementBase(const UPrimitiveComponent* Base) const;
+	const UPrimitiveComponent* GetSimulatedMovementBase() const { return (AsyncInput != nullptr) ? AsyncMovementBase : HotState->MovementBase.Get(); }
 	FVector AdjustDepenetrationNormalWalking(FVector Normal, const FVector& ImpactNormal);
 	void ApplyRootMotionRotationWalking(const FQuat& Rotation);
 	FRotator GetMovementOrientationWalking();
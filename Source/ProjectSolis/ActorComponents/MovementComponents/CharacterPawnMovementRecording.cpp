@@ -0,0 +1,254 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CharacterPawnMovementRecording.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace KPCMovementRecording
+{
+	static constexpr uint32 Magic = 0x5243504B; // "KPCR"
+	static constexpr uint32 Version = 1;
+
+	enum EFrameFlags : uint8
+	{
+		DeltaTimeChanged = 1 << 0,
+		InputChanged = 1 << 1,
+		HasEvents = 1 << 2,
+		ZeroInputDirection = 1 << 3
+	};
+
+	static uint64 ZigZagEncode(int64 Value)
+	{
+		return (static_cast<uint64>(Value) << 1) ^ static_cast<uint64>(Value >> 63);
+	}
+
+	static int64 ZigZagDecode(uint64 Value)
+	{
+		return static_cast<int64>(Value >> 1) ^ -static_cast<int64>(Value & 1);
+	}
+
+	// Writes or reads a value as a variable length delta from the previous value in fixed point with the given resolution.
+	static void SerializeFixedPointDelta(FArchive& Ar, double& Value, int64& Previous, double Resolution)
+	{
+		uint64 Encoded = (Ar.IsLoading()) ? 0 : ZigZagEncode(FMath::RoundToInt64(Value / Resolution) - Previous);
+		Ar.SerializeIntPacked64(Encoded);
+		Previous += ZigZagDecode(Encoded);
+		if (Ar.IsLoading())
+		{
+			Value = static_cast<double>(Previous) * Resolution;
+		}
+	}
+
+	// Writes or reads an angle as a variable length delta from the previous angle compressed to 16 bits.
+	static void SerializeAngleDelta(FArchive& Ar, double& Angle, uint16& Previous)
+	{
+		uint32 Encoded = (Ar.IsLoading()) ? 0 : static_cast<uint32>(ZigZagEncode(static_cast<int16>(FRotator::CompressAxisToShort(Angle) - Previous)));
+		Ar.SerializeIntPacked(Encoded);
+		Previous = static_cast<uint16>(Previous + static_cast<int16>(ZigZagDecode(Encoded)));
+		if (Ar.IsLoading())
+		{
+			Angle = FRotator::DecompressAxisFromShort(Previous);
+		}
+	}
+}
+
+void FKPCMovementRecording::Serialize(FArchive& Ar)
+{
+	using namespace KPCMovementRecording;
+
+	uint32 FileMagic = Magic;
+	uint32 FileVersion = Version;
+	Ar << FileMagic;
+	Ar << FileVersion;
+	if ((FileMagic != Magic) || (FileVersion != Version))
+	{
+		Ar.SetError();
+		return;
+	}
+
+	Ar << MapPackageName;
+	Ar << PawnClassPath;
+	Ar << InitialLocation;
+	Ar << InitialRotation;
+	Ar << InitialVelocity;
+	Ar << InitialFixedTimestepAccumulator;
+
+	int32 NumFrames = Frames.Num();
+	Ar << NumFrames;
+	if (Ar.IsLoading())
+	{
+		if (NumFrames < 0)
+		{
+			Ar.SetError();
+			return;
+		}
+		Frames.SetNum(NumFrames);
+	}
+
+	// Results are delta encoded against the previous frame, starting from the initial state.
+	int64 PreviousLocation[3] = {};
+	int64 PreviousVelocity[3] = {};
+	uint16 PreviousRotation[3] = { 0, 0, 0 };
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		PreviousLocation[Axis] = FMath::RoundToInt64(InitialLocation[Axis] / LocationResolution);
+		PreviousVelocity[Axis] = FMath::RoundToInt64(InitialVelocity[Axis] / VelocityResolution);
+	}
+	const FRotator InitialRotator = InitialRotation.Rotator();
+	PreviousRotation[0] = FRotator::CompressAxisToShort(InitialRotator.Pitch);
+	PreviousRotation[1] = FRotator::CompressAxisToShort(InitialRotator.Yaw);
+	PreviousRotation[2] = FRotator::CompressAxisToShort(InitialRotator.Roll);
+
+	float PreviousDeltaTime = 0.0f;
+	uint16 PreviousInputYaw = 0;
+	uint8 PreviousInputScale = 0;
+	bool bPreviousZeroInputDirection = false;
+
+	for (int32 i = 0; i < NumFrames; ++i)
+	{
+		FKPCMovementRecordFrame& Frame = Frames[i];
+
+		uint16 InputYaw = PreviousInputYaw;
+		uint8 InputScale = PreviousInputScale;
+		bool bZeroInputDirection = bPreviousZeroInputDirection;
+
+		uint8 Flags = 0;
+		if (Ar.IsSaving())
+		{
+			InputYaw = CompressInputDirection(Frame.InputDirection);
+			InputScale = CompressInputScale(Frame.InputScale);
+			bZeroInputDirection = Frame.InputDirection.IsNearlyZero();
+
+			// Compare delta time bitwise so the exact value is reproduced.
+			Flags |= (FMemory::Memcmp(&Frame.DeltaTime, &PreviousDeltaTime, sizeof(float)) != 0) ? DeltaTimeChanged : 0;
+			Flags |= ((i == 0) || (InputYaw != PreviousInputYaw) || (InputScale != PreviousInputScale) || (bZeroInputDirection != bPreviousZeroInputDirection)) ? InputChanged : 0;
+			Flags |= (!Frame.Events.IsEmpty()) ? HasEvents : 0;
+			Flags |= (bZeroInputDirection) ? ZeroInputDirection : 0;
+		}
+		Ar << Flags;
+
+		// Delta time.
+		if (Flags & DeltaTimeChanged)
+		{
+			Ar << Frame.DeltaTime;
+		}
+		else
+		{
+			Frame.DeltaTime = PreviousDeltaTime;
+		}
+		PreviousDeltaTime = Frame.DeltaTime;
+
+		// Movement input.
+		if (Flags & InputChanged)
+		{
+			Ar << InputYaw;
+			Ar << InputScale;
+			bZeroInputDirection = ((Flags & ZeroInputDirection) != 0);
+		}
+		if (Ar.IsLoading())
+		{
+			Frame.InputDirection = (bZeroInputDirection) ? FVector::ZeroVector : DecompressInputDirection(InputYaw);
+			Frame.InputScale = DecompressInputScale(InputScale);
+		}
+		PreviousInputYaw = InputYaw;
+		PreviousInputScale = InputScale;
+		bPreviousZeroInputDirection = bZeroInputDirection;
+
+		// Events.
+		if (Flags & HasEvents)
+		{
+			uint32 NumEvents = static_cast<uint32>(Frame.Events.Num());
+			Ar.SerializeIntPacked(NumEvents);
+			if (Ar.IsLoading())
+			{
+				Frame.Events.SetNum(static_cast<int32>(NumEvents));
+			}
+
+			for (FKPCMovementRecordEvent& Event : Frame.Events)
+			{
+				Ar << Event.Type;
+				if (Event.Type == EKPCMovementRecordEventType::AddVerticalForce)
+				{
+					Ar << Event.Value;
+				}
+			}
+		}
+
+		// Results.
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			SerializeFixedPointDelta(Ar, Frame.Location[Axis], PreviousLocation[Axis], LocationResolution);
+		}
+		SerializeAngleDelta(Ar, Frame.Rotation.Pitch, PreviousRotation[0]);
+		SerializeAngleDelta(Ar, Frame.Rotation.Yaw, PreviousRotation[1]);
+		SerializeAngleDelta(Ar, Frame.Rotation.Roll, PreviousRotation[2]);
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			SerializeFixedPointDelta(Ar, Frame.Velocity[Axis], PreviousVelocity[Axis], VelocityResolution);
+		}
+
+		if (Ar.IsError())
+		{
+			return;
+		}
+	}
+}
+
+bool FKPCMovementRecording::SaveToFile(const FString& Path) const
+{
+	TArray<uint8> Bytes = {};
+	FMemoryWriter Writer(Bytes);
+	const_cast<FKPCMovementRecording*>(this)->Serialize(Writer);
+	return ((!Writer.IsError()) && (FFileHelper::SaveArrayToFile(Bytes, *Path)));
+}
+
+bool FKPCMovementRecording::LoadFromFile(const FString& Path)
+{
+	TArray<uint8> Bytes = {};
+	if (!FFileHelper::LoadFileToArray(Bytes, *Path))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+	Serialize(Reader);
+	return !Reader.IsError();
+}
+
+FVector FKPCMovementRecording::QuantizeInputDirection(const FVector& Direction)
+{
+	if (Direction.IsNearlyZero())
+	{
+		return FVector::ZeroVector;
+	}
+
+	return DecompressInputDirection(CompressInputDirection(Direction));
+}
+
+float FKPCMovementRecording::QuantizeInputScale(float Scale)
+{
+	return DecompressInputScale(CompressInputScale(Scale));
+}
+
+uint16 FKPCMovementRecording::CompressInputDirection(const FVector& Direction)
+{
+	return FRotator::CompressAxisToShort(FMath::RadiansToDegrees(FMath::Atan2(Direction.Y, Direction.X)));
+}
+
+FVector FKPCMovementRecording::DecompressInputDirection(uint16 Yaw)
+{
+	const double YawRadians = FMath::DegreesToRadians(FRotator::DecompressAxisFromShort(Yaw));
+	return FVector(FMath::Cos(YawRadians), FMath::Sin(YawRadians), 0.0);
+}
+
+uint8 FKPCMovementRecording::CompressInputScale(float Scale)
+{
+	return static_cast<uint8>(FMath::RoundToInt(FMath::Clamp(Scale, 0.0f, 1.0f) * 255.0f));
+}
+
+float FKPCMovementRecording::DecompressInputScale(uint8 Scale)
+{
+	return static_cast<float>(Scale) / 255.0f;
+}
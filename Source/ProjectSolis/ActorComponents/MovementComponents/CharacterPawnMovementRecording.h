@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class EKPCMovementRecordEventType : uint8
+{
+	Jump,
+	AddVerticalForce
+};
+
+// A call made on the movement component between two movement frames that is not captured by the movement input state.
+struct FKPCMovementRecordEvent
+{
+	EKPCMovementRecordEventType Type = EKPCMovementRecordEventType::Jump;
+	// Force passed to AddVerticalForce. Unused for jumps.
+	float Value = 0.0f;
+};
+
+// Everything needed to reproduce a single movement frame and the result the frame produced.
+struct FKPCMovementRecordFrame
+{
+	// Inputs.
+	float DeltaTime = 0.0f;
+	FVector InputDirection = FVector::ZeroVector;
+	float InputScale = 0.0f;
+	TArray<FKPCMovementRecordEvent, TInlineAllocator<2>> Events = {};
+
+	// Results.
+	FVector Location = FVector::ZeroVector;
+	FRotator Rotation = FRotator::ZeroRotator;
+	FVector Velocity = FVector::ZeroVector;
+};
+
+/**
+ * A recorded character pawn movement session. Serialized as a compact binary stream: frame results are delta encoded against the previous frame in fixed point, input
+ * and delta time are only written when they change and all integers are variable length encoded. Delta time and events are stored exactly so a replay feeds the
+ * component the same values. Input direction is quantized to a 16 bit yaw and input scale to 8 bits.
+ */
+class PROJECTSOLIS_API FKPCMovementRecording
+{
+public:
+	// Resolution of recorded locations (cm) and velocities (cm/s).
+	static constexpr double LocationResolution = 0.01;
+	static constexpr double VelocityResolution = 0.01;
+
+	// The map and pawn class the session was recorded with.
+	FString MapPackageName = {};
+	FString PawnClassPath = {};
+
+	// The pawn's state when recording started.
+	FVector InitialLocation = FVector::ZeroVector;
+	FQuat InitialRotation = FQuat::Identity;
+	FVector InitialVelocity = FVector::ZeroVector;
+	float InitialFixedTimestepAccumulator = 0.0f;
+
+	TArray<FKPCMovementRecordFrame> Frames = {};
+
+public:
+	void Serialize(FArchive& Ar);
+
+	bool SaveToFile(const FString& Path) const;
+	bool LoadFromFile(const FString& Path);
+
+	// Returns the input direction and scale as they will be read back from a saved recording.
+	static FVector QuantizeInputDirection(const FVector& Direction);
+	static float QuantizeInputScale(float Scale);
+
+	// Compress a horizontal movement input direction to a 16 bit yaw and a movement input scale to 8 bits. Shared with networked moves.
+	static uint16 CompressInputDirection(const FVector& Direction);
+	static FVector DecompressInputDirection(uint16 Yaw);
+	static uint8 CompressInputScale(float Scale);
+	static float DecompressInputScale(uint8 Scale);
+};
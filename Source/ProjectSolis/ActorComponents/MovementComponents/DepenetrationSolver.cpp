@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DepenetrationSolver.h"
+#include "KinematicPawnStats.h"
+
+FVector FKPCDepenetrationSolver::Solve(TConstArrayView<FKPCPenetrationContact> Contacts, int32 MaxIterations, double Tolerance)
+{
+	INC_DWORD_STAT(STAT_KPCDepenetrationSolves);
+
+	// Start each contact from its push in the last solve if it was part of it.
+	FVector Fixup(0.0);
+	bool bWarmStarted = false;
+	Pushes.SetNumUninitialized(Contacts.Num());
+	for (int32 i = 0; i < Contacts.Num(); ++i)
+	{
+		const FKPCPenetrationContact& Contact = Contacts[i];
+		const FWarmStartEntry* Entry = WarmStart.FindByPredicate([&Contact](const FWarmStartEntry& It)
+			{
+				return ((It.Component == Contact.Component) && (It.Item == Contact.Item));
+			});
+
+		Pushes[i] = (Entry != nullptr) ? Entry->Push : 0.0;
+		if (Pushes[i] > 0.0)
+		{
+			Fixup += Pushes[i] * Contact.Normal;
+			bWarmStarted = true;
+		}
+	}
+
+	if (bWarmStarted)
+	{
+		INC_DWORD_STAT(STAT_KPCDepenetrationWarmStarts);
+	}
+
+	// Pushes may shrink as well as grow so a warm start that overshoots is corrected, but never become negative as a contact can only push the pawn away.
+	bool bConverged = false;
+	for (int32 Iteration = 0; Iteration < MaxIterations; ++Iteration)
+	{
+		INC_DWORD_STAT(STAT_KPCDepenetrationIterations);
+
+		double MaxChange = 0.0;
+		for (int32 i = 0; i < Contacts.Num(); ++i)
+		{
+			const FKPCPenetrationContact& Contact = Contacts[i];
+			// Take the dot product of the fixup and the normal to determine how much of the penetration has already been taken care of.
+			const double NewPush = FMath::Max(0.0, Pushes[i] + (Contact.Depth - FVector::DotProduct(Fixup, Contact.Normal)));
+			const double Change = NewPush - Pushes[i];
+			Fixup += Change * Contact.Normal;
+			Pushes[i] = NewPush;
+			MaxChange = FMath::Max(MaxChange, FMath::Abs(Change));
+		}
+
+		if (MaxChange <= Tolerance)
+		{
+			bConverged = true;
+			break;
+		}
+	}
+
+	if (!bConverged)
+	{
+		INC_DWORD_STAT(STAT_KPCDepenetrationUnconverged);
+	}
+
+	double Residual = 0.0;
+	WarmStart.Reset();
+	for (int32 i = 0; i < Contacts.Num(); ++i)
+	{
+		Residual = FMath::Max(Residual, Contacts[i].Depth - FVector::DotProduct(Fixup, Contacts[i].Normal));
+		WarmStart.Add({ Contacts[i].Component, Contacts[i].Item, Pushes[i] });
+	}
+	INC_FLOAT_STAT_BY(STAT_KPCDepenetrationResidual, static_cast<float>(Residual));
+
+	return Fixup;
+}
+
+void FKPCDepenetrationSolver::Reset()
+{
+	WarmStart.Reset();
+}
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UPrimitiveComponent;
+
+// A primitive the pawn overlaps at the start of a move and the minimum translation that separates the pawn from it.
+struct FKPCPenetrationContact
+{
+	// Only used to recognise the same contact across solves. Never dereferenced.
+	const UPrimitiveComponent* Component = nullptr;
+	int32 Item = INDEX_NONE;
+	FVector Normal = FVector::UpVector;
+	// The distance to move along the normal to separate from the primitive, including any extra separation wanted.
+	double Depth = 0.0;
+};
+
+/**
+ * Finds the translation that moves the pawn out of every contact it overlaps. Solves for how far the pawn is pushed along each contact's normal with projected
+ * Gauss-Seidel iterations that stop as soon as no push changes by more than the tolerance. The pushes found for each contact are kept and used as the starting
+ * point of the next solve for the contacts that are still overlapped, so a pawn held against the same geometry, such as when pushed into a corner, converges
+ * in one or two iterations instead of solving from zero every frame.
+ */
+class PROJECTSOLIS_API FKPCDepenetrationSolver
+{
+private:
+	static constexpr int32 InlineContactCount = 8;
+
+	struct FWarmStartEntry
+	{
+		const UPrimitiveComponent* Component = nullptr;
+		int32 Item = INDEX_NONE;
+		double Push = 0.0;
+	};
+
+	// The pushes found by the last solve.
+	TArray<FWarmStartEntry, TInlineAllocator<InlineContactCount>> WarmStart = {};
+	TArray<double, TInlineAllocator<InlineContactCount>> Pushes = {};
+
+public:
+	// Returns the translation that separates the pawn from every contact, or the best found within the iteration budget. Reports the iterations used, the
+	// deepest penetration left unresolved and whether the solve was warm started to the kinematic pawn stats.
+	FVector Solve(TConstArrayView<FKPCPenetrationContact> Contacts, int32 MaxIterations, double Tolerance);
+
+	// Forgets the pushes of the last solve. Call when the pawn is teleported.
+	void Reset();
+};
@@ -0,0 +1,205 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GroundHeightGrid.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+
+FKPCGroundHeightGrid::FKPCGroundHeightGrid() = default;
+
+FKPCGroundHeightGrid::~FKPCGroundHeightGrid()
+{
+	Close();
+}
+
+FString FKPCGroundHeightGrid::GetGridPathForMap(const FString& MapPackageName)
+{
+	return FPaths::ProjectContentDir() / TEXT("GroundHeightGrids") / (FPackageName::GetShortName(MapPackageName) + TEXT(".kpcg"));
+}
+
+bool FKPCGroundHeightGrid::Open(const FString& Path)
+{
+	Close();
+
+	IMappedFileHandle* Handle = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Path);
+	if (Handle == nullptr)
+	{
+		return false;
+	}
+	MappedFile.Reset(Handle);
+
+	// Read the header and tile table through a temporary region so they are not kept resident.
+	if (MappedFile->GetFileSize() < static_cast<int64>(sizeof(FKPCGroundHeightGridHeader)))
+	{
+		Close();
+		return false;
+	}
+
+	{
+		TUniquePtr<IMappedFileRegion> HeaderRegion(MappedFile->MapRegion(0, sizeof(FKPCGroundHeightGridHeader)));
+		if (!HeaderRegion.IsValid())
+		{
+			Close();
+			return false;
+		}
+		FMemory::Memcpy(&Header, HeaderRegion->GetMappedPtr(), sizeof(FKPCGroundHeightGridHeader));
+	}
+
+	const int64 NumTiles = static_cast<int64>(Header.NumTilesX) * static_cast<int64>(Header.NumTilesY);
+	const int64 TableSize = NumTiles * static_cast<int64>(sizeof(int64));
+	if ((Header.Magic != Magic) || (Header.Version != Version) || (Header.SampleSpacing <= 0.0f) || (Header.TileSamples <= 0) || (NumTiles <= 0) ||
+		(MappedFile->GetFileSize() < static_cast<int64>(sizeof(FKPCGroundHeightGridHeader)) + TableSize))
+	{
+		Close();
+		return false;
+	}
+
+	{
+		TUniquePtr<IMappedFileRegion> TableRegion(MappedFile->MapRegion(sizeof(FKPCGroundHeightGridHeader), TableSize));
+		if (!TableRegion.IsValid())
+		{
+			Close();
+			return false;
+		}
+		TileOffsets.SetNumUninitialized(static_cast<int32>(NumTiles));
+		FMemory::Memcpy(TileOffsets.GetData(), TableRegion->GetMappedPtr(), TableSize);
+	}
+
+	Tiles.SetNum(static_cast<int32>(NumTiles));
+	return true;
+}
+
+void FKPCGroundHeightGrid::Close()
+{
+	// Regions must be released before the file they were mapped from.
+	Tiles.Reset();
+	TileOffsets.Reset();
+	MappedFile.Reset();
+	Header = {};
+}
+
+bool FKPCGroundHeightGrid::MapTile(int32 TileX, int32 TileY)
+{
+	FTile& Tile = Tiles[GetTileIndex(TileX, TileY)];
+	const int64 Offset = TileOffsets[GetTileIndex(TileX, TileY)];
+	if ((Tile.Region.IsValid()) || (Offset <= 0))
+	{
+		return false;
+	}
+
+	const int64 TileDataSize = GetTileDataSize(Header.TileSamples);
+	if (Offset + TileDataSize > MappedFile->GetFileSize())
+	{
+		return false;
+	}
+
+	Tile.Region.Reset(MappedFile->MapRegion(Offset, TileDataSize));
+	if (Tile.Region.IsValid())
+	{
+		const int32 NumSamples = FMath::Square(Header.TileSamples + 1);
+		Tile.Heights = reinterpret_cast<const float*>(Tile.Region->GetMappedPtr());
+		Tile.Normals = reinterpret_cast<const int8*>(Tile.Heights + NumSamples);
+	}
+	return Tile.Region.IsValid();
+}
+
+void FKPCGroundHeightGrid::UnmapTile(int32 TileX, int32 TileY)
+{
+	FTile& Tile = Tiles[GetTileIndex(TileX, TileY)];
+	Tile.Heights = nullptr;
+	Tile.Normals = nullptr;
+	Tile.Region.Reset();
+}
+
+bool FKPCGroundHeightGrid::SampleGround(double X, double Y, double& OutHeight, FVector& OutNormal) const
+{
+	if (!IsOpen())
+	{
+		return false;
+	}
+
+	// Find the tile and the cell within the tile.
+	const double GridX = (X - Header.OriginX) / static_cast<double>(Header.SampleSpacing);
+	const double GridY = (Y - Header.OriginY) / static_cast<double>(Header.SampleSpacing);
+	const int32 TileX = FMath::FloorToInt32(GridX / static_cast<double>(Header.TileSamples));
+	const int32 TileY = FMath::FloorToInt32(GridY / static_cast<double>(Header.TileSamples));
+	if ((TileX < 0) || (TileY < 0) || (TileX >= Header.NumTilesX) || (TileY >= Header.NumTilesY))
+	{
+		return false;
+	}
+
+	const FTile& Tile = Tiles[GetTileIndex(TileX, TileY)];
+	if (Tile.Heights == nullptr)
+	{
+		return false;
+	}
+
+	const double LocalX = GridX - static_cast<double>(TileX * Header.TileSamples);
+	const double LocalY = GridY - static_cast<double>(TileY * Header.TileSamples);
+	const int32 CellX = FMath::Min(FMath::FloorToInt32(LocalX), Header.TileSamples - 1);
+	const int32 CellY = FMath::Min(FMath::FloorToInt32(LocalY), Header.TileSamples - 1);
+	const double AlphaX = LocalX - static_cast<double>(CellX);
+	const double AlphaY = LocalY - static_cast<double>(CellY);
+
+	const int32 Stride = Header.TileSamples + 1;
+	const int32 Indices[4] =
+	{
+		(CellY * Stride) + CellX,
+		(CellY * Stride) + CellX + 1,
+		((CellY + 1) * Stride) + CellX,
+		((CellY + 1) * Stride) + CellX + 1
+	};
+
+	for (int32 Index : Indices)
+	{
+		if (Tile.Heights[Index] == InvalidHeight)
+		{
+			return false;
+		}
+	}
+
+	OutHeight = FMath::BiLerp(static_cast<double>(Tile.Heights[Indices[0]]), static_cast<double>(Tile.Heights[Indices[1]]),
+		static_cast<double>(Tile.Heights[Indices[2]]), static_cast<double>(Tile.Heights[Indices[3]]), AlphaX, AlphaY);
+
+	OutNormal = FMath::BiLerp(DecompressNormal(Tile.Normals[Indices[0] * 2], Tile.Normals[(Indices[0] * 2) + 1]),
+		DecompressNormal(Tile.Normals[Indices[1] * 2], Tile.Normals[(Indices[1] * 2) + 1]),
+		DecompressNormal(Tile.Normals[Indices[2] * 2], Tile.Normals[(Indices[2] * 2) + 1]),
+		DecompressNormal(Tile.Normals[Indices[3] * 2], Tile.Normals[(Indices[3] * 2) + 1]), AlphaX, AlphaY).GetSafeNormal(UE_SMALL_NUMBER, FVector::UpVector);
+
+	return true;
+}
+
+FIntPoint FKPCGroundHeightGrid::GetTileCoordinates(double X, double Y) const
+{
+	const double TileSize = static_cast<double>(Header.SampleSpacing) * static_cast<double>(Header.TileSamples);
+	return FIntPoint(FMath::Clamp(FMath::FloorToInt32((X - Header.OriginX) / TileSize), 0, FMath::Max(Header.NumTilesX - 1, 0)),
+		FMath::Clamp(FMath::FloorToInt32((Y - Header.OriginY) / TileSize), 0, FMath::Max(Header.NumTilesY - 1, 0)));
+}
+
+FBox2D FKPCGroundHeightGrid::GetTileBounds(int32 TileX, int32 TileY) const
+{
+	const double TileSize = static_cast<double>(Header.SampleSpacing) * static_cast<double>(Header.TileSamples);
+	const FVector2D Min(Header.OriginX + (static_cast<double>(TileX) * TileSize), Header.OriginY + (static_cast<double>(TileY) * TileSize));
+	return FBox2D(Min, Min + FVector2D(TileSize));
+}
+
+int64 FKPCGroundHeightGrid::GetTileDataSize(int32 TileSamples)
+{
+	const int64 NumSamples = FMath::Square(static_cast<int64>(TileSamples) + 1);
+	return (NumSamples * static_cast<int64>(sizeof(float))) + (NumSamples * 2 * static_cast<int64>(sizeof(int8)));
+}
+
+void FKPCGroundHeightGrid::CompressNormal(const FVector& Normal, int8& OutX, int8& OutY)
+{
+	OutX = static_cast<int8>(FMath::Clamp(FMath::RoundToInt32(Normal.X * 127.0), -127, 127));
+	OutY = static_cast<int8>(FMath::Clamp(FMath::RoundToInt32(Normal.Y * 127.0), -127, 127));
+}
+
+FVector FKPCGroundHeightGrid::DecompressNormal(int8 X, int8 Y)
+{
+	const double NormalX = static_cast<double>(X) / 127.0;
+	const double NormalY = static_cast<double>(Y) / 127.0;
+	return FVector(NormalX, NormalY, FMath::Sqrt(FMath::Max(1.0 - (NormalX * NormalX) - (NormalY * NormalY), 0.0)));
+}
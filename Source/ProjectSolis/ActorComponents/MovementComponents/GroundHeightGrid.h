@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+// Fixed size header at the start of a ground height grid file. Followed by a table of NumTilesX * NumTilesY tile offsets (int64, zero for tiles without data) and
+// then the tile data. Tile data is (TileSamples + 1)^2 float heights followed by (TileSamples + 1)^2 pairs of int8 normal X and Y components. Tiles share their edge
+// samples with their neighbours so a lookup never needs more than one tile.
+struct FKPCGroundHeightGridHeader
+{
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	float SampleSpacing = 0.0f;
+	int32 TileSamples = 0;
+	double OriginX = 0.0;
+	double OriginY = 0.0;
+	int32 NumTilesX = 0;
+	int32 NumTilesY = 0;
+	// The collision channel the grid was traced on.
+	int32 CollisionChannel = 0;
+};
+
+/**
+ * A tiled 2.5D grid of the heights and normals of the highest static surface blocking movement traces, baked offline by the ground height grid bake commandlet.
+ * The grid file is memory mapped and tiles are mapped into memory individually so only tiles that are in use are resident. Lookups are a bilinear blend of the
+ * four surrounding samples and fail where any of them is invalid, for example over holes, steep discontinuities or movable geometry.
+ */
+class PROJECTSOLIS_API FKPCGroundHeightGrid
+{
+public:
+	static constexpr uint32 Magic = 0x4743504B; // "KPCG"
+	static constexpr uint32 Version = 2;
+	// Height stored for samples that have no valid static ground.
+	static constexpr float InvalidHeight = -UE_MAX_FLT;
+
+private:
+	struct FTile
+	{
+		TUniquePtr<IMappedFileRegion> Region = nullptr;
+		const float* Heights = nullptr;
+		const int8* Normals = nullptr;
+	};
+
+	FKPCGroundHeightGridHeader Header = {};
+	TArray<int64> TileOffsets = {};
+	TArray<FTile> Tiles = {};
+	TUniquePtr<IMappedFileHandle> MappedFile = nullptr;
+
+public:
+	FKPCGroundHeightGrid();
+	~FKPCGroundHeightGrid();
+
+	// Returns the path the grid for the map package is baked to and loaded from.
+	static FString GetGridPathForMap(const FString& MapPackageName);
+
+	// Opens the grid file for mapping. No tiles are mapped. Returns false if the file does not exist or is not a valid grid file.
+	bool Open(const FString& Path);
+	void Close();
+	bool IsOpen() const { return MappedFile.IsValid(); }
+
+	// Maps or unmaps a single tile. Tiles without data are ignored. Returns true if the tile was mapped by this call.
+	bool MapTile(int32 TileX, int32 TileY);
+	void UnmapTile(int32 TileX, int32 TileY);
+	bool IsTileMapped(int32 TileX, int32 TileY) const { return Tiles[GetTileIndex(TileX, TileY)].Heights != nullptr; }
+
+	// Samples the ground height and normal under the location. Returns false if the location is outside of the grid, its tile is not mapped or any of the
+	// surrounding samples is invalid. Safe to call from any thread while tiles are not being mapped or unmapped.
+	bool SampleGround(double X, double Y, double& OutHeight, FVector& OutNormal) const;
+
+	// Returns the tile containing the location, clamped to the grid.
+	FIntPoint GetTileCoordinates(double X, double Y) const;
+	FBox2D GetTileBounds(int32 TileX, int32 TileY) const;
+	int32 GetNumTilesX() const { return Header.NumTilesX; }
+	int32 GetNumTilesY() const { return Header.NumTilesY; }
+	ECollisionChannel GetCollisionChannel() const { return static_cast<ECollisionChannel>(Header.CollisionChannel); }
+
+	// The size in bytes of a tile's data.
+	static int64 GetTileDataSize(int32 TileSamples);
+
+	// Normals are stored as the X and Y components of an upward facing unit vector quantized to 8 bits each.
+	static void CompressNormal(const FVector& Normal, int8& OutX, int8& OutY);
+	static FVector DecompressNormal(int8 X, int8 Y);
+
+private:
+	int32 GetTileIndex(int32 TileX, int32 TileY) const { return (TileY * Header.NumTilesX) + TileX; }
+};
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "KinematicPawnStats.h"
+
+CSV_DEFINE_CATEGORY_MODULE(PROJECTSOLIS_API, KinematicPawn, true);
+
+DEFINE_LOG_CATEGORY(LogKinematicPawn);
+
+DEFINE_STAT(STAT_KPCTickMovement);
+DEFINE_STAT(STAT_KPCBatchTick);
+DEFINE_STAT(STAT_KPCAsyncPhysicsTick);
+DEFINE_STAT(STAT_KPCAsyncMarshalling);
+DEFINE_STAT(STAT_KPCRotation);
+DEFINE_STAT(STAT_KPCOutOfCollision);
+DEFINE_STAT(STAT_KPCHorizontalMovement);
+DEFINE_STAT(STAT_KPCVerticalMovement);
+DEFINE_STAT(STAT_KPCStepUp);
+DEFINE_STAT(STAT_KPCSnapDown);
+DEFINE_STAT(STAT_KPCMovementBase);
+DEFINE_STAT(STAT_KPCCommitTransform);
+DEFINE_STAT(STAT_KPCGroundGridStreaming);
+
+DEFINE_STAT(STAT_KPCWorldQueries);
+DEFINE_STAT(STAT_KPCNeighbourhoodGather);
+DEFINE_STAT(STAT_KPCNeighbourhoodQueries);
+
+DEFINE_STAT(STAT_KPCSweeps);
+DEFINE_STAT(STAT_KPCLineTraces);
+DEFINE_STAT(STAT_KPCMultiSweepHits);
+DEFINE_STAT(STAT_KPCDepenetrationIterations);
+DEFINE_STAT(STAT_KPCDepenetrationSolves);
+DEFINE_STAT(STAT_KPCDepenetrationWarmStarts);
+DEFINE_STAT(STAT_KPCDepenetrationUnconverged);
+DEFINE_STAT(STAT_KPCDepenetrationResidual);
+DEFINE_STAT(STAT_KPCSlideIterations);
+DEFINE_STAT(STAT_KPCMovementBaseChanges);
+DEFINE_STAT(STAT_KPCStepCacheHits);
+
+DEFINE_STAT(STAT_KPCNeighbourhoodPrimitives);
+DEFINE_STAT(STAT_KPCNeighbourhoodHits);
+DEFINE_STAT(STAT_KPCNeighbourhoodFallbacks);
+DEFINE_STAT(STAT_KPCAnalyticSweeps);
+DEFINE_STAT(STAT_KPCAnalyticSweepsUnresolved);
+DEFINE_STAT(STAT_KPCAsyncCollisionOverruns);
+
+DEFINE_STAT(STAT_KPCGroundProbesRequested);
+DEFINE_STAT(STAT_KPCGroundProbesCached);
+DEFINE_STAT(STAT_KPCGroundProbeQueriesSaved);
+
+DEFINE_STAT(STAT_KPCGroundGridLookups);
+DEFINE_STAT(STAT_KPCGroundGridFallbacks);
+DEFINE_STAT(STAT_KPCGroundGridMappedTiles);
+
+DEFINE_STAT(STAT_KPCFramesLOD0);
+DEFINE_STAT(STAT_KPCFramesLOD1);
+DEFINE_STAT(STAT_KPCFramesLOD2);
+DEFINE_STAT(STAT_KPCFramesSkippedByLOD);
+
+DEFINE_STAT(STAT_KPCLookInputLatency);
+
+DEFINE_STAT(STAT_KPCFramesSkippedAsleep);
@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+DECLARE_STATS_GROUP(TEXT("KinematicPawn"), STATGROUP_KinematicPawn, STATCAT_Advanced);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(PROJECTSOLIS_API, KinematicPawn);
+
+// Log category for the kinematic pawn controller and the systems it relies on.
+PROJECTSOLIS_API DECLARE_LOG_CATEGORY_EXTERN(LogKinematicPawn, Log, All);
+
+// Movement tick phase cycle counters.
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tick Movement"), STAT_KPCTickMovement, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Batch Tick"), STAT_KPCBatchTick, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Async Physics Tick"), STAT_KPCAsyncPhysicsTick, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Async Marshalling"), STAT_KPCAsyncMarshalling, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Rotation"), STAT_KPCRotation, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Out Of Collision"), STAT_KPCOutOfCollision, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Horizontal Movement"), STAT_KPCHorizontalMovement, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Vertical Movement"), STAT_KPCVerticalMovement, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Step Up"), STAT_KPCStepUp, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Snap Down"), STAT_KPCSnapDown, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Movement Base"), STAT_KPCMovementBase, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Commit Transform"), STAT_KPCCommitTransform, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Ground Grid Streaming"), STAT_KPCGroundGridStreaming, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+
+// Scene query cost. Compare World Queries with the collision neighbourhood cache disabled against the sum of all three with it enabled.
+DECLARE_CYCLE_STAT_EXTERN(TEXT("World Queries"), STAT_KPCWorldQueries, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Neighbourhood Gather"), STAT_KPCNeighbourhoodGather, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Neighbourhood Queries"), STAT_KPCNeighbourhoodQueries, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+
+// Scene query and solver iteration counters.
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Sweeps"), STAT_KPCSweeps, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Line Traces"), STAT_KPCLineTraces, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Multi Sweep Hits"), STAT_KPCMultiSweepHits, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Depenetration Iterations"), STAT_KPCDepenetrationIterations, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Depenetration Solves"), STAT_KPCDepenetrationSolves, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Depenetration Warm Starts"), STAT_KPCDepenetrationWarmStarts, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Depenetration Unconverged Solves"), STAT_KPCDepenetrationUnconverged, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+// The sum over every depenetration solve of the deepest penetration the solve left unresolved, in cm. Divide by Depenetration Solves for the mean.
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Depenetration Residual"), STAT_KPCDepenetrationResidual, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Slide Iterations"), STAT_KPCSlideIterations, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Movement Base Changes"), STAT_KPCMovementBaseChanges, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Step Cache Hits"), STAT_KPCStepCacheHits, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+
+// Collision neighbourhood cache counters.
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Neighbourhood Primitives"), STAT_KPCNeighbourhoodPrimitives, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Neighbourhood Query Hits"), STAT_KPCNeighbourhoodHits, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Neighbourhood Query Fallbacks"), STAT_KPCNeighbourhoodFallbacks, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Analytic Sweeps"), STAT_KPCAnalyticSweeps, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+// Analytic sweeps that could not find the time of impact and were repeated with a physics sweep.
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Analytic Sweeps Unresolved"), STAT_KPCAnalyticSweepsUnresolved, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+// Scene queries on the physics thread that reached outside the collision primitives gathered with the step's input and may have missed geometry.
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Async Collision Bounds Overruns"), STAT_KPCAsyncCollisionOverruns, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+
+// Ground probe cache counters.
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Ground Probes Requested"), STAT_KPCGroundProbesRequested, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Ground Probes Served From Cache"), STAT_KPCGroundProbesCached, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Ground Probe Scene Queries Saved"), STAT_KPCGroundProbeQueriesSaved, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+
+// Ground height grid counters.
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Ground Grid Lookups"), STAT_KPCGroundGridLookups, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Ground Grid Fallbacks"), STAT_KPCGroundGridFallbacks, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Ground Grid Mapped Tiles"), STAT_KPCGroundGridMappedTiles, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+
+// Movement LOD counters. The number of movement frames run at each LOD.
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Frames At LOD0 (Full)"), STAT_KPCFramesLOD0, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Frames At LOD1 (Reduced Rate)"), STAT_KPCFramesLOD1, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Frames At LOD2 (Ground Snap)"), STAT_KPCFramesLOD2, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Frames Skipped By LOD"), STAT_KPCFramesSkippedByLOD, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+
+// Time in milliseconds from the start of the frame that polled look input to the back buffer of the first frame using it being ready to present. A lower bound
+// of motion to photon latency, as time in the OS input queue, the present queue and the display is not included.
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Look Input Latency (ms)"), STAT_KPCLookInputLatency, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+
+// The number of movement frames skipped by sleeping pawns.
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Frames Skipped Asleep"), STAT_KPCFramesSkippedAsleep, STATGROUP_KinematicPawn, PROJECTSOLIS_API);
+
+// Times the enclosing scope with the given cycle stat and emits an Unreal Insights CPU event of the same phase so both stat KinematicPawn and Insights show the
+// same breakdown. Insights events are emitted without needing stat named events to be enabled.
+#define KPC_SCOPE_CYCLE_COUNTER(Stat, TraceName) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(TraceName)
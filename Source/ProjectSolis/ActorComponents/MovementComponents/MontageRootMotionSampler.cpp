@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MontageRootMotionSampler.h"
+#include "Animation/AnimInstance.h"
+#include "Animation/AnimMontage.h"
+
+void FKPCMontageRootMotionSampler::Sync(const UAnimInstance* AnimInstance)
+{
+	const FAnimMontageInstance* MontageInstance = (AnimInstance != nullptr) ? AnimInstance->GetRootMotionMontageInstance() : nullptr;
+	if ((MontageInstance == nullptr) || (!IsValid(MontageInstance->Montage)))
+	{
+		Reset();
+		return;
+	}
+
+	Montage = MontageInstance->Montage;
+	Position = MontageInstance->GetPosition();
+	PlayRate = (MontageInstance->IsPlaying()) ? MontageInstance->GetPlayRate() : 0.0f;
+
+	const int32 SectionIndex = MontageInstance->Montage->GetSectionIndexFromPosition(Position);
+	NextSectionIndex = (SectionIndex != INDEX_NONE) ? MontageInstance->GetNextSectionID(SectionIndex) : INDEX_NONE;
+}
+
+FTransform FKPCMontageRootMotionSampler::Advance(float DeltaTime)
+{
+	const UAnimMontage* SampledMontage = Montage.Get();
+	if (SampledMontage == nullptr)
+	{
+		return FTransform::Identity;
+	}
+
+	const int32 SectionIndex = SampledMontage->GetSectionIndexFromPosition(Position);
+	float SectionStartTime = 0.0f;
+	float SectionEndTime = SampledMontage->GetPlayLength();
+	if (SectionIndex != INDEX_NONE)
+	{
+		SampledMontage->GetSectionStartAndEndTime(SectionIndex, SectionStartTime, SectionEndTime);
+	}
+
+	float Remaining = DeltaTime * PlayRate * SampledMontage->RateScale;
+	const bool bPlayingForward = (Remaining > 0.0f);
+	const float NewPosition = FMath::Clamp(Position + Remaining, SectionStartTime, SectionEndTime);
+	FTransform RootMotion = SampledMontage->ExtractRootMotionFromTrackRange(Position, NewPosition);
+	Remaining -= (NewPosition - Position);
+	Position = NewPosition;
+
+	// Continue into the next section on reaching the end of this one, the same as the instance does. Only the section after the one the instance was in is
+	// known, so further sections are picked up by the next Sync.
+	if ((bPlayingForward) && (Position >= SectionEndTime) && (NextSectionIndex != INDEX_NONE))
+	{
+		float NextSectionStartTime = 0.0f;
+		float NextSectionEndTime = 0.0f;
+		SampledMontage->GetSectionStartAndEndTime(NextSectionIndex, NextSectionStartTime, NextSectionEndTime);
+
+		Position = FMath::Min(NextSectionStartTime + Remaining, NextSectionEndTime);
+		RootMotion = SampledMontage->ExtractRootMotionFromTrackRange(NextSectionStartTime, Position) * RootMotion;
+		NextSectionIndex = (NextSectionIndex == SectionIndex) ? SectionIndex : INDEX_NONE;
+	}
+
+	return RootMotion;
+}
+
+void FKPCMontageRootMotionSampler::Reset()
+{
+	Montage = nullptr;
+	Position = 0.0f;
+	PlayRate = 0.0f;
+	NextSectionIndex = INDEX_NONE;
+}
@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UAnimInstance;
+class UAnimMontage;
+
+/**
+ * Samples the root motion of the montage playing on an anim instance directly from the montage's animation data. The sampler reads the montage instance's
+ * position every frame and advances it by the movement timestep, so root motion is extracted at the rate movement is simulated and does not depend on the
+ * skeletal mesh ticking or evaluating its pose. Reaching the end of a section continues into the section the instance will play next, so looping sections and
+ * section jumps are followed, and the instance's own position changes, such as Montage_SetPosition, are picked up on the next frame. Sampling stops when the
+ * instance stops being the root motion montage instance. Root motion is sampled at full weight.
+ */
+class PROJECTSOLIS_API FKPCMontageRootMotionSampler
+{
+private:
+	TWeakObjectPtr<const UAnimMontage> Montage = nullptr;
+	float Position = 0.0f;
+	float PlayRate = 0.0f;
+	// The section the instance plays after the one containing Position, or INDEX_NONE if it ends there.
+	int32 NextSectionIndex = INDEX_NONE;
+
+public:
+	// Reads the position, play rate and next section of the anim instance's root motion montage instance, or stops sampling when no root motion montage is
+	// playing. Call every frame before advancing.
+	void Sync(const UAnimInstance* AnimInstance);
+
+	// Advances the montage position by the time step and returns the root motion over the advanced range. Playing in reverse stops at the start of the section.
+	FTransform Advance(float DeltaTime);
+
+	bool IsSampling() const { return Montage.IsValid(); }
+
+	void Reset();
+};
@@ -3,7 +3,15 @@
 #include "ThirdPersonFollowCamera.h"
 #include "Camera/CameraComponent.h"
 #include "Kismet/GameplayStatics.h"
+#include "Engine/GameViewportClient.h"
+#include "Framework/Application/SlateApplication.h"
+#include "Rendering/SlateRenderer.h"
+#include "RenderingThread.h"
 #include "../Pawns/CharacterPawn.h"
+#include "../Controllers/PlayerControllers/CharacterPawnPlayerController.h"
+#include "../../Subsystems/CameraSubsystems/CameraCollisionSubsystem.h"
+#include "../../ActorComponents/MovementComponents/CharacterPawnMovementComponent.h"
+#include "../../ActorComponents/MovementComponents/KinematicPawnStats.h"
 
 AThirdPersonFollowCamera::AThirdPersonFollowCamera()
 {
@@ -23,44 +31,116 @@ void AThirdPersonFollowCamera::BeginPlay()
 	World = GetWorld();
 	PlayerPawn = UGameplayStatics::GetPlayerPawn(World, 0);
 	PlayerController = UGameplayStatics::GetPlayerController(World, 0);
+	CharacterPawnPlayerController = Cast<ACharacterPawnPlayerController>(PlayerController);
 
-	// Ensure this actor ticks after the player controller and the player pawn.
-	// This ensures the player controller's rotation is updated from look input and the player pawn is moved before the camera updates its viewpoint.
-	AddTickPrerequisiteActor(PlayerController);
-	AddTickPrerequisiteActor(PlayerPawn);
+	if (bLateUpdateView)
+	{
+		// The view is composed when the camera manager builds it, after every actor has ticked, so the camera does not need to tick.
+		SetActorTickEnabled(false);
+	}
+	else
+	{
+		// Ensure this actor ticks after the player controller and the player pawn.
+		// This ensures the player controller's rotation is updated from look input and the player pawn is moved before the camera updates its viewpoint.
+		AddTickPrerequisiteActor(PlayerController);
+		AddTickPrerequisiteActor(PlayerPawn);
+	}
+
+	// The actor transform carries the back offset, so the camera component only keeps its authored sideways and vertical offset.
+	FVector RelativeCameraLocation = Camera->GetRelativeLocation();
+	RelativeCameraLocation.X = 0.0;
+	Camera->SetRelativeLocation(RelativeCameraLocation);
 
-	ApplyRelativeBackOffsetValue(RelativeBackOffset);
+	CameraCollision = World->GetSubsystem<UCameraCollisionSubsystem>();
+	if (CameraCollision != nullptr)
+	{
+		CameraCollision->RegisterCamera(this);
+	}
+
+	// Measure look input latency up to the game window's back buffer being ready to present. Not available without a renderer, such as in commandlets.
+	if ((FSlateApplication::IsInitialized()) && (FSlateApplication::Get().GetRenderer() != nullptr) && (IsValid(GEngine->GameViewport)))
+	{
+		GameWindow = GEngine->GameViewport->GetWindow().Get();
+		BackBufferReadyToPresentHandle = FSlateApplication::Get().GetRenderer()->OnBackBufferReadyToPresent().AddLambda([this](SWindow& Window, const FTextureRHIRef& BackBuffer)
+			{
+				// Called on the rendering thread for every window presented. The first game window presented after the sample time was sent is the frame using it.
+				if ((&Window != GameWindow) || (PendingPresentLookInputSampleTime <= 0.0))
+				{
+					return;
+				}
+
+				const float LatencyMs = static_cast<float>((FPlatformTime::Seconds() - PendingPresentLookInputSampleTime) * 1000.0);
+				PendingPresentLookInputSampleTime = 0.0;
+				SET_FLOAT_STAT(STAT_KPCLookInputLatency, LatencyMs);
+				CSV_CUSTOM_STAT(KinematicPawn, LookInputLatencyMs, LatencyMs, ECsvCustomStatOp::Set);
+			});
+	}
 
 	// Look through this camera.
 	PlayerController->SetViewTarget(this);
 }
 
+void AThirdPersonFollowCamera::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (CameraCollision != nullptr)
+	{
+		CameraCollision->UnregisterCamera(this);
+		CameraCollision = nullptr;
+	}
+
+	// The callback runs on the rendering thread, so make sure it is not running before removing it.
+	if (BackBufferReadyToPresentHandle.IsValid())
+	{
+		FlushRenderingCommands();
+		if ((FSlateApplication::IsInitialized()) && (FSlateApplication::Get().GetRenderer() != nullptr))
+		{
+			FSlateApplication::Get().GetRenderer()->OnBackBufferReadyToPresent().Remove(BackBufferReadyToPresentHandle);
+		}
+		BackBufferReadyToPresentHandle.Reset();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void AThirdPersonFollowCamera::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
 	//UE_LOG(LogTemp, Warning, TEXT("Camera tick"));
 
-	// Rotate actor to match control rotation.
-	SetActorRotation(PlayerController->GetControlRotation());
-	// Move the camera to the player pawn.
-	SetActorLocation(PlayerPawn->GetActorLocation());
+	UpdateView(DeltaTime);
+}
+
+void AThirdPersonFollowCamera::CalcCamera(float DeltaTime, FMinimalViewInfo& OutResult)
+{
+	if (bLateUpdateView)
+	{
+		UpdateView(DeltaTime);
+	}
 
-	UpdateRelativeBackOffsetValue();
+	Super::CalcCamera(DeltaTime, OutResult);
 }
 
-void AThirdPersonFollowCamera::ApplyRelativeBackOffsetValue(const float Value)
+void AThirdPersonFollowCamera::UpdateView(const float DeltaTime)
 {
-	FVector NewRelativeCameraLocation = Camera->GetRelativeLocation();
-	NewRelativeCameraLocation.X = -static_cast<double>(Value);
-	Camera->SetRelativeLocation(NewRelativeCameraLocation);
+	// Follow the pawn's interpolated location when it has one so the camera moves smoothly with a fixed timestep.
+	const FRotator ViewRotation = PlayerController->GetControlRotation();
+	ACharacterPawn* CharacterPawn = Cast<ACharacterPawn>(PlayerPawn);
+	const FVector PivotLocation = (IsValid(CharacterPawn)) ? CharacterPawn->GetCharacterPawnMovementComponent()->GetInterpolatedLocation() : PlayerPawn->GetActorLocation();
+
+	const float BackOffset = CalculateRelativeBackOffsetValue(ViewRotation, PivotLocation, DeltaTime);
+
+	// Write the composed transform once so the camera component's world transform is only updated once per frame.
+	SetActorLocationAndRotation(PivotLocation + ViewRotation.RotateVector(FVector(-static_cast<double>(BackOffset), 0.0, 0.0)), ViewRotation);
+
+	RecordLookInputLatency();
 }
 
-void AThirdPersonFollowCamera::UpdateRelativeBackOffsetValue()
+float AThirdPersonFollowCamera::CalculateRelativeBackOffsetValue(const FRotator& ViewRotation, const FVector& PivotLocation, const float DeltaTime)
 {
 	// Calculate new relative back offset value based on how much the camera is looking up or down.
 	float NewRelativeBackOffset = RelativeBackOffset;
-	const float ActorForwardDotWorldUp = -static_cast<float>(FVector::DotProduct(GetActorForwardVector(), FVector::UpVector));
+	const float ActorForwardDotWorldUp = -static_cast<float>(FVector::DotProduct(ViewRotation.Vector(), FVector::UpVector));
 	if (ActorForwardDotWorldUp > 0.f)
 	{
 		// Looking down.
@@ -72,6 +152,47 @@ void AThirdPersonFollowCamera::UpdateRelativeBackOffsetValue()
 		NewRelativeBackOffset += ScaledAdditiveRelativeBackOffsetLookUpValue * FMath::Abs(ActorForwardDotWorldUp);
 	}
 
-	// Apply relative back offset to the camera components relative location overwriting any previous relative X location.
-	ApplyRelativeBackOffsetValue(NewRelativeBackOffset);
+	// Pull the camera in front of any geometry between it and the pawn.
+	if ((bDoCollisionTest) && (CameraCollision != nullptr))
+	{
+		NewRelativeBackOffset *= UpdateCollisionFraction(ViewRotation, PivotLocation, NewRelativeBackOffset, DeltaTime);
+	}
+
+	return NewRelativeBackOffset;
+}
+
+float AThirdPersonFollowCamera::UpdateCollisionFraction(const FRotator& ViewRotation, const FVector& PivotLocation, const float BackOffset, const float DeltaTime)
+{
+	// The probe result is a frame old, but the back offset changes slowly enough that the fraction of it that is free is still accurate.
+	float FreeFraction = 1.0f;
+	if (CameraCollision->GetProbeResult(this, FreeFraction))
+	{
+		const float InterpSpeed = (FreeFraction < CollisionFraction) ? CollisionPullInSpeed : CollisionReturnSpeed;
+		CollisionFraction = (InterpSpeed > 0.0f) ? FMath::FInterpTo(CollisionFraction, FreeFraction, DeltaTime, InterpSpeed) : FreeFraction;
+	}
+
+	// Probe the full back offset this frame. The result is consumed next frame.
+	FVector DesiredRelativeCameraLocation = Camera->GetRelativeLocation();
+	DesiredRelativeCameraLocation.X = -static_cast<double>(BackOffset);
+	const FVector DesiredCameraLocation = PivotLocation + ViewRotation.RotateVector(DesiredRelativeCameraLocation);
+	CameraCollision->RequestProbe(this, PivotLocation, DesiredCameraLocation, ProbeSize, ProbeChannel, PlayerPawn);
+
+	return CollisionFraction;
+}
+
+void AThirdPersonFollowCamera::RecordLookInputLatency()
+{
+	// Measure each look input once. Rendering commands run in order, so the sample time reaches the rendering thread before the back buffer of this frame is
+	// presented.
+	if ((!BackBufferReadyToPresentHandle.IsValid()) || (CharacterPawnPlayerController == nullptr) ||
+		(CharacterPawnPlayerController->GetLastLookInputSampleTime() <= LastMeasuredLookInputSampleTime))
+	{
+		return;
+	}
+	LastMeasuredLookInputSampleTime = CharacterPawnPlayerController->GetLastLookInputSampleTime();
+
+	ENQUEUE_RENDER_COMMAND(KPCRecordLookInputSampleTime)([this, SampleTime = LastMeasuredLookInputSampleTime](FRHICommandListImmediate& RHICmdList)
+		{
+			PendingPresentLookInputSampleTime = SampleTime;
+		});
 }
@@ -7,6 +7,9 @@
 #include "ThirdPersonFollowCamera.generated.h"
 
 class UCameraComponent;
+class UCameraCollisionSubsystem;
+class ACharacterPawnPlayerController;
+class SWindow;
 
 /**
  * 
@@ -35,19 +38,65 @@ private:
 	UPROPERTY(EditDefaultsOnly, Category = "ThirdPersonFollowCamera")
 	float ScaledAdditiveRelativeBackOffsetLookDownValue = 100.f;
 
+	// Composes the view when the camera manager builds it instead of when the camera ticks, so the view uses the control rotation and pawn location after every
+	// actor has ticked and the camera does not tick at all.
+	UPROPERTY(EditDefaultsOnly, Category = "ThirdPersonFollowCamera")
+	bool bLateUpdateView = true;
+
+	// Whether the camera is pulled in toward the pawn when geometry blocks the line between them.
+	UPROPERTY(EditDefaultsOnly, Category = "ThirdPersonFollowCamera|Collision")
+	bool bDoCollisionTest = true;
+
+	// Radius of the sphere swept from the pawn to the camera.
+	UPROPERTY(EditDefaultsOnly, Category = "ThirdPersonFollowCamera|Collision", meta = (ClampMin = "0.0", EditCondition = "bDoCollisionTest"))
+	float ProbeSize = 12.0f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "ThirdPersonFollowCamera|Collision", meta = (EditCondition = "bDoCollisionTest"))
+	TEnumAsByte<ECollisionChannel> ProbeChannel = ECollisionChannel::ECC_Camera;
+
+	// How quickly the camera moves in when it becomes blocked. Zero moves it in immediately.
+	UPROPERTY(EditDefaultsOnly, Category = "ThirdPersonFollowCamera|Collision", meta = (ClampMin = "0.0", EditCondition = "bDoCollisionTest"))
+	float CollisionPullInSpeed = 0.0f;
+
+	// How quickly the camera moves back out when it becomes unblocked. Zero moves it out immediately.
+	UPROPERTY(EditDefaultsOnly, Category = "ThirdPersonFollowCamera|Collision", meta = (ClampMin = "0.0", EditCondition = "bDoCollisionTest"))
+	float CollisionReturnSpeed = 5.0f;
+
 	UWorld* World = nullptr;
 	APawn* PlayerPawn = nullptr;
 	APlayerController* PlayerController = nullptr;
+	ACharacterPawnPlayerController* CharacterPawnPlayerController = nullptr;
+	UCameraCollisionSubsystem* CameraCollision = nullptr;
+
+	// Smoothed fraction of the relative back offset that is free of blocking geometry.
+	float CollisionFraction = 1.0f;
+
+	// The controller's look input sample time that was last sent to the rendering thread to be measured by the look input latency stat.
+	double LastMeasuredLookInputSampleTime = 0.0;
+	// The sample time of look input composed into a view that has not been presented yet. Only accessed on the rendering thread.
+	double PendingPresentLookInputSampleTime = 0.0;
+	// The game viewport's window. Only compared against the window being presented, never dereferenced.
+	const SWindow* GameWindow = nullptr;
+	FDelegateHandle BackBufferReadyToPresentHandle = {};
 
 private:
 	AThirdPersonFollowCamera();
 
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Tick(float DeltaTime) override;
+	virtual void CalcCamera(float DeltaTime, FMinimalViewInfo& OutResult) override;
+
+	// Composes the camera transform from the control rotation and pawn location and writes it once.
+	void UpdateView(const float DeltaTime);
+
+	// Calculates the relative back offset value based on how much the camera is looking up or down and how much of it is free of blocking geometry.
+	float CalculateRelativeBackOffsetValue(const FRotator& ViewRotation, const FVector& PivotLocation, const float DeltaTime);
 
-	// Applies the relative back offset value based on how much the camera is looking up or down.
-	void ApplyRelativeBackOffsetValue(const float Value);
+	// Smooths the collision fraction toward the result of last frame's probe and requests a probe for the back offset this frame. Returns the smoothed fraction.
+	float UpdateCollisionFraction(const FRotator& ViewRotation, const FVector& PivotLocation, const float BackOffset, const float DeltaTime);
 
-	// Updates teh relative back offset value.
-	void UpdateRelativeBackOffsetValue();
+	// Sends the sample time of look input that has not been measured yet to the rendering thread when the view uses it. The look input latency stat is updated when
+	// the frame's back buffer is ready to present.
+	void RecordLookInputLatency();
 };
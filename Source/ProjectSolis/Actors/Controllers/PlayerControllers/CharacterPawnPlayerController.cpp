@@ -4,16 +4,16 @@
 #include "CharacterPawnPlayerController.h"
 #include "EnhancedInputComponent.h"
 #include "EnhancedInputSubsystems.h"
+#include "Misc/App.h"
 #include "../../../Actors/Cameras/ThirdPersonFollowCamera.h"
 #include "../../../Actors/Pawns/CharacterPawn.h"
 #include "../../../ActorComponents/MovementComponents/CharacterPawnMovementComponent.h"
+#include "SignificanceManager.h"
 
 void ACharacterPawnPlayerController::BeginPlay()
 {
 	Super::BeginPlay();
 
-	AddInputMappingContext(InputMappingContext, InputMappingContextPriority);
-
 	// Cache world pointer.
 	World = GetWorld();
 
@@ -30,19 +30,52 @@ void ACharacterPawnPlayerController::Tick(float DeltaSeconds)
 	Super::Tick(DeltaSeconds);
 
 	//UE_LOG(LogTemp, Warning, TEXT("Controller tick"));
+
+	// Update the significance of managed objects, such as movement LOD, from this player's view.
+	if (IsLocalController())
+	{
+		if (USignificanceManager* SignificanceManager = FSignificanceManagerModule::Get(World))
+		{
+			FVector ViewLocation = FVector::ZeroVector;
+			FRotator ViewRotation = FRotator::ZeroRotator;
+			GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+			const FTransform ViewTransform(ViewRotation, ViewLocation);
+			SignificanceManager->Update(TArrayView<const FTransform>(&ViewTransform, 1));
+		}
+	}
+}
+
+void ACharacterPawnPlayerController::GatherStartupAssets(TArray<FSoftObjectPath>& OutAssets) const
+{
+	Super::GatherStartupAssets(OutAssets);
+
+	OutAssets.Add(InputMappingContext.ToSoftObjectPath());
+	OutAssets.Add(LookAnalogInputAction.ToSoftObjectPath());
+	OutAssets.Add(LookAbsoluteInputAction.ToSoftObjectPath());
+	OutAssets.Add(MoveInputAction.ToSoftObjectPath());
+	OutAssets.Add(JumpInputAction.ToSoftObjectPath());
+}
+
+void ACharacterPawnPlayerController::OnStartupAssetsLoaded()
+{
+	Super::OnStartupAssetsLoaded();
+
+	AddInputMappingContext(InputMappingContext, InputMappingContextPriority);
 }
 
 void ACharacterPawnPlayerController::BindEnhancedInputActions(UEnhancedInputComponent* const EnhancedInputComponent)
 {
-	EnhancedInputComponent->BindAction(LookAnalogInputAction.LoadSynchronous(), ETriggerEvent::Triggered, this, &ACharacterPawnPlayerController::OnLookAnalogInputTriggered);
-	EnhancedInputComponent->BindAction(LookAbsoluteInputAction.LoadSynchronous(), ETriggerEvent::Triggered, this, &ACharacterPawnPlayerController::OnLookAbsoluteInputTriggered);
+	// Input actions are startup assets so they have already been loaded.
+	EnhancedInputComponent->BindAction(LookAnalogInputAction.Get(), ETriggerEvent::Triggered, this, &ACharacterPawnPlayerController::OnLookAnalogInputTriggered);
+	EnhancedInputComponent->BindAction(LookAbsoluteInputAction.Get(), ETriggerEvent::Triggered, this, &ACharacterPawnPlayerController::OnLookAbsoluteInputTriggered);
 
-	UInputAction* LoadedMoveInputAction = MoveInputAction.LoadSynchronous();
+	UInputAction* LoadedMoveInputAction = MoveInputAction.Get();
 	EnhancedInputComponent->BindAction(LoadedMoveInputAction, ETriggerEvent::Started, this, &ACharacterPawnPlayerController::OnMoveInputStarted);
 	EnhancedInputComponent->BindAction(LoadedMoveInputAction, ETriggerEvent::Triggered, this, &ACharacterPawnPlayerController::OnMoveInputTriggered);
 	EnhancedInputComponent->BindAction(LoadedMoveInputAction, ETriggerEvent::Completed, this, &ACharacterPawnPlayerController::OnMoveInputCompleted);
 
-	EnhancedInputComponent->BindAction(JumpInputAction.LoadSynchronous(), ETriggerEvent::Started, this, &ACharacterPawnPlayerController::OnJumpInputStarted);
+	EnhancedInputComponent->BindAction(JumpInputAction.Get(), ETriggerEvent::Started, this, &ACharacterPawnPlayerController::OnJumpInputStarted);
 }
 
 void ACharacterPawnPlayerController::OnLookAnalogInputTriggered(const FInputActionValue& Value)
@@ -51,12 +84,14 @@ void ACharacterPawnPlayerController::OnLookAnalogInputTriggered(const FInputActi
 	const float BaseRate = World->GetDeltaSeconds() * BaseAnalogRate;
 	AddYawInput(Value[0] * BaseRate * LookAnalogYawScale);
 	AddPitchInput(Value[1] * ((InvertLookPitch) ? -1.0f : 1.0f) * BaseRate * LookAnalogPitchScale);
+	LastLookInputSampleTime = FApp::GetCurrentTime();
 }
 
 void ACharacterPawnPlayerController::OnLookAbsoluteInputTriggered(const FInputActionValue& Value)
 {
 	AddYawInput(Value[0]);
 	AddPitchInput(Value[1] * ((InvertLookPitch) ? 1.0f : -1.0f));
+	LastLookInputSampleTime = FApp::GetCurrentTime();
 }
 
 void ACharacterPawnPlayerController::OnMoveInputStarted(const FInputActionValue& Value)
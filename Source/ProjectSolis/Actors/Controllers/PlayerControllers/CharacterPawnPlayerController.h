@@ -59,6 +59,18 @@ private:
 	// Controlled character pawn movement component.
 	UCharacterPawnMovementComponent* CharacterPawnMovement = nullptr;
 
+	// Start time (FApp::GetCurrentTime()) of the last frame that polled look input. Input is polled right after the frame's time is taken, so this is the closest
+	// engine timestamp to when the input was sampled.
+	double LastLookInputSampleTime = 0.0;
+
+public:
+	double GetLastLookInputSampleTime() const { return LastLookInputSampleTime; }
+
+	virtual void GatherStartupAssets(TArray<FSoftObjectPath>& OutAssets) const override;
+
+protected:
+	virtual void OnStartupAssetsLoaded() override;
+
 private:
 	virtual void BeginPlay() override;
 	virtual void Tick(float DeltaSeconds) override;
@@ -5,12 +5,45 @@
 #include "EnhancedInputSubsystems.h"
 #include "Framework/Commands/InputChord.h"
 #include "InputMappingContext.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "../../GameModes/ProjectSolisGameModeBase.h"
 
 void AProjectSolisPlayerController::SetupInputComponent()
 {
 	Super::SetupInputComponent();
 
 	BindAnyKeyInput();
+
+	// Input actions are bound once the assets they reference have loaded.
+	if (AProjectSolisGameModeBase* GameMode = GetWorld()->GetAuthGameMode<AProjectSolisGameModeBase>())
+	{
+		GameMode->CallWhenStartupAssetsLoaded(FSimpleDelegate::CreateUObject(this, &AProjectSolisPlayerController::OnStartupAssetsLoaded));
+		return;
+	}
+
+	TArray<FSoftObjectPath> StartupAssets = {};
+	GatherStartupAssets(StartupAssets);
+	StartupAssets.RemoveAllSwap([](const FSoftObjectPath& Path) { return Path.IsNull(); });
+	if (StartupAssets.Num() > 0)
+	{
+		StartupAssetsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(StartupAssets,
+			FStreamableDelegate::CreateUObject(this, &AProjectSolisPlayerController::OnStartupAssetsLoaded), FStreamableManager::AsyncLoadHighPriority);
+	}
+
+	if (!StartupAssetsHandle.IsValid())
+	{
+		OnStartupAssetsLoaded();
+	}
+}
+
+void AProjectSolisPlayerController::GatherStartupAssets(TArray<FSoftObjectPath>& OutAssets) const
+{
+	// Note: Optionally implemented by child classes.
+}
+
+void AProjectSolisPlayerController::OnStartupAssetsLoaded()
+{
 	BindInputActions();
 }
 
@@ -73,7 +106,7 @@ void AProjectSolisPlayerController::AddInputMappingContext(TSoftObjectPtr<UInput
 		if (UEnhancedInputLocalPlayerSubsystem* InputSystem = LocalPlayer->GetSubsystem<UEnhancedInputLocalPlayerSubsystem>())
 		{
 			check(!SoftInputMappingContext.IsNull());
-			UInputMappingContext* InputMappingContext = SoftInputMappingContext.LoadSynchronous();
+			UInputMappingContext* InputMappingContext = SoftInputMappingContext.Get();
 			if (IsValid(InputMappingContext))
 			{
 				InputSystem->AddMappingContext(InputMappingContext, Priority);
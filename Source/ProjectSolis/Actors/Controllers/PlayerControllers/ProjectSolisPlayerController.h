@@ -9,6 +9,7 @@
 struct FInputActionValue;
 class UInputMappingContext;
 class UInputAction;
+struct FStreamableHandle;
 
 /**
  *
@@ -18,10 +19,21 @@ class PROJECTSOLIS_API AProjectSolisPlayerController : public AProjectPlayerCont
 {
 	GENERATED_BODY()
 
+private:
+	// Keeps the startup assets loaded when there is no game mode to load them, such as on clients.
+	TSharedPtr<FStreamableHandle> StartupAssetsHandle = nullptr;
+
+public:
+	// Adds the soft references that must be loaded before input is bound. Loaded by the game mode while the map is loading.
+	virtual void GatherStartupAssets(TArray<FSoftObjectPath>& OutAssets) const;
+
 protected:
-	// Adds a mapping context to the local player enhanced input subsystem with the specified priority.
+	// Adds a mapping context to the local player enhanced input subsystem with the specified priority. The mapping context must be a startup asset.
 	void AddInputMappingContext(TSoftObjectPtr<UInputMappingContext> SoftInputMappingContext, int32 Priority);
 
+	// Binds input actions. Called once the startup assets have loaded.
+	virtual void OnStartupAssetsLoaded();
+
 private:
 	virtual void SetupInputComponent() override;
 	virtual void PlayerTick(float DeltaTime) override;
@@ -2,4 +2,73 @@
 
 
 #include "ProjectSolisGameModeBase.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "TimerManager.h"
+#include "../Controllers/PlayerControllers/ProjectSolisPlayerController.h"
+#include "../../ActorComponents/MovementComponents/KinematicPawnStats.h"
 
+void AProjectSolisGameModeBase::CallWhenStartupAssetsLoaded(FSimpleDelegate Delegate)
+{
+	if (bStartupAssetsLoaded)
+	{
+		Delegate.ExecuteIfBound();
+		return;
+	}
+
+	OnStartupAssetsLoadedDelegate.Add(MoveTemp(Delegate));
+}
+
+void AProjectSolisGameModeBase::GatherStartupAssets(TArray<FSoftObjectPath>& OutAssets) const
+{
+	if (const AProjectSolisPlayerController* PlayerControllerCDO = Cast<AProjectSolisPlayerController>(PlayerControllerClass.GetDefaultObject()))
+	{
+		PlayerControllerCDO->GatherStartupAssets(OutAssets);
+	}
+}
+
+void AProjectSolisGameModeBase::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	// The game is initialized while the map is loading, before any player has logged in.
+	StartupAssetsRequestTime = FPlatformTime::Seconds();
+
+	TArray<FSoftObjectPath> StartupAssets = {};
+	GatherStartupAssets(StartupAssets);
+	StartupAssets.RemoveAllSwap([](const FSoftObjectPath& Path) { return Path.IsNull(); });
+
+	if (StartupAssets.Num() > 0)
+	{
+		StartupAssetsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(StartupAssets,
+			FStreamableDelegate::CreateUObject(this, &AProjectSolisGameModeBase::OnStartupAssetsLoaded), FStreamableManager::AsyncLoadHighPriority);
+	}
+
+	if (!StartupAssetsHandle.IsValid())
+	{
+		OnStartupAssetsLoaded();
+	}
+}
+
+void AProjectSolisGameModeBase::OnStartupAssetsLoaded()
+{
+	if (bStartupAssetsLoaded)
+	{
+		return;
+	}
+	bStartupAssetsLoaded = true;
+
+	const double LoadedTime = FPlatformTime::Seconds();
+	UE_LOG(LogKinematicPawn, Log, TEXT("Startup assets loaded %.1f ms after the game was initialized."), (LoadedTime - StartupAssetsRequestTime) * 1000.0);
+
+	OnStartupAssetsLoadedDelegate.Broadcast();
+	OnStartupAssetsLoadedDelegate.Clear();
+
+	// Input is bound and the camera spawned by now, so input is processed from the next frame on.
+	const double RequestTime = StartupAssetsRequestTime;
+	GetWorldTimerManager().SetTimerForNextTick([RequestTime]()
+		{
+			const double Now = FPlatformTime::Seconds();
+			UE_LOG(LogKinematicPawn, Log, TEXT("First controllable frame %.1f ms after the game was initialized (%.1f ms after engine start)."), (Now - RequestTime) * 1000.0, (Now - GStartTime) * 1000.0);
+		});
+}
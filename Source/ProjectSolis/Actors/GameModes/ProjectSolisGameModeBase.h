@@ -6,12 +6,39 @@
 #include "../../ProjectBaseClasses/ProjectGameModeBase.h"
 #include "ProjectSolisGameModeBase.generated.h"
 
+struct FStreamableHandle;
+
 /**
- * 
+ * Requests every asset the game needs before the player can take control with the streamable manager while the map is loading, so nothing is loaded
+ * synchronously on the game thread at startup. Controllers and the game mode defer work that uses these assets until they have loaded.
  */
 UCLASS()
 class PROJECTSOLIS_API AProjectSolisGameModeBase : public AProjectGameModeBase
 {
 	GENERATED_BODY()
-	
+
+private:
+	// Keeps the startup assets loaded for the lifetime of the game mode.
+	TSharedPtr<FStreamableHandle> StartupAssetsHandle = nullptr;
+
+	bool bStartupAssetsLoaded = false;
+	FSimpleMulticastDelegate OnStartupAssetsLoadedDelegate = {};
+
+	// Platform time in seconds when the startup assets were requested.
+	double StartupAssetsRequestTime = 0.0;
+
+public:
+	// Executes the delegate once the startup assets have loaded. Executes it immediately if they already have.
+	void CallWhenStartupAssetsLoaded(FSimpleDelegate Delegate);
+
+	bool AreStartupAssetsLoaded() const { return bStartupAssetsLoaded; }
+
+protected:
+	// Adds the soft references to load before the player can take control. Includes the startup assets of the player controller class.
+	virtual void GatherStartupAssets(TArray<FSoftObjectPath>& OutAssets) const;
+
+private:
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+
+	void OnStartupAssetsLoaded();
 };
@@ -8,12 +8,19 @@ void ASolisGameMode::BeginPlay()
 {
 	Super::BeginPlay();
 
-	SpawnDefaultCameraActor();
+	CallWhenStartupAssetsLoaded(FSimpleDelegate::CreateUObject(this, &ASolisGameMode::SpawnDefaultCameraActor));
+}
+
+void ASolisGameMode::GatherStartupAssets(TArray<FSoftObjectPath>& OutAssets) const
+{
+	Super::GatherStartupAssets(OutAssets);
+
+	OutAssets.Add(DefaultCameraActorClass.ToSoftObjectPath());
 }
 
 void ASolisGameMode::SpawnDefaultCameraActor()
 {
-	UClass* CameraActorClass = DefaultCameraActorClass.LoadSynchronous();
+	UClass* CameraActorClass = DefaultCameraActorClass.Get();
 	if (!IsValid(CameraActorClass))
 	{
 		return;
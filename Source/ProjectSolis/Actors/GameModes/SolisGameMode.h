@@ -17,12 +17,15 @@ class PROJECTSOLIS_API ASolisGameMode : public AProjectSolisGameModeBase
 	GENERATED_BODY()
 	
 private:
-	// Default spawned camera actor class.
+	// Default spawned camera actor class. Loaded with the startup assets.
 	UPROPERTY(EditDefaultsOnly, Category = "Classes")
 	TSoftClassPtr<ACameraActorBase> DefaultCameraActorClass = nullptr;
 
 	ACameraActorBase* CameraActor = nullptr;
 
+protected:
+	virtual void GatherStartupAssets(TArray<FSoftObjectPath>& OutAssets) const override;
+
 private:
 	virtual void BeginPlay() override;
 
@@ -4,6 +4,7 @@
 #include "PlayerPawn.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/ArrowComponent.h"
+#include "Components/SkeletalMeshComponent.h"
 #include "../../Libraries/MathUtilityLibrary.h"
 #include "../../ActorComponents/MovementComponents/CharacterPawnMovementComponent.h"
 
@@ -25,8 +26,11 @@ APlayerPawn::APlayerPawn()
 	// Create and setup skeletal mesh component.
 	Mesh = CreateDefaultSubobject<USkeletalMeshComponent>(FName(TEXT("SkeletalMesh")));
 	Mesh->SetupAttachment(RootComponent);
+	// Movement samples montage root motion itself, so the mesh only needs to advance montages when it is not rendered.
+	Mesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered;
 
 	GetCharacterPawnMovementComponent()->SetRootMotionMesh(Mesh);
+	GetCharacterPawnMovementComponent()->SetInterpolatedComponent(Mesh);
 }
 
 void APlayerPawn::Tick(float DeltaTime)
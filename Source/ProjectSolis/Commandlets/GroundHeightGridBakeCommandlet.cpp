@@ -0,0 +1,284 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GroundHeightGridBakeCommandlet.h"
+#include "MovementTestWorld.h"
+#include "../ActorComponents/MovementComponents/GroundHeightGrid.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "Misc/FileHelper.h"
+#include "WorldPartition/WorldPartition.h"
+#include "WorldPartition/WorldPartitionSubsystem.h"
+#include "WorldPartition/WorldPartitionStreamingSource.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogGroundHeightGridBake, Log, All);
+
+namespace GroundHeightGridBake
+{
+	// Streams world partition cells in around the tile being baked.
+	class FTileStreamingSource : public IWorldPartitionStreamingSourceProvider
+	{
+	public:
+		UObject* Owner = nullptr;
+		FVector Location = FVector::ZeroVector;
+
+		virtual bool GetStreamingSources(TArray<FWorldPartitionStreamingSource>& OutStreamingSources) const override
+		{
+			FWorldPartitionStreamingSource& StreamingSource = OutStreamingSources.AddDefaulted_GetRef();
+			StreamingSource.Name = TEXT("GroundHeightGridBake");
+			StreamingSource.Location = Location;
+			StreamingSource.Rotation = FRotator::ZeroRotator;
+			StreamingSource.TargetState = EStreamingSourceTargetState::Activated;
+			StreamingSource.bBlockOnSlowLoading = true;
+			return true;
+		}
+
+		virtual UObject* GetStreamingSourceOwner() override
+		{
+			return Owner;
+		}
+	};
+
+	struct FSample
+	{
+		float Height = FKPCGroundHeightGrid::InvalidHeight;
+		FVector Normal = FVector::UpVector;
+	};
+}
+
+UGroundHeightGridBakeCommandlet::UGroundHeightGridBakeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UGroundHeightGridBakeCommandlet::Main(const FString& Params)
+{
+	using namespace GroundHeightGridBake;
+
+	FString MapPackageName = {};
+	float SampleSpacing = 100.0f;
+	int32 TileSamples = 128;
+	FString ChannelName = TEXT("ECC_Visibility");
+	float MaxHeightDelta = 50.0f;
+	FString OutputPath = {};
+
+	FParse::Value(*Params, TEXT("Map="), MapPackageName);
+	FParse::Value(*Params, TEXT("Spacing="), SampleSpacing);
+	FParse::Value(*Params, TEXT("TileSamples="), TileSamples);
+	FParse::Value(*Params, TEXT("Channel="), ChannelName);
+	FParse::Value(*Params, TEXT("MaxHeightDelta="), MaxHeightDelta);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	const bool bTraceComplex = FParse::Param(*Params, TEXT("Complex"));
+
+	if ((MapPackageName.IsEmpty()) || (SampleSpacing <= 0.0f) || (TileSamples <= 0))
+	{
+		UE_LOG(LogGroundHeightGridBake, Error, TEXT("A map and a positive spacing and tile sample count are required."));
+		return 2;
+	}
+
+	const int64 ChannelValue = StaticEnum<ECollisionChannel>()->GetValueByNameString(ChannelName);
+	if (ChannelValue == INDEX_NONE)
+	{
+		UE_LOG(LogGroundHeightGridBake, Error, TEXT("Unknown collision channel %s."), *ChannelName);
+		return 2;
+	}
+	const ECollisionChannel Channel = static_cast<ECollisionChannel>(ChannelValue);
+
+	if (OutputPath.IsEmpty())
+	{
+		OutputPath = FKPCGroundHeightGrid::GetGridPathForMap(MapPackageName);
+	}
+
+	FMovementTestWorld TestWorld = {};
+	if (!TestWorld.InitializeFromMap(MapPackageName))
+	{
+		UE_LOG(LogGroundHeightGridBake, Error, TEXT("Failed to load map %s."), *MapPackageName);
+		return 2;
+	}
+	UWorld* World = TestWorld.GetWorld();
+
+	// Flush the physics scene so traces see the map's geometry.
+	TestWorld.Tick(0.0f);
+
+	// Stream world partition cells in tile by tile with a streaming source that follows the tile being baked.
+	FTileStreamingSource TileStreamingSource = {};
+	TileStreamingSource.Owner = World;
+	UWorldPartitionSubsystem* WorldPartitionSubsystem = (World->IsPartitionedWorld()) ? World->GetSubsystem<UWorldPartitionSubsystem>() : nullptr;
+	if (IsValid(WorldPartitionSubsystem))
+	{
+		WorldPartitionSubsystem->RegisterStreamingSourceProvider(&TileStreamingSource);
+	}
+
+	const FBox Bounds = (World->IsPartitionedWorld()) ? World->GetWorldPartition()->GetRuntimeWorldBounds() : CalculateStaticGeometryBounds(World, Channel);
+	if (!Bounds.IsValid)
+	{
+		UE_LOG(LogGroundHeightGridBake, Error, TEXT("Map %s has no static geometry blocking %s."), *MapPackageName, *ChannelName);
+		return 2;
+	}
+
+	const double TileSize = static_cast<double>(SampleSpacing) * static_cast<double>(TileSamples);
+	FKPCGroundHeightGridHeader Header = {};
+	Header.Magic = FKPCGroundHeightGrid::Magic;
+	Header.Version = FKPCGroundHeightGrid::Version;
+	Header.SampleSpacing = SampleSpacing;
+	Header.TileSamples = TileSamples;
+	Header.OriginX = FMath::FloorToDouble(Bounds.Min.X / TileSize) * TileSize;
+	Header.OriginY = FMath::FloorToDouble(Bounds.Min.Y / TileSize) * TileSize;
+	Header.NumTilesX = FMath::Max(FMath::CeilToInt32((Bounds.Max.X - Header.OriginX) / TileSize), 1);
+	Header.NumTilesY = FMath::Max(FMath::CeilToInt32((Bounds.Max.Y - Header.OriginY) / TileSize), 1);
+	Header.CollisionChannel = static_cast<int32>(Channel);
+
+	UE_LOG(LogGroundHeightGridBake, Display, TEXT("Baking %dx%d tiles of %d samples at %.1fcm spacing for %s."), Header.NumTilesX, Header.NumTilesY,
+		FMath::Square(TileSamples + 1), SampleSpacing, *MapPackageName);
+
+	// Pawns are not part of the ground.
+	FCollisionQueryParams QueryParams(TEXT("GroundHeightGridBake"), bTraceComplex);
+
+	const double TraceStartZ = Bounds.Max.Z + 100.0;
+	const double TraceEndZ = Bounds.Min.Z - 100.0;
+	const int32 NumTiles = Header.NumTilesX * Header.NumTilesY;
+	const int32 Stride = TileSamples + 1;
+	// Samples one beyond the tile's edges so discontinuities can be found at the edges.
+	const int32 BakeStride = TileSamples + 3;
+
+	TArray<int64> TileOffsets = {};
+	TileOffsets.SetNumZeroed(NumTiles);
+	TArray<uint8> TileData = {};
+	const int64 DataStart = Align(static_cast<int64>(sizeof(FKPCGroundHeightGridHeader)) + (static_cast<int64>(NumTiles) * static_cast<int64>(sizeof(int64))), 16);
+	int32 NumValidSamples = 0;
+
+	TArray<FSample> BakeSamples = {};
+	TArray<float> Heights = {};
+	TArray<int8> Normals = {};
+
+	for (int32 TileY = 0; TileY < Header.NumTilesY; ++TileY)
+	{
+		for (int32 TileX = 0; TileX < Header.NumTilesX; ++TileX)
+		{
+			const FVector2D TileOrigin(Header.OriginX + (static_cast<double>(TileX) * TileSize), Header.OriginY + (static_cast<double>(TileY) * TileSize));
+
+			if (IsValid(WorldPartitionSubsystem))
+			{
+				TileStreamingSource.Location = FVector(TileOrigin + FVector2D(TileSize * 0.5), 0.0);
+				World->BlockTillLevelStreamingCompleted();
+				TestWorld.Tick(0.0f);
+			}
+
+			// Refresh ignored pawns as streaming may have added some.
+			QueryParams.ClearIgnoredActors();
+			for (TActorIterator<APawn> It(World); It; ++It)
+			{
+				QueryParams.AddIgnoredActor(*It);
+			}
+
+			BakeSamples.Reset();
+			BakeSamples.SetNum(BakeStride * BakeStride);
+			for (int32 SampleY = 0; SampleY < BakeStride; ++SampleY)
+			{
+				for (int32 SampleX = 0; SampleX < BakeStride; ++SampleX)
+				{
+					const double X = TileOrigin.X + (static_cast<double>(SampleX - 1) * static_cast<double>(SampleSpacing));
+					const double Y = TileOrigin.Y + (static_cast<double>(SampleY - 1) * static_cast<double>(SampleSpacing));
+
+					FHitResult Hit = {};
+					if ((World->LineTraceSingleByChannel(Hit, FVector(X, Y, TraceStartZ), FVector(X, Y, TraceEndZ), Channel, QueryParams)) &&
+						(Hit.Component.IsValid()) && (Hit.Component->Mobility == EComponentMobility::Static) && (Hit.ImpactNormal.Z > 0.0))
+					{
+						FSample& Sample = BakeSamples[(SampleY * BakeStride) + SampleX];
+						Sample.Height = static_cast<float>(Hit.ImpactPoint.Z);
+						Sample.Normal = Hit.ImpactNormal;
+					}
+				}
+			}
+
+			// Store the tile's samples, invalidating any next to a discontinuity.
+			Heights.Reset();
+			Normals.Reset();
+			bool bTileHasValidSamples = false;
+			for (int32 SampleY = 1; SampleY <= Stride; ++SampleY)
+			{
+				for (int32 SampleX = 1; SampleX <= Stride; ++SampleX)
+				{
+					const FSample& Sample = BakeSamples[(SampleY * BakeStride) + SampleX];
+					bool bValid = (Sample.Height != FKPCGroundHeightGrid::InvalidHeight);
+					const int32 Neighbours[4] =
+					{
+						(SampleY * BakeStride) + SampleX - 1,
+						(SampleY * BakeStride) + SampleX + 1,
+						((SampleY - 1) * BakeStride) + SampleX,
+						((SampleY + 1) * BakeStride) + SampleX
+					};
+					for (int32 Neighbour : Neighbours)
+					{
+						const float NeighbourHeight = BakeSamples[Neighbour].Height;
+						bValid &= ((NeighbourHeight != FKPCGroundHeightGrid::InvalidHeight) && (FMath::Abs(NeighbourHeight - Sample.Height) <= MaxHeightDelta));
+					}
+
+					int8 NormalX = 0;
+					int8 NormalY = 0;
+					FKPCGroundHeightGrid::CompressNormal(Sample.Normal, NormalX, NormalY);
+					Heights.Add((bValid) ? Sample.Height : FKPCGroundHeightGrid::InvalidHeight);
+					Normals.Add(NormalX);
+					Normals.Add(NormalY);
+
+					bTileHasValidSamples |= bValid;
+					NumValidSamples += (bValid) ? 1 : 0;
+				}
+			}
+
+			// Tiles without any valid samples are not stored.
+			if (!bTileHasValidSamples)
+			{
+				continue;
+			}
+
+			TileOffsets[(TileY * Header.NumTilesX) + TileX] = DataStart + TileData.Num();
+			TileData.Append(reinterpret_cast<const uint8*>(Heights.GetData()), Heights.Num() * sizeof(float));
+			TileData.Append(reinterpret_cast<const uint8*>(Normals.GetData()), Normals.Num() * sizeof(int8));
+			TileData.SetNumZeroed(Align(TileData.Num(), 16));
+		}
+	}
+
+	if (IsValid(WorldPartitionSubsystem))
+	{
+		WorldPartitionSubsystem->UnregisterStreamingSourceProvider(&TileStreamingSource);
+	}
+
+	// Write the header, tile table and tile data.
+	TArray<uint8> FileData = {};
+	FileData.Append(reinterpret_cast<const uint8*>(&Header), sizeof(FKPCGroundHeightGridHeader));
+	FileData.Append(reinterpret_cast<const uint8*>(TileOffsets.GetData()), TileOffsets.Num() * sizeof(int64));
+	FileData.SetNumZeroed(DataStart);
+	FileData.Append(TileData);
+
+	if (!FFileHelper::SaveArrayToFile(FileData, *OutputPath))
+	{
+		UE_LOG(LogGroundHeightGridBake, Error, TEXT("Failed to write %s."), *OutputPath);
+		return 1;
+	}
+
+	UE_LOG(LogGroundHeightGridBake, Display, TEXT("Wrote %s (%lld bytes, %d valid samples)."), *OutputPath, static_cast<int64>(FileData.Num()), NumValidSamples);
+	return 0;
+}
+
+FBox UGroundHeightGridBakeCommandlet::CalculateStaticGeometryBounds(UWorld* World, ECollisionChannel Channel) const
+{
+	FBox Bounds(ForceInit);
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		It->ForEachComponent<UPrimitiveComponent>(false, [&Bounds, Channel](const UPrimitiveComponent* Primitive)
+			{
+				if ((Primitive->Mobility == EComponentMobility::Static) && (Primitive->IsQueryCollisionEnabled()) &&
+					(Primitive->GetCollisionResponseToChannel(Channel) == ECollisionResponse::ECR_Block))
+				{
+					Bounds += Primitive->Bounds.GetBox();
+				}
+			});
+	}
+	return Bounds;
+}
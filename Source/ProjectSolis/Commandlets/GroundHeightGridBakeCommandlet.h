@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProjectSolisCommandlet.h"
+#include "GroundHeightGridBakeCommandlet.generated.h"
+
+class UWorld;
+
+/**
+ * Bakes the ground height grid for a map. Traces down from above the map on the movement trace channel at every grid sample and stores the height and normal of
+ * the highest surface when it belongs to a static primitive. Samples over movable primitives, holes and discontinuities steeper than MaxHeightDelta are stored as
+ * invalid so lookups there fall back to scene queries. World partition maps are streamed in one tile at a time, so use a tile size (Spacing * TileSamples) equal to
+ * the runtime grid cell size to bake one tile per cell. The channel is stored in the grid and pawns tracing movement on a different channel do not use it.
+ *
+ * Usage: UnrealEditor-Cmd ProjectSolis.uproject -run=GroundHeightGridBake -nullrhi -Map=PackageName [-Spacing=100] [-TileSamples=128]
+ *		[-Channel=ECC_Visibility] [-Complex] [-MaxHeightDelta=50] [-Output=Path]
+ */
+UCLASS()
+class PROJECTSOLIS_API UGroundHeightGridBakeCommandlet : public UProjectSolisCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UGroundHeightGridBakeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	// Returns the bounds of every static primitive that blocks the channel.
+	FBox CalculateStaticGeometryBounds(UWorld* World, ECollisionChannel Channel) const;
+};
@@ -0,0 +1,365 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MathKernelBenchmarkCommandlet.h"
+#include "MovementTestWorld.h"
+#include "Engine/World.h"
+#include "Engine/StaticMeshActor.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/BoxComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SphereComponent.h"
+#include "../Libraries/CollisionLibrary.h"
+#include "../Libraries/MathUtilityLibrary.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMathKernelBenchmark, Log, All);
+
+namespace MathKernelBenchmark
+{
+	// Runs the kernel the given number of times and returns the mean cost per element in nanoseconds.
+	template<typename KernelType>
+	double Measure(int32 Iterations, int32 Count, KernelType&& Kernel)
+	{
+		// Warm the caches with the inputs before measuring.
+		Kernel();
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			Kernel();
+		}
+		const uint64 EndCycles = FPlatformTime::Cycles64();
+
+		return (FPlatformTime::ToSeconds64(EndCycles - StartCycles) * 1000000000.0) / (static_cast<double>(Iterations) * static_cast<double>(Count));
+	}
+
+	void LogResult(const TCHAR* Kernel, const TCHAR* Path, double NanosecondsPerElement, double BaselineNanosecondsPerElement)
+	{
+		UE_LOG(LogMathKernelBenchmark, Display, TEXT("%-24s %-8s %8.3fns/element  %5.2fx"), Kernel, Path, NanosecondsPerElement,
+			BaselineNanosecondsPerElement / FMath::Max(NanosecondsPerElement, UE_SMALL_NUMBER));
+	}
+
+	// Compares with an absolute tolerance in cm. A tolerance relative to the result would hide a kernel losing precision far from the origin, where the world
+	// space results are largest. None of the compared kernels return normalised vectors, so the tolerance is not scaled by their input range.
+	int32 CountMismatches(TConstArrayView<FVector> Expected, TConstArrayView<FVector> Actual, double Tolerance = UE_KINDA_SMALL_NUMBER)
+	{
+		int32 NumMismatches = 0;
+		for (int32 i = 0; i < Expected.Num(); ++i)
+		{
+			if (!Expected[i].Equals(Actual[i], Tolerance))
+			{
+				++NumMismatches;
+			}
+		}
+		return NumMismatches;
+	}
+
+	// How far the time of impact of an analytic sweep may be from the physics sweep's, in cm along the sweep, before the two are reported as different.
+	static constexpr double SweepDistanceTolerance = 0.1;
+	static constexpr double SweepNormalTolerance = 0.999;
+
+	// Spawns an actor whose root is a new shape component of the given class at the transform.
+	template<typename ComponentType>
+	ComponentType* SpawnShape(UWorld* World, const FTransform& Transform)
+	{
+		AActor* Actor = World->SpawnActor<AActor>(AActor::StaticClass(), Transform);
+		ComponentType* Component = NewObject<ComponentType>(Actor);
+		Actor->SetRootComponent(Component);
+		Component->SetWorldTransform(Transform);
+		Component->RegisterComponent();
+		return Component;
+	}
+
+	bool DoSweepsMatch(const FHitResult& AnalyticHit, bool bAnalyticHit, const FHitResult& PhysicsHit, bool bPhysicsHit, double SweepLength)
+	{
+		if (bAnalyticHit != bPhysicsHit)
+		{
+			return false;
+		}
+
+		// Physics sweeps only report the penetration depth and direction of a sweep that starts overlapping when asked to, so only the overlap is compared.
+		if ((!bAnalyticHit) || (AnalyticHit.bStartPenetrating) || (PhysicsHit.bStartPenetrating))
+		{
+			return (AnalyticHit.bStartPenetrating == PhysicsHit.bStartPenetrating);
+		}
+
+		return ((FMath::Abs(AnalyticHit.Time - PhysicsHit.Time) * SweepLength) <= SweepDistanceTolerance) &&
+			(FVector::DotProduct(AnalyticHit.ImpactNormal, PhysicsHit.ImpactNormal) >= SweepNormalTolerance);
+	}
+
+	/**
+	 * Sweeps the capsule past the shapes the movement benchmark is built from and past a sphere and a capsule, with both the analytic kernels and
+	 * UPrimitiveComponent::SweepComponent. Reports the cost per sweep of each path and returns the number of shapes for which the analytic sweeps differ from
+	 * the physics sweeps. Sweeps the kernels can not resolve are repeated with a physics sweep, the same as during movement, and counted.
+	 */
+	int32 ValidateAnalyticSweeps(int32 Iterations, int32 Count, FRandomStream& Random, const FCollisionShape& Shape, const FQuat& ShapeRotation)
+	{
+		FMovementTestWorld TestWorld = {};
+		if (!TestWorld.Initialize(TEXT("MathKernelBenchmark")))
+		{
+			UE_LOG(LogMathKernelBenchmark, Error, TEXT("Failed to create a world for the analytic sweeps."));
+			return 1;
+		}
+
+		// The benchmark floor is the engine cube scaled, and walls and slopes are boxes scaled and rotated. Each primitive is swept on its own so they can overlap.
+		static const TCHAR* CubeMeshPath = TEXT("/Engine/BasicShapes/Cube.Cube");
+		const TPair<const TCHAR*, FTransform> Boxes[] = {
+			{ TEXT("Floor"), FTransform(FRotator::ZeroRotator, FVector::ZeroVector, FVector(40.0, 8.0, 1.0)) },
+			{ TEXT("Wall"), FTransform(FRotator(0.0, 30.0, 0.0), FVector::ZeroVector, FVector(0.2, 4.0, 3.0)) },
+			{ TEXT("Slope"), FTransform(FRotator(25.0, 10.0, 5.0), FVector::ZeroVector, FVector(4.0)) }
+		};
+
+		TArray<TPair<const TCHAR*, UPrimitiveComponent*>> Primitives = {};
+		for (const TPair<const TCHAR*, FTransform>& Box : Boxes)
+		{
+			AStaticMeshActor* Actor = TestWorld.SpawnStaticMesh(CubeMeshPath, Box.Value);
+			if (Actor == nullptr)
+			{
+				UE_LOG(LogMathKernelBenchmark, Error, TEXT("Failed to load mesh %s."), CubeMeshPath);
+				return 1;
+			}
+			Primitives.Emplace(Box.Key, Actor->GetStaticMeshComponent());
+		}
+		USphereComponent* Sphere = SpawnShape<USphereComponent>(TestWorld.GetWorld(), FTransform::Identity);
+		Sphere->SetSphereRadius(120.0f);
+		Primitives.Emplace(TEXT("Sphere"), Sphere);
+		UCapsuleComponent* Capsule = SpawnShape<UCapsuleComponent>(TestWorld.GetWorld(), FTransform(FRotator(0.0, 0.0, 70.0), FVector::ZeroVector));
+		Capsule->SetCapsuleSize(50.0f, 150.0f);
+		Primitives.Emplace(TEXT("Capsule"), Capsule);
+
+		TestWorld.Tick(1.0f / 60.0f);
+
+		const float CapsuleRadius = Shape.GetCapsuleRadius();
+		const float CapsuleHalfLength = Shape.GetCapsuleAxisHalfLength();
+
+		TArray<FVector> Starts = {};
+		TArray<FVector> Ends = {};
+		TArray<FHitResult> AnalyticHits = {};
+		TArray<EKPCAnalyticSweepResult> AnalyticResults = {};
+		TArray<FHitResult> PhysicsHits = {};
+		Starts.SetNumZeroed(Count);
+		Ends.SetNumZeroed(Count);
+		AnalyticHits.SetNum(Count);
+		AnalyticResults.SetNumZeroed(Count);
+		PhysicsHits.SetNum(Count);
+
+		int32 NumFailures = 0;
+		for (const TPair<const TCHAR*, UPrimitiveComponent*>& Entry : Primitives)
+		{
+			UPrimitiveComponent* Primitive = Entry.Value;
+			FKPCAnalyticShape AnalyticShape = {};
+			if (!UCollisionLibrary::MakeAnalyticShape(Primitive, AnalyticShape))
+			{
+				UE_LOG(LogMathKernelBenchmark, Error, TEXT("%s has no analytic shape."), Entry.Key);
+				++NumFailures;
+				continue;
+			}
+
+			// Start outside the bounds, aim at a point around the shape and stop short of it or go past it, so there are hits, misses and grazing sweeps.
+			const FBoxSphereBounds Bounds = Primitive->Bounds;
+			const double Reach = Bounds.SphereRadius + static_cast<double>(Shape.GetCapsuleHalfHeight());
+			for (int32 i = 0; i < Count; ++i)
+			{
+				Starts[i] = Bounds.Origin + (Random.GetUnitVector() * Random.FRandRange(Reach * 0.5, Reach + 200.0));
+				const FVector Target = Bounds.Origin + (Random.GetUnitVector() * Random.FRandRange(0.0, Bounds.SphereRadius * 1.2));
+				Ends[i] = Starts[i] + ((Target - Starts[i]) * Random.FRandRange(0.5, 1.5));
+			}
+
+			const double AnalyticTime = Measure(Iterations, Count, [&]()
+				{
+					for (int32 i = 0; i < Count; ++i)
+					{
+						AnalyticHits[i].Init(Starts[i], Ends[i]);
+						AnalyticResults[i] = UCollisionLibrary::SweepCapsuleAgainstShape(AnalyticHits[i], Starts[i], Ends[i], ShapeRotation, CapsuleRadius,
+							CapsuleHalfLength, AnalyticShape);
+					}
+				});
+			const double PhysicsTime = Measure(Iterations, Count, [&]()
+				{
+					for (int32 i = 0; i < Count; ++i)
+					{
+						PhysicsHits[i].Init(Starts[i], Ends[i]);
+						Primitive->SweepComponent(PhysicsHits[i], Starts[i], Ends[i], ShapeRotation, Shape, false);
+					}
+				});
+
+			const FString Kernel = FString::Printf(TEXT("Sweep %s"), Entry.Key);
+			LogResult(*Kernel, TEXT("physics"), PhysicsTime, PhysicsTime);
+			LogResult(*Kernel, TEXT("analytic"), AnalyticTime, PhysicsTime);
+
+			int32 NumUnresolved = 0;
+			int32 NumMismatches = 0;
+			for (int32 i = 0; i < Count; ++i)
+			{
+				if (AnalyticResults[i] == EKPCAnalyticSweepResult::Unresolved)
+				{
+					++NumUnresolved;
+				}
+				else if (!DoSweepsMatch(AnalyticHits[i], (AnalyticResults[i] == EKPCAnalyticSweepResult::Hit), PhysicsHits[i], PhysicsHits[i].bBlockingHit,
+					(Ends[i] - Starts[i]).Size()))
+				{
+					++NumMismatches;
+				}
+			}
+
+			if (NumUnresolved > 0)
+			{
+				UE_LOG(LogMathKernelBenchmark, Display, TEXT("%s: %d of %d analytic sweep(s) were unresolved and need a physics sweep."), *Kernel, NumUnresolved, Count);
+			}
+			if (NumMismatches > 0)
+			{
+				UE_LOG(LogMathKernelBenchmark, Error, TEXT("%s: analytic sweeps differ from physics sweeps for %d element(s)."), *Kernel, NumMismatches);
+				++NumFailures;
+			}
+		}
+
+		return NumFailures;
+	}
+}
+
+UMathKernelBenchmarkCommandlet::UMathKernelBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UMathKernelBenchmarkCommandlet::Main(const FString& Params)
+{
+	using namespace MathKernelBenchmark;
+
+	int32 Count = 4096;
+	int32 Iterations = 1000;
+	int32 Seed = 0;
+
+	FParse::Value(*Params, TEXT("Count="), Count);
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+
+	if ((Count <= 0) || (Iterations <= 0))
+	{
+		UE_LOG(LogMathKernelBenchmark, Error, TEXT("Count and Iterations must be greater than zero."));
+		return 2;
+	}
+
+	// Surface normals cover every upward facing direction, displacements are horizontal and locations are spread over a few kilometres.
+	FRandomStream Random(Seed);
+	TArray<FVector> Normals = {};
+	TArray<FVector> Displacements = {};
+	TArray<FVector> Locations = {};
+	Normals.Reserve(Count);
+	Displacements.Reserve(Count);
+	Locations.Reserve(Count);
+	for (int32 i = 0; i < Count; ++i)
+	{
+		FVector Normal = Random.GetUnitVector();
+		Normal.Z = FMath::Abs(Normal.Z);
+		Normals.Add(Normal);
+		Displacements.Add(FVector(Random.FRandRange(-10.0, 10.0), Random.FRandRange(-10.0, 10.0), 0.0));
+		Locations.Add(FVector(Random.FRandRange(-200000.0, 200000.0), Random.FRandRange(-200000.0, 200000.0), Random.FRandRange(-1000.0, 1000.0)));
+	}
+
+	static constexpr float MaxWalkableSlopeAngle = 40.01f;
+	const double WalkableFloorZ = UMathUtilityLibrary::WalkableFloorZFromAngle(MaxWalkableSlopeAngle);
+	const FCollisionShape Shape = FCollisionShape::MakeCapsule(34.0f, 88.0f);
+	const FQuat ShapeRotation = FQuat(FVector::ForwardVector, FMath::DegreesToRadians(15.0));
+
+	TArray<bool> ScalarWalkable = {};
+	TArray<bool> BatchWalkable = {};
+	TArray<FVector> ScalarVectors = {};
+	TArray<FVector> BatchVectors = {};
+	ScalarWalkable.SetNumZeroed(Count);
+	BatchWalkable.SetNumZeroed(Count);
+	ScalarVectors.SetNumZeroed(Count);
+	BatchVectors.SetNumZeroed(Count);
+
+	int32 NumFailures = 0;
+
+	// Walkability.
+	{
+		const double AngleTime = Measure(Iterations, Count, [&]()
+			{
+				for (int32 i = 0; i < Count; ++i)
+				{
+					ScalarWalkable[i] = (UMathUtilityLibrary::VectorAngleDegrees(Normals[i], FVector::UpVector) <= static_cast<double>(MaxWalkableSlopeAngle));
+				}
+			});
+		const double CosineTime = Measure(Iterations, Count, [&]()
+			{
+				for (int32 i = 0; i < Count; ++i)
+				{
+					ScalarWalkable[i] = UMathUtilityLibrary::IsWalkable(Normals[i], WalkableFloorZ);
+				}
+			});
+		const double BatchTime = Measure(Iterations, Count, [&]()
+			{
+				UMathUtilityLibrary::IsWalkableBatch(Normals, WalkableFloorZ, BatchWalkable);
+			});
+
+		LogResult(TEXT("IsWalkable"), TEXT("angle"), AngleTime, AngleTime);
+		LogResult(TEXT("IsWalkable"), TEXT("cosine"), CosineTime, AngleTime);
+		LogResult(TEXT("IsWalkable"), TEXT("batch"), BatchTime, AngleTime);
+
+		if (ScalarWalkable != BatchWalkable)
+		{
+			UE_LOG(LogMathKernelBenchmark, Error, TEXT("IsWalkableBatch results differ from IsWalkable."));
+			++NumFailures;
+		}
+	}
+
+	// Slope matching.
+	{
+		const double ScalarTime = Measure(Iterations, Count, [&]()
+			{
+				for (int32 i = 0; i < Count; ++i)
+				{
+					ScalarVectors[i] = UMathUtilityLibrary::MatchVectorToSlope(FVector::UpVector, Displacements[i], Normals[i]);
+				}
+			});
+		const double BatchTime = Measure(Iterations, Count, [&]()
+			{
+				UMathUtilityLibrary::MatchVectorToSlopeBatch(FVector::UpVector, Displacements, Normals, BatchVectors);
+			});
+
+		LogResult(TEXT("MatchVectorToSlope"), TEXT("scalar"), ScalarTime, ScalarTime);
+		LogResult(TEXT("MatchVectorToSlope"), TEXT("batch"), BatchTime, ScalarTime);
+
+		const int32 NumMismatches = CountMismatches(ScalarVectors, BatchVectors);
+		if (NumMismatches > 0)
+		{
+			UE_LOG(LogMathKernelBenchmark, Error, TEXT("MatchVectorToSlopeBatch results differ from MatchVectorToSlope for %d element(s)."), NumMismatches);
+			++NumFailures;
+		}
+	}
+
+	// Lowest points.
+	{
+		const double ScalarTime = Measure(Iterations, Count, [&]()
+			{
+				for (int32 i = 0; i < Count; ++i)
+				{
+					ScalarVectors[i] = UCollisionLibrary::GetLowestPointOnShape(Shape, Locations[i], ShapeRotation, ShapeRotation.GetUpVector());
+				}
+			});
+		const double BatchTime = Measure(Iterations, Count, [&]()
+			{
+				UCollisionLibrary::GetLowestPointOnShapeBatch(Shape, Locations, ShapeRotation, ShapeRotation.GetUpVector(), BatchVectors);
+			});
+
+		LogResult(TEXT("GetLowestPointOnShape"), TEXT("scalar"), ScalarTime, ScalarTime);
+		LogResult(TEXT("GetLowestPointOnShape"), TEXT("batch"), BatchTime, ScalarTime);
+
+		const int32 NumMismatches = CountMismatches(ScalarVectors, BatchVectors);
+		if (NumMismatches > 0)
+		{
+			UE_LOG(LogMathKernelBenchmark, Error, TEXT("GetLowestPointOnShapeBatch results differ from GetLowestPointOnShape for %d element(s)."), NumMismatches);
+			++NumFailures;
+		}
+	}
+
+	// Analytic sweeps. Physics sweeps are far slower than the other kernels, so they are measured over fewer iterations.
+	NumFailures += ValidateAnalyticSweeps(FMath::Max(Iterations / 100, 1), Count, Random, Shape, ShapeRotation);
+
+	return (NumFailures > 0) ? 1 : 0;
+}
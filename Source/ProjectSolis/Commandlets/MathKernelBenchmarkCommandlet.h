@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProjectSolisCommandlet.h"
+#include "MathKernelBenchmarkCommandlet.generated.h"
+
+/**
+ * Microbenchmark for the scalar and batched math kernels used by character pawn movement. Runs each kernel over the same randomly generated inputs, reports the
+ * cost per element of each path and fails if a batched kernel's results differ from its scalar version. The analytic capsule sweeps are run against the shapes
+ * the movement benchmark is built from and fail if they differ from physics sweeps of the same primitives.
+ *
+ * Usage: UnrealEditor-Cmd ProjectSolis.uproject -run=MathKernelBenchmark -nullrhi [-Count=4096] [-Iterations=1000] [-Seed=0]
+ */
+UCLASS()
+class PROJECTSOLIS_API UMathKernelBenchmarkCommandlet : public UProjectSolisCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMathKernelBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
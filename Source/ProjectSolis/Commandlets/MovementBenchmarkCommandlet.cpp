@@ -0,0 +1,671 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementBenchmarkCommandlet.h"
+#include "MovementTestWorld.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/MemoryBase.h"
+#include "HAL/PlatformStackWalk.h"
+#include "../Actors/Pawns/PlayerPawn.h"
+#include "../ActorComponents/MovementComponents/CharacterPawnMovementComponent.h"
+#include "../Subsystems/MovementSubsystems/CharacterPawnMovementSubsystem.h"
+#include <atomic>
+
+DEFINE_LOG_CATEGORY_STATIC(LogMovementBenchmark, Log, All);
+
+namespace MovementBenchmark
+{
+	enum class EInputPattern : uint8
+	{
+		// Walk forwards at full speed.
+		Straight,
+		// Walk forwards at full speed and jump periodically.
+		StraightWithJumps,
+		// Walk in a circle.
+		Circle
+	};
+
+	struct FScenario
+	{
+		const TCHAR* Name = nullptr;
+		// Each obstacle gets its own lane. Pawns are distributed evenly across lanes.
+		TArray<const TCHAR*> ObstacleMeshPaths = {};
+		FVector ObstacleOffset = FVector::ZeroVector;
+		FVector ObstacleScale = FVector::OneVector;
+		EInputPattern InputPattern = EInputPattern::Straight;
+		// Tick the pawns together through the character pawn movement subsystem's parallel batch tick instead of one at a time.
+		bool bParallelBatchTick = false;
+	};
+
+	struct FScenarioResult
+	{
+		FString Name = {};
+		double MeanMicroseconds = 0.0;
+		double P99Microseconds = 0.0;
+		double SceneQueriesPerTick = 0.0;
+		int32 NumPawnTicks = 0;
+		// Only gathered with -CheckAllocations.
+		int64 NumAllocations = 0;
+		int32 NumAllocatingTicks = 0;
+	};
+
+	/**
+	 * Counts heap allocations made by any thread while counting is enabled, so allocations made by worker threads running batched movement are seen. Installed in
+	 * place of GMalloc for the measured frames and forwards everything to the allocator it replaced, so only allocations that go through GMalloc are seen. The
+	 * call stack of the first allocation counted is captured without allocating so it can be reported once counting has stopped.
+	 */
+	class FAllocationCounter final : public FMalloc
+	{
+	private:
+		static constexpr int32 MaxStackDepth = 32;
+
+		FMalloc* InnerMalloc = nullptr;
+		std::atomic<bool> bCounting = false;
+		std::atomic<int64> NumAllocations = 0;
+		uint64 FirstAllocationStack[MaxStackDepth] = {};
+		int32 FirstAllocationStackDepth = 0;
+
+	public:
+		void Install()
+		{
+			check(InnerMalloc == nullptr);
+			InnerMalloc = GMalloc;
+			GMalloc = this;
+		}
+
+		void Uninstall()
+		{
+			check(GMalloc == this);
+			GMalloc = InnerMalloc;
+			InnerMalloc = nullptr;
+		}
+
+		// Counts allocations made on every thread until StopCounting is called. Threads unrelated to movement that allocate meanwhile are counted too.
+		void StartCounting() { bCounting = true; }
+
+		void StopCounting() { bCounting = false; }
+
+		int64 GetNumAllocations() const { return NumAllocations; }
+
+		// Logs the call stack of the first allocation counted, if any.
+		void LogFirstAllocationStack() const
+		{
+			for (int32 i = 0; i < FirstAllocationStackDepth; ++i)
+			{
+				ANSICHAR Line[1024] = {};
+				FPlatformStackWalk::ProgramCounterToHumanReadableString(i, FirstAllocationStack[i], Line, UE_ARRAY_COUNT(Line));
+				UE_LOG(LogMovementBenchmark, Display, TEXT("    %s"), ANSI_TO_TCHAR(Line));
+			}
+		}
+
+		// FMalloc interface.
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return InnerMalloc->Malloc(Count, Alignment);
+		}
+
+		virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return InnerMalloc->TryMalloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			// Shrinking to zero frees the block instead of allocating.
+			if (Count > 0)
+			{
+				CountAllocation();
+			}
+			return InnerMalloc->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			if (Count > 0)
+			{
+				CountAllocation();
+			}
+			return InnerMalloc->TryRealloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override { InnerMalloc->Free(Original); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return InnerMalloc->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return InnerMalloc->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { InnerMalloc->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { InnerMalloc->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { InnerMalloc->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual void UpdateStats() override { InnerMalloc->UpdateStats(); }
+		virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { InnerMalloc->GetAllocatorStats(OutStats); }
+		virtual void DumpAllocatorStats(FOutputDevice& Ar) override { InnerMalloc->DumpAllocatorStats(Ar); }
+		virtual bool IsInternallyThreadSafe() const override { return InnerMalloc->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return InnerMalloc->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return InnerMalloc->GetDescriptiveName(); }
+
+	private:
+		void CountAllocation()
+		{
+			if (!bCounting)
+			{
+				return;
+			}
+
+			// Only the thread that counted the first allocation writes the stack, and it is only read once counting has stopped.
+			if (NumAllocations.fetch_add(1) == 0)
+			{
+				FirstAllocationStackDepth = static_cast<int32>(FPlatformStackWalk::CaptureStackBackTrace(FirstAllocationStack, MaxStackDepth));
+			}
+		}
+	};
+
+	static const TCHAR* FloorMeshPath = TEXT("/Engine/BasicShapes/Cube.Cube");
+	static constexpr double LaneWidth = 800.0;
+	static constexpr double LaneLength = 4000.0;
+	static constexpr double PawnSpacing = 150.0;
+	static constexpr int32 PawnsPerRow = 4;
+	static constexpr int32 JumpIntervalFrames = 45;
+
+	static TArray<FScenario> MakeScenarios()
+	{
+		TArray<FScenario> Scenarios;
+
+		Scenarios.Add({ TEXT("Flat"), { nullptr }, FVector::ZeroVector, FVector::OneVector, EInputPattern::StraightWithJumps });
+
+		Scenarios.Add({ TEXT("Slopes"),
+			{
+				TEXT("/Game/StaticMeshes/TestGeometry/Slope10.Slope10"),
+				TEXT("/Game/StaticMeshes/TestGeometry/Slope20.Slope20"),
+				TEXT("/Game/StaticMeshes/TestGeometry/Slope30.Slope30"),
+				TEXT("/Game/StaticMeshes/TestGeometry/Slope40.Slope40"),
+				TEXT("/Game/StaticMeshes/TestGeometry/Slope50.Slope50"),
+				TEXT("/Game/StaticMeshes/TestGeometry/Slope60.Slope60"),
+				TEXT("/Game/StaticMeshes/TestGeometry/Slope70.Slope70"),
+				TEXT("/Game/StaticMeshes/TestGeometry/Slope80.Slope80")
+			},
+			FVector(600.0, 0.0, 0.0), FVector::OneVector, EInputPattern::Straight });
+
+		Scenarios.Add({ TEXT("Stairs"), { TEXT("/Game/Levels/_GENERATED/samba/Stairs_CCC3E157.Stairs_CCC3E157") },
+			FVector(600.0, 0.0, 0.0), FVector::OneVector, EInputPattern::Straight });
+
+		Scenarios.Add({ TEXT("Walls"),
+			{
+				TEXT("/Game/StaticMeshes/TestGeometry/Wall1m.Wall1m"),
+				TEXT("/Game/StaticMeshes/TestGeometry/Wall3m.Wall3m")
+			},
+			FVector(600.0, 0.0, 0.0), FVector::OneVector, EInputPattern::Straight });
+
+		Scenarios.Add({ TEXT("ConcaveCylinder"), { TEXT("/Game/StaticMeshes/TestGeometry/ConcaveCylinder1m.ConcaveCylinder1m") },
+			FVector::ZeroVector, FVector(3.0, 3.0, 1.0), EInputPattern::Circle });
+
+		Scenarios.Add({ TEXT("UnevenTerrain"), { TEXT("/Game/StaticMeshes/TestGeometry/UnevenTerrain.UnevenTerrain") },
+			FVector(600.0, 0.0, 0.0), FVector::OneVector, EInputPattern::StraightWithJumps });
+
+		Scenarios.Add({ TEXT("WallsBatched"),
+			{
+				TEXT("/Game/StaticMeshes/TestGeometry/Wall1m.Wall1m"),
+				TEXT("/Game/StaticMeshes/TestGeometry/Wall3m.Wall3m")
+			},
+			FVector(600.0, 0.0, 0.0), FVector::OneVector, EInputPattern::StraightWithJumps, true });
+
+		return Scenarios;
+	}
+
+	// Builds the test map for the scenario: a floor with one lane per obstacle.
+	static bool BuildScenarioMap(FMovementTestWorld& TestWorld, const FScenario& Scenario)
+	{
+		const int32 NumLanes = Scenario.ObstacleMeshPaths.Num();
+		const double FloorWidth = LaneWidth * static_cast<double>(NumLanes);
+
+		// The engine cube is 100cm wide. Place the top of the floor at zero.
+		const FTransform FloorTransform(FRotator::ZeroRotator, FVector((LaneLength * 0.5) - 1000.0, (FloorWidth * 0.5) - (LaneWidth * 0.5), -50.0),
+			FVector(LaneLength / 100.0, FloorWidth / 100.0, 1.0));
+		if (!TestWorld.SpawnStaticMesh(FloorMeshPath, FloorTransform))
+		{
+			UE_LOG(LogMovementBenchmark, Error, TEXT("Failed to load floor mesh %s."), FloorMeshPath);
+			return false;
+		}
+
+		for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+		{
+			const TCHAR* MeshPath = Scenario.ObstacleMeshPaths[Lane];
+			if (MeshPath == nullptr)
+			{
+				continue;
+			}
+
+			const FVector LaneOrigin(0.0, LaneWidth * static_cast<double>(Lane), 0.0);
+			if (!TestWorld.SpawnStaticMesh(MeshPath, FTransform(FRotator::ZeroRotator, LaneOrigin + Scenario.ObstacleOffset, Scenario.ObstacleScale)))
+			{
+				UE_LOG(LogMovementBenchmark, Error, TEXT("Failed to load obstacle mesh %s."), MeshPath);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	static FVector GetPawnSpawnLocation(int32 PawnIndex, int32 NumLanes, double PawnHalfHeight)
+	{
+		const int32 Lane = PawnIndex % NumLanes;
+		const int32 IndexInLane = PawnIndex / NumLanes;
+		const int32 Column = IndexInLane % PawnsPerRow;
+		const int32 Row = IndexInLane / PawnsPerRow;
+
+		return FVector(-PawnSpacing * static_cast<double>(Row),
+			(LaneWidth * static_cast<double>(Lane)) + (PawnSpacing * (static_cast<double>(Column) - (static_cast<double>(PawnsPerRow - 1) * 0.5))),
+			PawnHalfHeight + 2.0);
+	}
+
+	static void ApplyScriptedInput(UCharacterPawnMovementComponent* Movement, EInputPattern InputPattern, int32 PawnIndex, int32 Frame, float DeltaTime)
+	{
+		switch (InputPattern)
+		{
+		case EInputPattern::Straight:
+			Movement->AddMovementInput(FVector::ForwardVector, 1.0f);
+			break;
+
+		case EInputPattern::StraightWithJumps:
+			Movement->AddMovementInput(FVector::ForwardVector, 1.0f);
+			if (((Frame + PawnIndex) % JumpIntervalFrames) == 0)
+			{
+				Movement->Jump();
+			}
+			break;
+
+		case EInputPattern::Circle:
+		{
+			const double Angle = FMath::DegreesToRadians((static_cast<double>(Frame) * static_cast<double>(DeltaTime) * 90.0) + (static_cast<double>(PawnIndex) * 37.0));
+			Movement->AddMovementInput(FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.0), 1.0f);
+			break;
+		}
+		}
+	}
+
+	static TSharedRef<FJsonObject> ResultToJson(const FScenarioResult& Result)
+	{
+		TSharedRef<FJsonObject> Object = MakeShared<FJsonObject>();
+		Object->SetStringField(TEXT("Name"), Result.Name);
+		Object->SetNumberField(TEXT("MeanMicroseconds"), Result.MeanMicroseconds);
+		Object->SetNumberField(TEXT("P99Microseconds"), Result.P99Microseconds);
+		Object->SetNumberField(TEXT("SceneQueriesPerTick"), Result.SceneQueriesPerTick);
+		Object->SetNumberField(TEXT("PawnTicks"), Result.NumPawnTicks);
+		Object->SetNumberField(TEXT("Allocations"), static_cast<double>(Result.NumAllocations));
+		Object->SetNumberField(TEXT("AllocatingTicks"), Result.NumAllocatingTicks);
+		return Object;
+	}
+
+	static bool SaveJson(const TSharedRef<FJsonObject>& Object, const FString& Path)
+	{
+		FString Output = {};
+		TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+		if (!FJsonSerializer::Serialize(Object, Writer))
+		{
+			return false;
+		}
+		return FFileHelper::SaveStringToFile(Output, *Path);
+	}
+
+	static TSharedPtr<FJsonObject> LoadJson(const FString& Path)
+	{
+		FString Input = {};
+		if (!FFileHelper::LoadFileToString(Input, *Path))
+		{
+			return nullptr;
+		}
+
+		TSharedPtr<FJsonObject> Object = nullptr;
+		if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Input), Object))
+		{
+			return nullptr;
+		}
+		return Object;
+	}
+}
+
+UMovementBenchmarkCommandlet::UMovementBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UMovementBenchmarkCommandlet::Main(const FString& Params)
+{
+	using namespace MovementBenchmark;
+
+	int32 NumPawns = 100;
+	int32 NumFrames = 600;
+	int32 NumWarmupFrames = 60;
+	float DeltaTime = 1.0f / 60.0f;
+	double Tolerance = 0.15;
+	FString ScenarioFilter = {};
+	FString PawnClassPath = {};
+	FString OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmarks/MovementBenchmark.json");
+	FString BaselinePath = FPaths::ProjectDir() / TEXT("Benchmarks/MovementBenchmarkBaseline.json");
+
+	FParse::Value(*Params, TEXT("Pawns="), NumPawns);
+	FParse::Value(*Params, TEXT("Frames="), NumFrames);
+	FParse::Value(*Params, TEXT("WarmupFrames="), NumWarmupFrames);
+	FParse::Value(*Params, TEXT("DeltaTime="), DeltaTime);
+	FParse::Value(*Params, TEXT("Tolerance="), Tolerance);
+	FParse::Value(*Params, TEXT("Scenario="), ScenarioFilter);
+	FParse::Value(*Params, TEXT("PawnClass="), PawnClassPath);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	FParse::Value(*Params, TEXT("Baseline="), BaselinePath);
+	const bool bUpdateBaseline = FParse::Param(*Params, TEXT("UpdateBaseline"));
+	const bool bNeighbourhoodCache = FParse::Param(*Params, TEXT("NeighbourhoodCache"));
+	const bool bCheckAllocations = FParse::Param(*Params, TEXT("CheckAllocations"));
+
+	if ((NumPawns <= 0) || (NumFrames <= 0) || (DeltaTime <= 0.0f))
+	{
+		UE_LOG(LogMovementBenchmark, Error, TEXT("Pawns, Frames and DeltaTime must be greater than zero."));
+		return 2;
+	}
+
+	UClass* PawnClass = APlayerPawn::StaticClass();
+	if (!PawnClassPath.IsEmpty())
+	{
+		PawnClass = LoadClass<APlayerPawn>(nullptr, *PawnClassPath);
+		if (!IsValid(PawnClass))
+		{
+			UE_LOG(LogMovementBenchmark, Error, TEXT("Failed to load pawn class %s."), *PawnClassPath);
+			return 2;
+		}
+	}
+
+	TArray<TSharedPtr<FJsonValue>> ScenarioResults = {};
+	int32 NumAllocatingScenarios = 0;
+	for (const FScenario& Scenario : MakeScenarios())
+	{
+		if ((!ScenarioFilter.IsEmpty()) && (ScenarioFilter != Scenario.Name))
+		{
+			continue;
+		}
+
+		FMovementTestWorld TestWorld = {};
+		if ((!TestWorld.Initialize(FName(FString::Printf(TEXT("MovementBenchmark_%s"), Scenario.Name)))) || (!BuildScenarioMap(TestWorld, Scenario)))
+		{
+			UE_LOG(LogMovementBenchmark, Error, TEXT("Failed to build the map for scenario %s."), Scenario.Name);
+			return 2;
+		}
+
+		TArray<UCharacterPawnMovementComponent*> Movements = {};
+		Movements.Reserve(NumPawns);
+		const double PawnHalfHeight = PawnClass->GetDefaultObject<APlayerPawn>()->GetMovementCollisionShape().GetCapsuleHalfHeight();
+		for (int32 PawnIndex = 0; PawnIndex < NumPawns; ++PawnIndex)
+		{
+			APlayerPawn* Pawn = TestWorld.SpawnPawn(PawnClass, GetPawnSpawnLocation(PawnIndex, Scenario.ObstacleMeshPaths.Num(), PawnHalfHeight), FRotator::ZeroRotator);
+			if (!IsValid(Pawn))
+			{
+				UE_LOG(LogMovementBenchmark, Error, TEXT("Failed to spawn pawn %d for scenario %s."), PawnIndex, Scenario.Name);
+				return 2;
+			}
+			Movements.Add(Pawn->GetCharacterPawnMovementComponent());
+			Movements.Last()->SetUseCollisionNeighbourhoodCache(bNeighbourhoodCache);
+		}
+
+		// Batched pawns are ticked here rather than by the world tick so the batch can be timed on its own.
+		UCharacterPawnMovementSubsystem* MovementSubsystem = nullptr;
+		if (Scenario.bParallelBatchTick)
+		{
+			MovementSubsystem = TestWorld.GetWorld()->GetSubsystem<UCharacterPawnMovementSubsystem>();
+			MovementSubsystem->SetParallelMovementTick(true);
+			for (UCharacterPawnMovementComponent* Movement : Movements)
+			{
+				MovementSubsystem->RegisterComponent(Movement);
+			}
+			MovementSubsystem->GetBatchTickFunction().SetTickFunctionEnable(false);
+		}
+
+		// Let the physics scene pick up the spawned geometry and pawns before stepping movement.
+		TestWorld.Tick(DeltaTime);
+
+		TArray<double> Samples = {};
+		Samples.Reserve(NumPawns * NumFrames);
+		int64 TotalSceneQueries = 0;
+		int64 TotalAllocations = 0;
+		int32 NumTicks = 0;
+		int32 NumAllocatingTicks = 0;
+
+		// Only movement ticks after the warmup are counted so scratch storage has grown to its steady state size. Timings taken with the counter installed include
+		// its overhead, so they are not comparable with a run without it.
+		FAllocationCounter AllocationCounter = {};
+		if (bCheckAllocations)
+		{
+			AllocationCounter.Install();
+		}
+
+		for (int32 Frame = 0; Frame < (NumWarmupFrames + NumFrames); ++Frame)
+		{
+			const bool bMeasure = (Frame >= NumWarmupFrames);
+
+			if (MovementSubsystem != nullptr)
+			{
+				for (int32 PawnIndex = 0; PawnIndex < Movements.Num(); ++PawnIndex)
+				{
+					ApplyScriptedInput(Movements[PawnIndex], Scenario.InputPattern, PawnIndex, Frame, DeltaTime);
+				}
+
+				const int64 AllocationsBeforeTick = AllocationCounter.GetNumAllocations();
+				if ((bCheckAllocations) && (bMeasure))
+				{
+					AllocationCounter.StartCounting();
+				}
+
+				const uint64 StartCycles = FPlatformTime::Cycles64();
+				MovementSubsystem->TickBatch(DeltaTime);
+				const uint64 EndCycles = FPlatformTime::Cycles64();
+
+				AllocationCounter.StopCounting();
+
+				// Pawns in a batch are not timed individually, so every pawn ticked by the batch is given the batch's mean cost per pawn.
+				if (bMeasure)
+				{
+					const double MicrosecondsPerPawn = (FPlatformTime::ToSeconds64(EndCycles - StartCycles) * 1000000.0) / static_cast<double>(Movements.Num());
+					for (UCharacterPawnMovementComponent* Movement : Movements)
+					{
+						Samples.Add(MicrosecondsPerPawn);
+						TotalSceneQueries += Movement->GetNumSceneQueries();
+					}
+					++NumTicks;
+					if (AllocationCounter.GetNumAllocations() > AllocationsBeforeTick)
+					{
+						++NumAllocatingTicks;
+					}
+				}
+
+				TestWorld.Tick(DeltaTime);
+				continue;
+			}
+
+			for (int32 PawnIndex = 0; PawnIndex < Movements.Num(); ++PawnIndex)
+			{
+				UCharacterPawnMovementComponent* Movement = Movements[PawnIndex];
+				ApplyScriptedInput(Movement, Scenario.InputPattern, PawnIndex, Frame, DeltaTime);
+
+				const int64 AllocationsBeforeTick = AllocationCounter.GetNumAllocations();
+				if ((bCheckAllocations) && (bMeasure))
+				{
+					AllocationCounter.StartCounting();
+				}
+
+				const uint64 StartCycles = FPlatformTime::Cycles64();
+				Movement->TickMovement(DeltaTime);
+				const uint64 EndCycles = FPlatformTime::Cycles64();
+
+				AllocationCounter.StopCounting();
+
+				if (bMeasure)
+				{
+					Samples.Add(FPlatformTime::ToSeconds64(EndCycles - StartCycles) * 1000000.0);
+					TotalSceneQueries += Movement->GetNumSceneQueries();
+					++NumTicks;
+					if (AllocationCounter.GetNumAllocations() > AllocationsBeforeTick)
+					{
+						++NumAllocatingTicks;
+					}
+				}
+			}
+
+			TestWorld.Tick(DeltaTime);
+		}
+
+		if (bCheckAllocations)
+		{
+			AllocationCounter.Uninstall();
+			TotalAllocations = AllocationCounter.GetNumAllocations();
+		}
+
+		Samples.Sort();
+
+		FScenarioResult Result = {};
+		Result.Name = Scenario.Name;
+		Result.NumPawnTicks = Samples.Num();
+		for (double Sample : Samples)
+		{
+			Result.MeanMicroseconds += Sample;
+		}
+		Result.MeanMicroseconds /= static_cast<double>(Samples.Num());
+		Result.P99Microseconds = Samples[FMath::Clamp(FMath::CeilToInt(static_cast<double>(Samples.Num()) * 0.99) - 1, 0, Samples.Num() - 1)];
+		Result.SceneQueriesPerTick = static_cast<double>(TotalSceneQueries) / static_cast<double>(Samples.Num());
+		Result.NumAllocations = TotalAllocations;
+		Result.NumAllocatingTicks = NumAllocatingTicks;
+
+		UE_LOG(LogMovementBenchmark, Display, TEXT("%-16s mean %8.2fus  p99 %8.2fus  queries/tick %6.2f  (%d pawn ticks)"),
+			*Result.Name, Result.MeanMicroseconds, Result.P99Microseconds, Result.SceneQueriesPerTick, Result.NumPawnTicks);
+
+		if (bCheckAllocations)
+		{
+			if (Result.NumAllocations > 0)
+			{
+				++NumAllocatingScenarios;
+				UE_LOG(LogMovementBenchmark, Error, TEXT("%s made %lld heap allocation(s) in %d of %d %s. First allocation:"),
+					*Result.Name, Result.NumAllocations, Result.NumAllocatingTicks, NumTicks, (MovementSubsystem != nullptr) ? TEXT("batch ticks") : TEXT("pawn ticks"));
+				AllocationCounter.LogFirstAllocationStack();
+			}
+			else
+			{
+				UE_LOG(LogMovementBenchmark, Display, TEXT("%s made no heap allocations."), *Result.Name);
+			}
+		}
+
+		ScenarioResults.Add(MakeShared<FJsonValueObject>(ResultToJson(Result)));
+	}
+
+	TSharedRef<FJsonObject> Results = MakeShared<FJsonObject>();
+	Results->SetNumberField(TEXT("Pawns"), NumPawns);
+	Results->SetNumberField(TEXT("Frames"), NumFrames);
+	Results->SetNumberField(TEXT("DeltaTime"), DeltaTime);
+	Results->SetBoolField(TEXT("NeighbourhoodCache"), bNeighbourhoodCache);
+	Results->SetBoolField(TEXT("CheckAllocations"), bCheckAllocations);
+	Results->SetArrayField(TEXT("Scenarios"), ScenarioResults);
+
+	if (!SaveJson(Results, OutputPath))
+	{
+		UE_LOG(LogMovementBenchmark, Error, TEXT("Failed to write results to %s."), *OutputPath);
+		return 2;
+	}
+	UE_LOG(LogMovementBenchmark, Display, TEXT("Results written to %s."), *OutputPath);
+
+	if (NumAllocatingScenarios > 0)
+	{
+		UE_LOG(LogMovementBenchmark, Error, TEXT("%d scenario(s) allocated during a steady state movement tick."), NumAllocatingScenarios);
+		return 1;
+	}
+
+	if (bUpdateBaseline)
+	{
+		if (!SaveJson(Results, BaselinePath))
+		{
+			UE_LOG(LogMovementBenchmark, Error, TEXT("Failed to write baseline to %s."), *BaselinePath);
+			return 2;
+		}
+		UE_LOG(LogMovementBenchmark, Display, TEXT("Baseline updated at %s."), *BaselinePath);
+		return 0;
+	}
+
+	// A run that can not be compared must not pass as one that was.
+	TSharedPtr<FJsonObject> Baseline = LoadJson(BaselinePath);
+	if (!Baseline.IsValid())
+	{
+		UE_LOG(LogMovementBenchmark, Error, TEXT("No baseline found at %s. Run with -UpdateBaseline to create one."), *BaselinePath);
+		return 2;
+	}
+
+	const int32 NumRegressions = CompareAgainstBaseline(Results, Baseline.ToSharedRef(), Tolerance);
+	if (NumRegressions > 0)
+	{
+		UE_LOG(LogMovementBenchmark, Error, TEXT("%d metric(s) regressed by more than %.0f%% against the baseline."), NumRegressions, Tolerance * 100.0);
+		return 1;
+	}
+
+	UE_LOG(LogMovementBenchmark, Display, TEXT("All scenarios are within %.0f%% of the baseline."), Tolerance * 100.0);
+	return 0;
+}
+
+int32 UMovementBenchmarkCommandlet::CompareAgainstBaseline(const TSharedRef<FJsonObject>& Results, const TSharedRef<FJsonObject>& Baseline, double Tolerance) const
+{
+	static const TCHAR* ComparedFields[] = { TEXT("MeanMicroseconds"), TEXT("P99Microseconds"), TEXT("SceneQueriesPerTick") };
+
+	const TArray<TSharedPtr<FJsonValue>>* ResultScenarios = nullptr;
+	const TArray<TSharedPtr<FJsonValue>>* BaselineScenarios = nullptr;
+	if ((!Results->TryGetArrayField(TEXT("Scenarios"), ResultScenarios)) || (!Baseline->TryGetArrayField(TEXT("Scenarios"), BaselineScenarios)))
+	{
+		UE_LOG(LogMovementBenchmark, Error, TEXT("The baseline has no scenarios."));
+		return 1;
+	}
+
+	// Costs scale with the pawn count and frame time, so results are only comparable with a baseline recorded with the same settings.
+	int32 NumRegressions = 0;
+	static const TCHAR* SettingsFields[] = { TEXT("Pawns"), TEXT("Frames"), TEXT("DeltaTime") };
+	for (const TCHAR* Field : SettingsFields)
+	{
+		if (!FMath::IsNearlyEqual(Results->GetNumberField(Field), Baseline->GetNumberField(Field)))
+		{
+			++NumRegressions;
+			UE_LOG(LogMovementBenchmark, Error, TEXT("%s is %g but the baseline was recorded with %g."), Field, Results->GetNumberField(Field), Baseline->GetNumberField(Field));
+		}
+	}
+
+	for (const TSharedPtr<FJsonValue>& ResultValue : *ResultScenarios)
+	{
+		const TSharedPtr<FJsonObject> Result = ResultValue->AsObject();
+		const FString Name = Result->GetStringField(TEXT("Name"));
+
+		const TSharedPtr<FJsonValue>* BaselineValue = BaselineScenarios->FindByPredicate([&Name](const TSharedPtr<FJsonValue>& Value)
+			{
+				return (Value->AsObject()->GetStringField(TEXT("Name")) == Name);
+			});
+
+		if (BaselineValue == nullptr)
+		{
+			++NumRegressions;
+			UE_LOG(LogMovementBenchmark, Error, TEXT("%s has no baseline. Run with -UpdateBaseline to record it."), *Name);
+			continue;
+		}
+
+		for (const TCHAR* Field : ComparedFields)
+		{
+			const double Current = Result->GetNumberField(Field);
+			const double Reference = (*BaselineValue)->AsObject()->GetNumberField(Field);
+			const double Change = (Reference > 0.0) ? ((Current - Reference) / Reference) : 0.0;
+
+			if (Change > Tolerance)
+			{
+				++NumRegressions;
+				UE_LOG(LogMovementBenchmark, Error, TEXT("%s %s regressed: %.2f -> %.2f (%+.1f%%)."), *Name, Field, Reference, Current, Change * 100.0);
+			}
+			else
+			{
+				UE_LOG(LogMovementBenchmark, Display, TEXT("%s %s: %.2f -> %.2f (%+.1f%%)."), *Name, Field, Reference, Current, Change * 100.0);
+			}
+		}
+	}
+	return NumRegressions;
+}
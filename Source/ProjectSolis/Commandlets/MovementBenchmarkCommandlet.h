@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProjectSolisCommandlet.h"
+#include "MovementBenchmarkCommandlet.generated.h"
+
+class FJsonObject;
+class FMovementTestWorld;
+
+/**
+ * Headless character pawn movement benchmark. Builds a test map for each scenario, spawns pawns driven by scripted input and steps their movement for a fixed
+ * number of frames at a fixed delta time. Reports mean and 99th percentile cost per pawn tick and scene queries per pawn tick, writes the results as JSON and
+ * compares them against the baseline at Benchmarks/MovementBenchmarkBaseline.json. The baseline is not checked in until it has been recorded on the reference
+ * machine with -UpdateBaseline, and must be recorded again whenever the scenarios change. The run fails if the baseline is missing, was recorded with a
+ * different pawn count, frame count or delta time, or has no entry for a scenario that was run. Pass -NeighbourhoodCache to run the pawns with the collision
+ * neighbourhood cache enabled and compare the results against a run without it. Pass -CheckAllocations to count heap allocations made on any thread during the
+ * measured movement ticks and fail if any were made. Batched scenarios tick their pawns through the character pawn movement subsystem's parallel batch tick, so
+ * allocations made by its worker threads are counted.
+ *
+ * Usage: UnrealEditor-Cmd ProjectSolis.uproject -run=MovementBenchmark -nullrhi [-Pawns=100] [-Frames=600] [-WarmupFrames=60] [-DeltaTime=0.016667]
+ *		[-Scenario=Name] [-PawnClass=Path] [-Output=Path] [-Baseline=Path] [-Tolerance=0.15] [-UpdateBaseline]
+ *		[-NeighbourhoodCache] [-CheckAllocations]
+ */
+UCLASS()
+class PROJECTSOLIS_API UMovementBenchmarkCommandlet : public UProjectSolisCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMovementBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	// Compares results against the baseline. Returns the number of metrics that regressed by more than the tolerance or could not be compared.
+	int32 CompareAgainstBaseline(const TSharedRef<FJsonObject>& Results, const TSharedRef<FJsonObject>& Baseline, double Tolerance) const;
+};
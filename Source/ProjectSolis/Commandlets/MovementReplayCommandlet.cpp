@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementReplayCommandlet.h"
+#include "MovementTestWorld.h"
+#include "../Actors/Pawns/PlayerPawn.h"
+#include "../ActorComponents/MovementComponents/CharacterPawnMovementComponent.h"
+#include "../ActorComponents/MovementComponents/CharacterPawnMovementRecording.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMovementReplay, Log, All);
+
+UMovementReplayCommandlet::UMovementReplayCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UMovementReplayCommandlet::Main(const FString& Params)
+{
+	FString RecordingPath = {};
+	FString MapPackageName = {};
+	double Tolerance = 0.1;
+
+	FParse::Value(*Params, TEXT("Recording="), RecordingPath);
+	FParse::Value(*Params, TEXT("Map="), MapPackageName);
+	FParse::Value(*Params, TEXT("Tolerance="), Tolerance);
+
+	FKPCMovementRecording Recording = {};
+	if ((RecordingPath.IsEmpty()) || (!Recording.LoadFromFile(RecordingPath)))
+	{
+		UE_LOG(LogMovementReplay, Error, TEXT("Failed to load recording %s."), *RecordingPath);
+		return 2;
+	}
+
+	if (MapPackageName.IsEmpty())
+	{
+		MapPackageName = Recording.MapPackageName;
+	}
+
+	UClass* PawnClass = LoadClass<APlayerPawn>(nullptr, *Recording.PawnClassPath);
+	if (!IsValid(PawnClass))
+	{
+		UE_LOG(LogMovementReplay, Error, TEXT("Failed to load pawn class %s."), *Recording.PawnClassPath);
+		return 2;
+	}
+
+	FMovementTestWorld TestWorld = {};
+	if (!TestWorld.InitializeFromMap(MapPackageName))
+	{
+		UE_LOG(LogMovementReplay, Error, TEXT("Failed to load map %s."), *MapPackageName);
+		return 2;
+	}
+
+	APlayerPawn* Pawn = TestWorld.SpawnPawn(PawnClass, Recording.InitialLocation, Recording.InitialRotation.Rotator());
+	if (!IsValid(Pawn))
+	{
+		UE_LOG(LogMovementReplay, Error, TEXT("Failed to spawn pawn %s."), *Recording.PawnClassPath);
+		return 2;
+	}
+
+	UCharacterPawnMovementComponent* Movement = Pawn->GetCharacterPawnMovementComponent();
+	Movement->ResetMovementState(Recording.InitialLocation, Recording.InitialRotation, Recording.InitialVelocity, Recording.InitialFixedTimestepAccumulator);
+
+	// Let the physics scene pick up the spawned pawn before stepping movement.
+	TestWorld.Tick(0.0f);
+
+	UE_LOG(LogMovementReplay, Display, TEXT("Replaying %d frames recorded in %s."), Recording.Frames.Num(), *MapPackageName);
+
+	TArray<double> Samples = {};
+	Samples.Reserve(Recording.Frames.Num());
+	int32 DivergedFrame = INDEX_NONE;
+	double ElapsedTime = 0.0;
+
+	for (int32 i = 0; i < Recording.Frames.Num(); ++i)
+	{
+		const FKPCMovementRecordFrame& Frame = Recording.Frames[i];
+
+		Movement->ApplyRecordedFrameInput(Frame);
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		Movement->TickMovement(Frame.DeltaTime);
+		Samples.Add(FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles) * 1000000.0);
+
+		TestWorld.Tick(Frame.DeltaTime);
+		ElapsedTime += static_cast<double>(Frame.DeltaTime);
+
+		// Recorded results are quantized so compare with a tolerance above the recording resolution.
+		const FVector Location = Pawn->GetActorLocation();
+		const FVector Velocity = Movement->GetVelocity();
+		const double LocationError = FVector::Dist(Location, Frame.Location);
+		const double VelocityError = FVector::Dist(Velocity, Frame.Velocity);
+		if ((DivergedFrame == INDEX_NONE) && ((LocationError > Tolerance) || (VelocityError > Tolerance)))
+		{
+			DivergedFrame = i;
+			UE_LOG(LogMovementReplay, Error, TEXT("Trajectory diverged at frame %d (%.3fs)."), i, ElapsedTime);
+			UE_LOG(LogMovementReplay, Error, TEXT("  Location recorded %s replayed %s (error %.3fcm)."), *Frame.Location.ToString(), *Location.ToString(), LocationError);
+			UE_LOG(LogMovementReplay, Error, TEXT("  Velocity recorded %s replayed %s (error %.3fcm/s)."), *Frame.Velocity.ToString(), *Velocity.ToString(), VelocityError);
+		}
+	}
+
+	if (!Samples.IsEmpty())
+	{
+		Samples.Sort();
+		double Mean = 0.0;
+		for (double Sample : Samples)
+		{
+			Mean += Sample;
+		}
+		Mean /= static_cast<double>(Samples.Num());
+		const double P99 = Samples[FMath::Clamp(FMath::CeilToInt(static_cast<double>(Samples.Num()) * 0.99) - 1, 0, Samples.Num() - 1)];
+
+		UE_LOG(LogMovementReplay, Display, TEXT("Movement tick mean %.2fus p99 %.2fus over %d frames."), Mean, P99, Samples.Num());
+	}
+
+	if (DivergedFrame != INDEX_NONE)
+	{
+		return 1;
+	}
+
+	UE_LOG(LogMovementReplay, Display, TEXT("Replay matched the recording within %.3f."), Tolerance);
+	return 0;
+}
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProjectSolisCommandlet.h"
+#include "MovementReplayCommandlet.generated.h"
+
+/**
+ * Replays a recorded character pawn movement session headlessly. Loads the map the session was recorded in, spawns the recorded pawn class at the recorded start
+ * state and feeds it the recorded delta times, movement input and events frame by frame. Reports the first frame where the simulated trajectory diverges from the
+ * recorded one and the cost of each movement tick.
+ *
+ * Usage: UnrealEditor-Cmd ProjectSolis.uproject -run=MovementReplay -nullrhi -Recording=Path [-Map=PackageName] [-Tolerance=0.1]
+ */
+UCLASS()
+class PROJECTSOLIS_API UMovementReplayCommandlet : public UProjectSolisCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMovementReplayCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementTestWorld.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Components/StaticMeshComponent.h"
+#include "GameFramework/WorldSettings.h"
+#include "../Actors/Pawns/PlayerPawn.h"
+#include "../ActorComponents/MovementComponents/CharacterPawnMovementComponent.h"
+
+FMovementTestWorld::~FMovementTestWorld()
+{
+	Shutdown();
+}
+
+bool FMovementTestWorld::Initialize(const FName WorldName)
+{
+	check(World == nullptr);
+
+	World = UWorld::CreateWorld(EWorldType::Game, false, WorldName);
+	if (!IsValid(World))
+	{
+		World = nullptr;
+		return false;
+	}
+
+	BeginPlay();
+	return true;
+}
+
+bool FMovementTestWorld::InitializeFromMap(const FString& MapPackageName)
+{
+	check(World == nullptr);
+
+	UPackage* MapPackage = LoadPackage(nullptr, *MapPackageName, LOAD_None);
+	World = (MapPackage != nullptr) ? UWorld::FindWorldInPackage(MapPackage) : nullptr;
+	if (!IsValid(World))
+	{
+		World = nullptr;
+		return false;
+	}
+
+	// Keep the loaded world alive while it is not referenced by a world context.
+	World->AddToRoot();
+	bLoadedFromMap = true;
+
+	World->WorldType = EWorldType::Game;
+	if (!World->bIsWorldInitialized)
+	{
+		World->InitWorld(UWorld::InitializationValues().AllowAudioPlayback(false).ShouldSimulatePhysics(false).EnableTraceCollision(true));
+	}
+
+	BeginPlay();
+	return true;
+}
+
+void FMovementTestWorld::BeginPlay()
+{
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	// There is no game mode in the world so dispatch begin play through the world settings directly.
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+	World->GetWorldSettings()->NotifyBeginPlay();
+}
+
+void FMovementTestWorld::Shutdown()
+{
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	World->BeginTearingDown();
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	if (bLoadedFromMap)
+	{
+		World->RemoveFromRoot();
+		bLoadedFromMap = false;
+	}
+	World = nullptr;
+
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+AStaticMeshActor* FMovementTestWorld::SpawnStaticMesh(const TCHAR* MeshPath, const FTransform& Transform)
+{
+	UStaticMesh* Mesh = LoadObject<UStaticMesh>(nullptr, MeshPath);
+	if (!IsValid(Mesh))
+	{
+		return nullptr;
+	}
+
+	// Set the mesh before the component is registered. Static components can not have their mesh changed once registered.
+	AStaticMeshActor* Actor = World->SpawnActorDeferred<AStaticMeshActor>(AStaticMeshActor::StaticClass(), Transform);
+	Actor->GetStaticMeshComponent()->SetStaticMesh(Mesh);
+	Actor->FinishSpawning(Transform);
+	return Actor;
+}
+
+APlayerPawn* FMovementTestWorld::SpawnPawn(UClass* PawnClass, const FVector& Location, const FRotator& Rotation)
+{
+	FActorSpawnParameters SpawnParameters = {};
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	APlayerPawn* Pawn = World->SpawnActor<APlayerPawn>(PawnClass, Location, Rotation, SpawnParameters);
+	if (IsValid(Pawn))
+	{
+		Pawn->GetCharacterPawnMovementComponent()->SetComponentTickEnabled(false);
+	}
+	return Pawn;
+}
+
+void FMovementTestWorld::Tick(float DeltaTime)
+{
+	World->Tick(ELevelTick::LEVELTICK_All, DeltaTime);
+}
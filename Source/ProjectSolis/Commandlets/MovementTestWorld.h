@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWorld;
+class AStaticMeshActor;
+class APlayerPawn;
+
+/**
+ * Creates and owns a game world that movement can be simulated in headlessly. Used by commandlets that step character pawn movement outside of a running game.
+ */
+class PROJECTSOLIS_API FMovementTestWorld
+{
+private:
+	UWorld* World = nullptr;
+	// True if the world was loaded from a map package and was added to the root set to keep it alive.
+	bool bLoadedFromMap = false;
+
+public:
+	~FMovementTestWorld();
+
+	// Creates an empty game world and begins play in it. Returns false if the world could not be created.
+	bool Initialize(const FName WorldName);
+
+	// Loads the map package as a game world and begins play in it. Returns false if the map could not be loaded.
+	bool InitializeFromMap(const FString& MapPackageName);
+
+	// Ends play and destroys the world.
+	void Shutdown();
+
+	// Spawns a static mesh actor using the mesh at the given object path. Returns null if the mesh could not be loaded.
+	AStaticMeshActor* SpawnStaticMesh(const TCHAR* MeshPath, const FTransform& Transform);
+
+	// Spawns a player pawn that is not possessed and whose movement component does not tick itself. Movement is stepped with UCharacterPawnMovementComponent::TickMovement.
+	APlayerPawn* SpawnPawn(UClass* PawnClass, const FVector& Location, const FRotator& Rotation);
+
+	// Ticks the world. Required to flush changes to the physics scene so scene queries see newly spawned or moved primitives.
+	void Tick(float DeltaTime);
+
+	UWorld* GetWorld() const { return World; }
+
+private:
+	// Creates a world context for the world and begins play.
+	void BeginPlay();
+};
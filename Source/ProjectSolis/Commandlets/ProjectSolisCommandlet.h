@@ -0,0 +1,17 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "../ProjectBaseClasses/ProjectCommandlet.h"
+#include "ProjectSolisCommandlet.generated.h"
+
+/**
+ * 
+ */
+UCLASS(Abstract)
+class PROJECTSOLIS_API UProjectSolisCommandlet : public UProjectCommandlet
+{
+	GENERATED_BODY()
+	
+};
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CharacterPawnMovementSettings.h"
+#include "../../Libraries/MathUtilityLibrary.h"
+
+void UCharacterPawnMovementSettings::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	UpdateDerivedConstants();
+}
+
+void UCharacterPawnMovementSettings::PostLoad()
+{
+	Super::PostLoad();
+
+	UpdateDerivedConstants();
+}
+
+#if WITH_EDITOR
+void UCharacterPawnMovementSettings::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	UpdateDerivedConstants();
+}
+#endif
+
+void UCharacterPawnMovementSettings::UpdateDerivedConstants()
+{
+	WalkableFloorZ = UMathUtilityLibrary::WalkableFloorZFromAngle(MaxWalkableSlopeAngle);
+	StepSnapDownDistance = FMath::Min(MaxSnapDownDistance, MaxStepHeight);
+	MinAnalogInputScale = (MaxWalkSpeed > 0.0f) ? static_cast<double>(MinAnalogWalkSpeed / MaxWalkSpeed) : 0.0;
+}
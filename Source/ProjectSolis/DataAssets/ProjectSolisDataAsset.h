@@ -0,0 +1,17 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "../ProjectBaseClasses/ProjectDataAsset.h"
+#include "ProjectSolisDataAsset.generated.h"
+
+/**
+ * 
+ */
+UCLASS(Abstract)
+class PROJECTSOLIS_API UProjectSolisDataAsset : public UProjectDataAsset
+{
+	GENERATED_BODY()
+	
+};
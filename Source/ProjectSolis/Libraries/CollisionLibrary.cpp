@@ -3,6 +3,360 @@
 
 #include "CollisionLibrary.h"
 #include "MathUtilityLibrary.h"
+#include "../ActorComponents/MovementComponents/KinematicPawnStats.h"
+#include "Algo/Sort.h"
+#include "Components/PrimitiveComponent.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "PhysicsProxy/SingleParticlePhysicsProxy.h"
+#include "Chaos/GeometryQueries.h"
+#include "Chaos/Box.h"
+#include "Chaos/Capsule.h"
+#include "Chaos/Sphere.h"
+
+namespace CollisionLibraryKernels
+{
+	// Conservative advancement stops once the capsule is within this distance (in cm) of the shape.
+	static constexpr double ContactTolerance = 0.01;
+	static constexpr int32 MaxAdvancementIterations = 16;
+
+	// A convex shape in its local space, as a core inflated by a radius. The core is a segment along Z with half length Extent.Z, or a box with half extents
+	// Extent.
+	struct FCore
+	{
+		bool bBox = false;
+		FVector Extent = FVector::ZeroVector;
+		double Radius = 0.0;
+	};
+
+	FORCEINLINE VectorRegister LoadVector(const FVector& Vector)
+	{
+		return VectorLoadFloat3_W0(&Vector.X);
+	}
+
+	FORCEINLINE FVector StoreVector(const VectorRegister& Vector)
+	{
+		FVector Result;
+		VectorStoreFloat3(Vector, &Result.X);
+		return Result;
+	}
+
+	FORCEINLINE VectorRegister ReplicateScalar(const double Value)
+	{
+		return MakeVectorRegisterDouble(Value, Value, Value, Value);
+	}
+
+	bool MakeCore(const FKPCAnalyticShape& Shape, FCore& OutCore)
+	{
+		switch (Shape.Type)
+		{
+		case EKPCAnalyticShapeType::Sphere:
+			OutCore = { false, FVector::ZeroVector, Shape.Extent.X };
+			return true;
+
+		case EKPCAnalyticShapeType::Capsule:
+			OutCore = { false, FVector(0.0, 0.0, Shape.Extent.Z), Shape.Extent.X };
+			return true;
+
+		case EKPCAnalyticShapeType::Box:
+			OutCore = { true, Shape.Extent, 0.0 };
+			return true;
+
+		default:
+			return false;
+		}
+	}
+
+	// Closest points between the segments Start + Direction * [0, 1]. Real-Time Collision Detection, Ericson, 5.1.9. Returns the distance between them.
+	double ClosestPointsBetweenSegments(const VectorRegister& StartA,
+		const VectorRegister& DirectionA,
+		const VectorRegister& StartB,
+		const VectorRegister& DirectionB,
+		VectorRegister& OutOnA,
+		VectorRegister& OutOnB)
+	{
+		const VectorRegister Offset = VectorSubtract(StartA, StartB);
+		const double LengthSquaredA = VectorDot3Scalar(DirectionA, DirectionA);
+		const double LengthSquaredB = VectorDot3Scalar(DirectionB, DirectionB);
+		const double OffsetAlongB = VectorDot3Scalar(DirectionB, Offset);
+
+		double ParameterA = 0.0;
+		double ParameterB = 0.0;
+		if ((LengthSquaredA <= UE_SMALL_NUMBER) && (LengthSquaredB > UE_SMALL_NUMBER))
+		{
+			ParameterB = FMath::Clamp(OffsetAlongB / LengthSquaredB, 0.0, 1.0);
+		}
+		else if (LengthSquaredA > UE_SMALL_NUMBER)
+		{
+			const double OffsetAlongA = VectorDot3Scalar(DirectionA, Offset);
+			if (LengthSquaredB <= UE_SMALL_NUMBER)
+			{
+				ParameterA = FMath::Clamp(-OffsetAlongA / LengthSquaredA, 0.0, 1.0);
+			}
+			else
+			{
+				const double DirectionDot = VectorDot3Scalar(DirectionA, DirectionB);
+				const double Denominator = (LengthSquaredA * LengthSquaredB) - (DirectionDot * DirectionDot);
+				// Parallel segments pick an arbitrary point on A.
+				ParameterA = (Denominator > UE_SMALL_NUMBER) ? FMath::Clamp(((DirectionDot * OffsetAlongB) - (OffsetAlongA * LengthSquaredB)) / Denominator, 0.0, 1.0) : 0.0;
+				ParameterB = ((DirectionDot * ParameterA) + OffsetAlongB) / LengthSquaredB;
+				if (ParameterB < 0.0)
+				{
+					ParameterB = 0.0;
+					ParameterA = FMath::Clamp(-OffsetAlongA / LengthSquaredA, 0.0, 1.0);
+				}
+				else if (ParameterB > 1.0)
+				{
+					ParameterB = 1.0;
+					ParameterA = FMath::Clamp((DirectionDot - OffsetAlongA) / LengthSquaredA, 0.0, 1.0);
+				}
+			}
+		}
+
+		OutOnA = VectorMultiplyAdd(DirectionA, ReplicateScalar(ParameterA), StartA);
+		OutOnB = VectorMultiplyAdd(DirectionB, ReplicateScalar(ParameterB), StartB);
+		const VectorRegister Separation = VectorSubtract(OutOnA, OutOnB);
+		return FMath::Sqrt(VectorDot3Scalar(Separation, Separation));
+	}
+
+	// Closest points between the segment Start + Direction * [0, 1] and a box centered on the origin. The squared distance from a point on the segment to the box
+	// is a piecewise quadratic in the segment parameter that only changes form where the segment crosses one of the box's slab planes, so each piece is
+	// minimised exactly. Returns the distance between them.
+	double ClosestPointsSegmentBox(const VectorRegister& Start,
+		const VectorRegister& Direction,
+		const VectorRegister& Extent,
+		VectorRegister& OutOnSegment,
+		VectorRegister& OutOnBox)
+	{
+		const FVector StartValue = StoreVector(Start);
+		const FVector DirectionValue = StoreVector(Direction);
+		const FVector ExtentValue = StoreVector(Extent);
+
+		// The segment ends plus at most one crossing of each of the six slab planes.
+		double Breaks[8] = { 0.0 };
+		int32 NumBreaks = 1;
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			if (FMath::Abs(DirectionValue[Axis]) <= UE_SMALL_NUMBER)
+			{
+				continue;
+			}
+
+			for (const double Plane : { -ExtentValue[Axis], ExtentValue[Axis] })
+			{
+				const double Break = (Plane - StartValue[Axis]) / DirectionValue[Axis];
+				if ((Break > 0.0) && (Break < 1.0))
+				{
+					Breaks[NumBreaks++] = Break;
+				}
+			}
+		}
+		Breaks[NumBreaks++] = 1.0;
+		Algo::Sort(TArrayView<double>(Breaks, NumBreaks));
+
+		const VectorRegister NegativeExtent = VectorNegate(Extent);
+		const VectorRegister Zero = ReplicateScalar(0.0);
+		double BestParameter = 0.0;
+		double BestDistanceSquared = TNumericLimits<double>::Max();
+		for (int32 Piece = 0; Piece < (NumBreaks - 1); ++Piece)
+		{
+			const double PieceStart = Breaks[Piece];
+			const double PieceEnd = Breaks[Piece + 1];
+
+			// Axes where the piece is inside the slab do not contribute. On the others the distance to the slab is Offset + Direction * Parameter.
+			const VectorRegister Midpoint = VectorMultiplyAdd(Direction, ReplicateScalar((PieceStart + PieceEnd) * 0.5), Start);
+			const VectorRegister Above = VectorCompareGT(Midpoint, Extent);
+			const VectorRegister Below = VectorCompareLT(Midpoint, NegativeExtent);
+			const VectorRegister Offset = VectorSelect(Above, VectorSubtract(Start, Extent), VectorSelect(Below, VectorAdd(Start, Extent), Zero));
+			const VectorRegister OutsideDirection = VectorSelect(VectorBitwiseOr(Above, Below), Direction, Zero);
+
+			const double Quadratic = VectorDot3Scalar(OutsideDirection, OutsideDirection);
+			const double Linear = VectorDot3Scalar(OutsideDirection, Offset);
+			const double Parameter = (Quadratic > UE_SMALL_NUMBER) ? FMath::Clamp(-Linear / Quadratic, PieceStart, PieceEnd) : PieceStart;
+			const double DistanceSquared = VectorDot3Scalar(Offset, Offset) + (2.0 * Linear * Parameter) + (Quadratic * Parameter * Parameter);
+			if (DistanceSquared < BestDistanceSquared)
+			{
+				BestDistanceSquared = DistanceSquared;
+				BestParameter = Parameter;
+			}
+		}
+
+		OutOnSegment = VectorMultiplyAdd(Direction, ReplicateScalar(BestParameter), Start);
+		OutOnBox = VectorMin(VectorMax(OutOnSegment, NegativeExtent), Extent);
+		const VectorRegister Separation = VectorSubtract(OutOnSegment, OutOnBox);
+		return FMath::Sqrt(VectorDot3Scalar(Separation, Separation));
+	}
+
+	double ClosestPointsToCore(const FCore& Core,
+		const VectorRegister& SegmentStart,
+		const VectorRegister& SegmentDirection,
+		VectorRegister& OutOnSegment,
+		VectorRegister& OutOnCore)
+	{
+		if (Core.bBox)
+		{
+			return ClosestPointsSegmentBox(SegmentStart, SegmentDirection, LoadVector(Core.Extent), OutOnSegment, OutOnCore);
+		}
+
+		const VectorRegister CoreStart = MakeVectorRegisterDouble(0.0, 0.0, -Core.Extent.Z, 0.0);
+		const VectorRegister CoreDirection = MakeVectorRegisterDouble(0.0, 0.0, 2.0 * Core.Extent.Z, 0.0);
+		return ClosestPointsBetweenSegments(SegmentStart, SegmentDirection, CoreStart, CoreDirection, OutOnSegment, OutOnCore);
+	}
+
+	// Minimum translation separating the segment inflated by Radius from the core, in the core's local space.
+	bool ComputePenetrationLocal(const FCore& Core,
+		const VectorRegister& SegmentStart,
+		const VectorRegister& SegmentDirection,
+		const double Radius,
+		FVector& OutDirection,
+		double& OutDepth)
+	{
+		VectorRegister OnSegment;
+		VectorRegister OnCore;
+		const double Distance = ClosestPointsToCore(Core, SegmentStart, SegmentDirection, OnSegment, OnCore);
+		if (Distance >= Radius)
+		{
+			return false;
+		}
+
+		if (Distance > UE_KINDA_SMALL_NUMBER)
+		{
+			OutDirection = StoreVector(VectorSubtract(OnSegment, OnCore)) / Distance;
+			OutDepth = Radius - Distance;
+			return true;
+		}
+
+		// The segment passes through the core so the closest points give no direction.
+		if (Core.bBox)
+		{
+			// Push out through the face that needs the least translation to clear the whole capsule.
+			const VectorRegister SegmentEnd = VectorAdd(SegmentStart, SegmentDirection);
+			const VectorRegister Reach = VectorAdd(LoadVector(Core.Extent), ReplicateScalar(Radius));
+			const FVector PushPositive = StoreVector(VectorSubtract(Reach, VectorMin(SegmentStart, SegmentEnd)));
+			const FVector PushNegative = StoreVector(VectorAdd(Reach, VectorMax(SegmentStart, SegmentEnd)));
+
+			OutDepth = TNumericLimits<double>::Max();
+			for (int32 Axis = 0; Axis < 3; ++Axis)
+			{
+				if (PushPositive[Axis] < OutDepth)
+				{
+					OutDepth = PushPositive[Axis];
+					OutDirection = FVector::ZeroVector;
+					OutDirection[Axis] = 1.0;
+				}
+
+				if (PushNegative[Axis] < OutDepth)
+				{
+					OutDepth = PushNegative[Axis];
+					OutDirection = FVector::ZeroVector;
+					OutDirection[Axis] = -1.0;
+				}
+			}
+			return true;
+		}
+
+		// Crossing segments separate along their common perpendicular, pointing away from the core's center.
+		const FVector SegmentMidpoint = StoreVector(VectorMultiplyAdd(SegmentDirection, ReplicateScalar(0.5), SegmentStart));
+		OutDirection = FVector::CrossProduct(StoreVector(SegmentDirection), FVector::UpVector);
+		if (!OutDirection.Normalize())
+		{
+			OutDirection = FVector(SegmentMidpoint.X, SegmentMidpoint.Y, 0.0).GetSafeNormal(UE_SMALL_NUMBER, FVector::ForwardVector);
+		}
+		else if (FVector::DotProduct(OutDirection, SegmentMidpoint) < 0.0)
+		{
+			OutDirection = -OutDirection;
+		}
+		OutDepth = Radius;
+		return true;
+	}
+
+	void SetBlockingHit(FHitResult& OutHit, const FVector& Start, const FVector& End, const double Time, const FVector& Normal, const FVector& ImpactPoint)
+	{
+		OutHit.Init(Start, End);
+		OutHit.bBlockingHit = true;
+		OutHit.Time = static_cast<float>(Time);
+		OutHit.Location = FMath::Lerp(Start, End, Time);
+		OutHit.Distance = static_cast<float>(FVector::Distance(Start, OutHit.Location));
+		OutHit.Normal = Normal;
+		OutHit.ImpactNormal = Normal;
+		OutHit.ImpactPoint = ImpactPoint;
+		OutHit.FaceIndex = INDEX_NONE;
+	}
+
+	void SetPenetratingHit(FHitResult& OutHit, const FVector& Start, const FVector& End, const FVector& Normal, const double Depth)
+	{
+		SetBlockingHit(OutHit, Start, End, 0.0, Normal, Start);
+		OutHit.bStartPenetrating = true;
+		OutHit.PenetrationDepth = static_cast<float>(Depth);
+	}
+
+	EKPCAnalyticSweepResult SweepCapsuleAgainstCore(FHitResult& OutHit,
+		const FVector& Start,
+		const FVector& End,
+		const FQuat& CapsuleRotation,
+		const double CapsuleRadius,
+		const double CapsuleHalfLength,
+		const FVector& ShapeCenter,
+		const FQuat& ShapeRotation,
+		const FCore& Core)
+	{
+		// Work in the shape's local space with the capsule as a segment inflated by both radii.
+		const FVector LocalAxis = ShapeRotation.UnrotateVector(CapsuleRotation.GetUpVector()) * CapsuleHalfLength;
+		const FVector LocalDelta = ShapeRotation.UnrotateVector(End - Start);
+		const double Radius = CapsuleRadius + Core.Radius;
+		const VectorRegister Delta = LoadVector(LocalDelta);
+		const VectorRegister SegmentDirection = LoadVector(LocalAxis * 2.0);
+		VectorRegister SegmentStart = LoadVector(ShapeRotation.UnrotateVector(Start - ShapeCenter) - LocalAxis);
+
+		VectorRegister OnSegment;
+		VectorRegister OnCore;
+		double Distance = ClosestPointsToCore(Core, SegmentStart, SegmentDirection, OnSegment, OnCore);
+		if (Distance < (Radius - UE_KINDA_SMALL_NUMBER))
+		{
+			FVector LocalDirection = FVector::UpVector;
+			double Depth = 0.0;
+			ComputePenetrationLocal(Core, SegmentStart, SegmentDirection, Radius, LocalDirection, Depth);
+			SetPenetratingHit(OutHit, Start, End, ShapeRotation.RotateVector(LocalDirection), Depth);
+			return EKPCAnalyticSweepResult::Hit;
+		}
+
+		// Conservative advancement. The closest points define a plane separating the capsule from the shape and the capsule can not touch the shape before
+		// covering the gap along the plane's normal, so each step advances exactly that far. A capsule that is not moving towards the plane never touches.
+		double Time = 0.0;
+		FVector LocalNormal = FVector::UpVector;
+		for (int32 Iteration = 0; Iteration < MaxAdvancementIterations; ++Iteration)
+		{
+			LocalNormal = StoreVector(VectorSubtract(OnSegment, OnCore)).GetSafeNormal(UE_SMALL_NUMBER, FVector::UpVector);
+			const double Approach = -FVector::DotProduct(LocalDelta, LocalNormal);
+			if (Approach <= UE_SMALL_NUMBER)
+			{
+				return EKPCAnalyticSweepResult::Miss;
+			}
+
+			const double Separation = Distance - Radius;
+			if (Separation <= ContactTolerance)
+			{
+				const FVector LocalImpactPoint = StoreVector(OnCore) + (LocalNormal * Core.Radius);
+				SetBlockingHit(OutHit, Start, End, Time, ShapeRotation.RotateVector(LocalNormal), ShapeCenter + ShapeRotation.RotateVector(LocalImpactPoint));
+				return EKPCAnalyticSweepResult::Hit;
+			}
+
+			const double Step = Separation / Approach;
+			Time += Step;
+			if (Time > 1.0)
+			{
+				return EKPCAnalyticSweepResult::Miss;
+			}
+
+			SegmentStart = VectorMultiplyAdd(Delta, ReplicateScalar(Step), SegmentStart);
+			Distance = ClosestPointsToCore(Core, SegmentStart, SegmentDirection, OnSegment, OnCore);
+		}
+
+		// Running out of iterations only happens on near grazing contacts, where the capsule may still pass the shape without touching it, so neither a hit nor
+		// a miss can be reported.
+		return EKPCAnalyticSweepResult::Unresolved;
+	}
+}
+
 
 FCollisionShape UCollisionLibrary::InflateShape(const FCollisionShape& Shape, float Amount)
 {
@@ -86,6 +440,23 @@ FVector UCollisionLibrary::GetLowestPointOnShape_Box(const FVector& Location, co
 	return Lowest;
 }
 
+void UCollisionLibrary::GetLowestPointOnShapeBatch(const FCollisionShape& Shape,
+	TConstArrayView<FVector> ShapeLocations,
+	const FQuat& ShapeRotation,
+	const FVector& ShapeUp,
+	TArrayView<FVector> OutPoints)
+{
+	check(OutPoints.Num() >= ShapeLocations.Num());
+
+	// The lowest point is a fixed offset from the shape's location for a given shape and rotation.
+	const FVector Offset = GetLowestPointOnShape(Shape, FVector::ZeroVector, ShapeRotation, ShapeUp);
+	const VectorRegister OffsetVector = CollisionLibraryKernels::LoadVector(Offset);
+	for (int32 i = 0; i < ShapeLocations.Num(); ++i)
+	{
+		VectorStoreFloat3(VectorAdd(CollisionLibraryKernels::LoadVector(ShapeLocations[i]), OffsetVector), &OutPoints[i].X);
+	}
+}
+
 double UCollisionLibrary::GetShapeHalfHeight(const FVector& ShapeLocation, const FVector& ShapeLowestPoint)
 {
 	return UMathUtilityLibrary::NumericalDistance(ShapeLocation.Z, ShapeLowestPoint.Z);
@@ -129,6 +500,7 @@ bool UCollisionLibrary::SweepShapeSingleByChannel(UWorld* const World,
 	const bool DrawDebug,
 	const float DebugDuration)
 {
+	INC_DWORD_STAT(STAT_KPCSweeps);
 	const bool bHit = World->SweepSingleByChannel(OutHit, Start, End, ShapeRotation, TraceChannel, Shape, CollisionQueryParams);
 
 #if !UE_BUILD_SHIPPING
@@ -170,7 +542,9 @@ bool UCollisionLibrary::SweepShapeMultiByChannel(UWorld* const World,
 	const bool DrawDebug,
 	const float DebugDuration)
 {
+	INC_DWORD_STAT(STAT_KPCSweeps);
 	const bool bHit = World->SweepMultiByChannel(OutHits, Start, End, ShapeRotation, TraceChannel, Shape, CollisionQueryParams);
+	INC_DWORD_STAT_BY(STAT_KPCMultiSweepHits, OutHits.Num());
 
 #if !UE_BUILD_SHIPPING
 	if (DrawDebug)
@@ -200,3 +574,395 @@ bool UCollisionLibrary::SweepShapeMultiByChannel(UWorld* const World,
 
 	return bHit;
 }
+
+bool UCollisionLibrary::MakeAnalyticShape(UPrimitiveComponent* const Primitive, FKPCAnalyticShape& OutShape)
+{
+	OutShape = {};
+
+	const UBodySetup* BodySetup = (IsValid(Primitive)) ? Primitive->GetBodySetup() : nullptr;
+	if ((BodySetup == nullptr) || (BodySetup->GetCollisionTraceFlag() == ECollisionTraceFlag::CTF_UseComplexAsSimple) ||
+		(BodySetup->AggGeom.GetElementCount() != 1))
+	{
+		return false;
+	}
+
+	const FTransform& ComponentTransform = Primitive->GetComponentTransform();
+	const FVector Scale = ComponentTransform.GetScale3D().GetAbs();
+	const bool bUniformScale = Scale.AllComponentsEqual(UE_KINDA_SMALL_NUMBER);
+	const FKAggregateGeom& Geometry = BodySetup->AggGeom;
+
+	if (Geometry.BoxElems.Num() == 1)
+	{
+		// Non uniform scale only keeps a box a box when the box is aligned with the component.
+		const FKBoxElem& Box = Geometry.BoxElems[0];
+		if ((!bUniformScale) && (!Box.Rotation.IsNearlyZero()))
+		{
+			return false;
+		}
+
+		OutShape.Type = EKPCAnalyticShapeType::Box;
+		OutShape.Center = ComponentTransform.TransformPosition(Box.Center);
+		OutShape.Rotation = ComponentTransform.GetRotation() * Box.Rotation.Quaternion();
+		OutShape.Extent = FVector(Box.X, Box.Y, Box.Z) * 0.5 * Scale;
+		return true;
+	}
+
+	if (!bUniformScale)
+	{
+		return false;
+	}
+
+	if (Geometry.SphereElems.Num() == 1)
+	{
+		const FKSphereElem& Sphere = Geometry.SphereElems[0];
+		OutShape.Type = EKPCAnalyticShapeType::Sphere;
+		OutShape.Center = ComponentTransform.TransformPosition(Sphere.Center);
+		OutShape.Extent = FVector(Sphere.Radius * Scale.X, 0.0, 0.0);
+		return true;
+	}
+
+	if (Geometry.SphylElems.Num() == 1)
+	{
+		const FKSphylElem& Sphyl = Geometry.SphylElems[0];
+		OutShape.Type = EKPCAnalyticShapeType::Capsule;
+		OutShape.Center = ComponentTransform.TransformPosition(Sphyl.Center);
+		OutShape.Rotation = ComponentTransform.GetRotation() * Sphyl.Rotation.Quaternion();
+		OutShape.Extent = FVector(Sphyl.Radius * Scale.X, 0.0, Sphyl.Length * 0.5 * Scale.X);
+		return true;
+	}
+
+	return false;
+}
+
+EKPCAnalyticSweepResult UCollisionLibrary::SweepCapsuleAgainstShape(FHitResult& OutHit,
+	const FVector& Start,
+	const FVector& End,
+	const FQuat& CapsuleRotation,
+	const float CapsuleRadius,
+	const float CapsuleHalfLength,
+	const FKPCAnalyticShape& Shape)
+{
+	INC_DWORD_STAT(STAT_KPCAnalyticSweeps);
+
+	if (Shape.Type == EKPCAnalyticShapeType::Plane)
+	{
+		return (SweepCapsuleAgainstPlane(OutHit, Start, End, CapsuleRotation, CapsuleRadius, CapsuleHalfLength, Shape.Center, Shape.Rotation.GetUpVector())) ?
+			EKPCAnalyticSweepResult::Hit : EKPCAnalyticSweepResult::Miss;
+	}
+
+	CollisionLibraryKernels::FCore Core = {};
+	if (!CollisionLibraryKernels::MakeCore(Shape, Core))
+	{
+		return EKPCAnalyticSweepResult::Unresolved;
+	}
+
+	const EKPCAnalyticSweepResult Result = CollisionLibraryKernels::SweepCapsuleAgainstCore(OutHit, Start, End, CapsuleRotation, CapsuleRadius, CapsuleHalfLength,
+		Shape.Center, Shape.Rotation, Core);
+	if (Result == EKPCAnalyticSweepResult::Unresolved)
+	{
+		INC_DWORD_STAT(STAT_KPCAnalyticSweepsUnresolved);
+	}
+	return Result;
+}
+
+bool UCollisionLibrary::SweepCapsuleAgainstPlane(FHitResult& OutHit,
+	const FVector& Start,
+	const FVector& End,
+	const FQuat& CapsuleRotation,
+	const float CapsuleRadius,
+	const float CapsuleHalfLength,
+	const FVector& PlanePoint,
+	const FVector& PlaneNormal)
+{
+	const FVector Normal = PlaneNormal.GetSafeNormal(UE_SMALL_NUMBER, FVector::UpVector);
+	const FVector Axis = CapsuleRotation.GetUpVector();
+
+	// Distance from the capsule's center to its furthest point against the normal.
+	const double AxisAlongNormal = FVector::DotProduct(Axis, Normal);
+	const double Reach = (FMath::Abs(AxisAlongNormal) * CapsuleHalfLength) + CapsuleRadius;
+	const double StartSeparation = FVector::DotProduct(Start - PlanePoint, Normal) - Reach;
+	if (StartSeparation < -UE_KINDA_SMALL_NUMBER)
+	{
+		CollisionLibraryKernels::SetPenetratingHit(OutHit, Start, End, Normal, -StartSeparation);
+		return true;
+	}
+
+	const double Approach = -FVector::DotProduct(End - Start, Normal);
+	if (Approach <= UE_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	const double Time = FMath::Max(StartSeparation, 0.0) / Approach;
+	if (Time > 1.0)
+	{
+		return false;
+	}
+
+	const FVector Location = FMath::Lerp(Start, End, Time);
+	const FVector ImpactPoint = Location - (Axis * (CapsuleHalfLength * FMath::Sign(AxisAlongNormal))) - (Normal * CapsuleRadius);
+	CollisionLibraryKernels::SetBlockingHit(OutHit, Start, End, Time, Normal, ImpactPoint);
+	return true;
+}
+
+bool UCollisionLibrary::SweepCapsuleAgainstSphere(FHitResult& OutHit,
+	const FVector& Start,
+	const FVector& End,
+	const FQuat& CapsuleRotation,
+	const float CapsuleRadius,
+	const float CapsuleHalfLength,
+	const FVector& SphereCenter,
+	const float SphereRadius)
+{
+	const CollisionLibraryKernels::FCore Core = { false, FVector::ZeroVector, SphereRadius };
+	return (CollisionLibraryKernels::SweepCapsuleAgainstCore(OutHit, Start, End, CapsuleRotation, CapsuleRadius, CapsuleHalfLength, SphereCenter, FQuat::Identity,
+		Core) == EKPCAnalyticSweepResult::Hit);
+}
+
+bool UCollisionLibrary::SweepCapsuleAgainstCapsule(FHitResult& OutHit,
+	const FVector& Start,
+	const FVector& End,
+	const FQuat& CapsuleRotation,
+	const float CapsuleRadius,
+	const float CapsuleHalfLength,
+	const FVector& OtherCenter,
+	const FQuat& OtherRotation,
+	const float OtherRadius,
+	const float OtherHalfLength)
+{
+	const CollisionLibraryKernels::FCore Core = { false, FVector(0.0, 0.0, OtherHalfLength), OtherRadius };
+	return (CollisionLibraryKernels::SweepCapsuleAgainstCore(OutHit, Start, End, CapsuleRotation, CapsuleRadius, CapsuleHalfLength, OtherCenter, OtherRotation, Core) ==
+		EKPCAnalyticSweepResult::Hit);
+}
+
+bool UCollisionLibrary::SweepCapsuleAgainstBox(FHitResult& OutHit,
+	const FVector& Start,
+	const FVector& End,
+	const FQuat& CapsuleRotation,
+	const float CapsuleRadius,
+	const float CapsuleHalfLength,
+	const FVector& BoxCenter,
+	const FQuat& BoxRotation,
+	const FVector& BoxExtent)
+{
+	const CollisionLibraryKernels::FCore Core = { true, BoxExtent, 0.0 };
+	return (CollisionLibraryKernels::SweepCapsuleAgainstCore(OutHit, Start, End, CapsuleRotation, CapsuleRadius, CapsuleHalfLength, BoxCenter, BoxRotation, Core) ==
+		EKPCAnalyticSweepResult::Hit);
+}
+
+bool UCollisionLibrary::ComputeCapsulePenetration(FVector& OutDirection,
+	double& OutDepth,
+	const FVector& Location,
+	const FQuat& CapsuleRotation,
+	const float CapsuleRadius,
+	const float CapsuleHalfLength,
+	const FKPCAnalyticShape& Shape)
+{
+	if (Shape.Type == EKPCAnalyticShapeType::Plane)
+	{
+		const FVector Normal = Shape.Rotation.GetUpVector();
+		const double Reach = (FMath::Abs(FVector::DotProduct(CapsuleRotation.GetUpVector(), Normal)) * CapsuleHalfLength) + CapsuleRadius;
+		const double Separation = FVector::DotProduct(Location - Shape.Center, Normal) - Reach;
+		if (Separation >= 0.0)
+		{
+			return false;
+		}
+
+		OutDirection = Normal;
+		OutDepth = -Separation;
+		return true;
+	}
+
+	CollisionLibraryKernels::FCore Core = {};
+	if (!CollisionLibraryKernels::MakeCore(Shape, Core))
+	{
+		return false;
+	}
+
+	const FVector LocalAxis = Shape.Rotation.UnrotateVector(CapsuleRotation.GetUpVector()) * CapsuleHalfLength;
+	const FVector LocalCenter = Shape.Rotation.UnrotateVector(Location - Shape.Center);
+	FVector LocalDirection = FVector::UpVector;
+	if (!CollisionLibraryKernels::ComputePenetrationLocal(Core, CollisionLibraryKernels::LoadVector(LocalCenter - LocalAxis),
+		CollisionLibraryKernels::LoadVector(LocalAxis * 2.0), CapsuleRadius + Core.Radius, LocalDirection, OutDepth))
+	{
+		return false;
+	}
+
+	OutDirection = Shape.Rotation.RotateVector(LocalDirection);
+	return true;
+}
+
+bool UCollisionLibrary::SweepShapeAgainstParticle_Internal(FHitResult& OutHit,
+	const FVector& Start,
+	const FVector& End,
+	const FQuat& ShapeRotation,
+	const FCollisionShape& Shape,
+	FPhysicsActorHandle Particle)
+{
+	Chaos::FRigidBodyHandle_Internal* Handle = (Particle != nullptr) ? Particle->GetPhysicsThreadAPI() : nullptr;
+	const Chaos::FImplicitObject* Geometry = (Handle != nullptr) ? Handle->Geometry().Get() : nullptr;
+	if (Geometry == nullptr)
+	{
+		return false;
+	}
+
+	// Chaos sweeps need a direction, so zero length sweeps are made as a tiny sweep upwards.
+	const FVector Delta = End - Start;
+	const double Length = FMath::Max(Delta.Size(), UE_KINDA_SMALL_NUMBER);
+	const FVector Direction = (Delta.SizeSquared() > FMath::Square(UE_KINDA_SMALL_NUMBER)) ? (Delta / Length) : FVector::UpVector;
+
+	const Chaos::FRigidTransform3 ParticleTransform(Handle->X(), Handle->R());
+	const Chaos::FRigidTransform3 ShapeTransform(Start, ShapeRotation);
+	Chaos::FReal Time = 0.0;
+	Chaos::FVec3 Position(0.0);
+	Chaos::FVec3 Normal(0.0);
+	Chaos::FVec3 FaceNormal(0.0);
+	int32 FaceIndex = INDEX_NONE;
+	bool bHit = false;
+
+	if (Shape.IsSphere())
+	{
+		const Chaos::FSphere Sphere(Chaos::FVec3(0.0), Shape.GetSphereRadius());
+		bHit = Chaos::SweepQuery(*Geometry, ParticleTransform, Sphere, ShapeTransform, Direction, Length, Time, Position, Normal, FaceIndex, FaceNormal, 0.0, true);
+	}
+	else if (Shape.IsCapsule())
+	{
+		const Chaos::FReal HalfLength = Shape.GetCapsuleAxisHalfLength();
+		const Chaos::FCapsule Capsule(Chaos::FVec3(0.0, 0.0, -HalfLength), Chaos::FVec3(0.0, 0.0, HalfLength), Shape.GetCapsuleRadius());
+		bHit = Chaos::SweepQuery(*Geometry, ParticleTransform, Capsule, ShapeTransform, Direction, Length, Time, Position, Normal, FaceIndex, FaceNormal, 0.0, true);
+	}
+	else if (Shape.IsBox())
+	{
+		const Chaos::FVec3 Extent = Shape.GetExtent();
+		const Chaos::TBox<Chaos::FReal, 3> Box(-Extent, Extent);
+		bHit = Chaos::SweepQuery(*Geometry, ParticleTransform, Box, ShapeTransform, Direction, Length, Time, Position, Normal, FaceIndex, FaceNormal, 0.0, true);
+	}
+
+	if (!bHit)
+	{
+		return false;
+	}
+
+	OutHit.Init(Start, End);
+	OutHit.bBlockingHit = true;
+	OutHit.FaceIndex = FaceIndex;
+	OutHit.Normal = Normal;
+	OutHit.ImpactNormal = (FaceNormal.IsNearlyZero()) ? FVector(Normal) : FVector(FaceNormal);
+	OutHit.ImpactPoint = Position;
+
+	// Overlaps at the start are reported with a negative time of impact holding the penetration depth along the minimum translation direction.
+	if (Time <= 0.0)
+	{
+		OutHit.bStartPenetrating = true;
+		OutHit.PenetrationDepth = static_cast<float>(-Time);
+		OutHit.Time = 0.0f;
+		OutHit.Distance = 0.0f;
+		OutHit.Location = Start;
+		return true;
+	}
+
+	OutHit.Time = static_cast<float>(Time / Length);
+	OutHit.Distance = static_cast<float>(Time);
+	OutHit.Location = Start + (Direction * Time);
+	return true;
+}
+
+bool UCollisionLibrary::LineTraceAgainstParticle_Internal(FHitResult& OutHit,
+	const FVector& Start,
+	const FVector& End,
+	FPhysicsActorHandle Particle)
+{
+	Chaos::FRigidBodyHandle_Internal* Handle = (Particle != nullptr) ? Particle->GetPhysicsThreadAPI() : nullptr;
+	const Chaos::FImplicitObject* Geometry = (Handle != nullptr) ? Handle->Geometry().Get() : nullptr;
+	const FVector Delta = End - Start;
+	const double Length = Delta.Size();
+	if ((Geometry == nullptr) || (Length <= UE_KINDA_SMALL_NUMBER))
+	{
+		return false;
+	}
+
+	// Geometry is in the particle's local space.
+	const Chaos::FRigidTransform3 ParticleTransform(Handle->X(), Handle->R());
+	const FVector Direction = Delta / Length;
+	Chaos::FReal Time = 0.0;
+	Chaos::FVec3 Position(0.0);
+	Chaos::FVec3 Normal(0.0);
+	int32 FaceIndex = INDEX_NONE;
+	if (!Geometry->Raycast(ParticleTransform.InverseTransformPositionNoScale(Start), ParticleTransform.InverseTransformVectorNoScale(Direction), Length, 0.0,
+		Time, Position, Normal, FaceIndex))
+	{
+		return false;
+	}
+
+	OutHit.Init(Start, End);
+	OutHit.bBlockingHit = true;
+	OutHit.bStartPenetrating = (Time <= 0.0);
+	OutHit.FaceIndex = FaceIndex;
+	OutHit.Time = static_cast<float>(FMath::Max(Time, 0.0) / Length);
+	OutHit.Distance = static_cast<float>(FMath::Max(Time, 0.0));
+	OutHit.Location = Start + (Direction * FMath::Max(Time, 0.0));
+	OutHit.ImpactPoint = ParticleTransform.TransformPositionNoScale(Position);
+	OutHit.Normal = ParticleTransform.TransformVectorNoScale(Normal);
+	OutHit.ImpactNormal = OutHit.Normal;
+	return true;
+}
+
+bool UCollisionLibrary::ComputePenetrationAgainstParticle_Internal(FVector& OutDirection,
+	double& OutDepth,
+	const FVector& Location,
+	const FQuat& ShapeRotation,
+	const FCollisionShape& Shape,
+	FPhysicsActorHandle Particle)
+{
+	Chaos::FRigidBodyHandle_Internal* Handle = (Particle != nullptr) ? Particle->GetPhysicsThreadAPI() : nullptr;
+	const Chaos::FImplicitObject* Geometry = (Handle != nullptr) ? Handle->Geometry().Get() : nullptr;
+	if (Geometry == nullptr)
+	{
+		return false;
+	}
+
+	const Chaos::FRigidTransform3 ParticleTransform(Handle->X(), Handle->R());
+	const Chaos::FRigidTransform3 ShapeTransform(Location, ShapeRotation);
+	Chaos::FMTDInfo MTDInfo;
+	bool bOverlap = false;
+
+	if (Shape.IsSphere())
+	{
+		const Chaos::FSphere Sphere(Chaos::FVec3(0.0), Shape.GetSphereRadius());
+		bOverlap = Chaos::OverlapQuery(*Geometry, ParticleTransform, Sphere, ShapeTransform, 0.0, &MTDInfo);
+	}
+	else if (Shape.IsCapsule())
+	{
+		const Chaos::FReal HalfLength = Shape.GetCapsuleAxisHalfLength();
+		const Chaos::FCapsule Capsule(Chaos::FVec3(0.0, 0.0, -HalfLength), Chaos::FVec3(0.0, 0.0, HalfLength), Shape.GetCapsuleRadius());
+		bOverlap = Chaos::OverlapQuery(*Geometry, ParticleTransform, Capsule, ShapeTransform, 0.0, &MTDInfo);
+	}
+	else if (Shape.IsBox())
+	{
+		const Chaos::FVec3 Extent = Shape.GetExtent();
+		const Chaos::TBox<Chaos::FReal, 3> Box(-Extent, Extent);
+		bOverlap = Chaos::OverlapQuery(*Geometry, ParticleTransform, Box, ShapeTransform, 0.0, &MTDInfo);
+	}
+
+	// Touching shapes overlap without any penetration to resolve.
+	if ((!bOverlap) || (MTDInfo.Penetration <= 0.0))
+	{
+		return false;
+	}
+
+	OutDirection = MTDInfo.Normal;
+	OutDepth = static_cast<double>(MTDInfo.Penetration);
+	return true;
+}
+
+bool UCollisionLibrary::GetParticleTransform_Internal(FTransform& OutTransform, FPhysicsActorHandle Particle)
+{
+	const Chaos::FRigidBodyHandle_Internal* Handle = (Particle != nullptr) ? Particle->GetPhysicsThreadAPI() : nullptr;
+	if (Handle == nullptr)
+	{
+		return false;
+	}
+
+	OutTransform = FTransform(Handle->R(), Handle->X());
+	return true;
+}
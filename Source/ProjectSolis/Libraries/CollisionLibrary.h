@@ -4,8 +4,41 @@
 
 #include "CoreMinimal.h"
 #include "ProjectSolisLibrary.h"
+#include "PhysicsInterfaceDeclaresCore.h"
 #include "CollisionLibrary.generated.h"
 
+class UPrimitiveComponent;
+
+enum class EKPCAnalyticShapeType : uint8
+{
+	None,
+	Plane,
+	Sphere,
+	Capsule,
+	Box
+};
+
+// Simple collision geometry that the analytic sweep kernels can test against without a physics scene query.
+struct FKPCAnalyticShape
+{
+	EKPCAnalyticShapeType Type = EKPCAnalyticShapeType::None;
+	// World space center of the shape, or a point on the plane.
+	FVector Center = FVector::ZeroVector;
+	// World space rotation. The capsule axis and the plane normal are the rotation's up vector.
+	FQuat Rotation = FQuat::Identity;
+	// Half extents of a box. X is the radius of a sphere or capsule and Z is the half length of a capsule's axis, excluding its hemispheres.
+	FVector Extent = FVector::ZeroVector;
+};
+
+// The outcome of an analytic sweep. A sweep is unresolved when the time of impact could not be found within the iteration budget, which only happens when
+// grazing a shape, or when the shape is not supported. Unresolved sweeps must be repeated with a physics sweep.
+enum class EKPCAnalyticSweepResult : uint8
+{
+	Miss,
+	Hit,
+	Unresolved
+};
+
 /**
  * 
  */
@@ -31,6 +64,13 @@ public:
 
 	static FVector GetLowestPointOnShape_Box(const FVector& Location, const FQuat& Rotation, const FVector& Extent);
 
+	// Batched version of GetLowestPointOnShape for many locations of the same shape and rotation. OutPoints must be at least as long as ShapeLocations.
+	static void GetLowestPointOnShapeBatch(const FCollisionShape& Shape,
+		TConstArrayView<FVector> ShapeLocations,
+		const FQuat& ShapeRotation,
+		const FVector& ShapeUp,
+		TArrayView<FVector> OutPoints);
+
 	static double GetShapeHalfHeight(const FVector& ShapeLocation, const FVector& ShapeLowestPoint);
 
 	static void DrawDebugShape(UWorld* const InWorld,
@@ -62,4 +102,92 @@ public:
 		const FCollisionQueryParams& CollisionQueryParams,
 		const bool DrawDebug = false,
 		const float DebugDuration = 0.0f);
+
+	// Builds an analytic shape from a primitive's simple collision. Returns false unless the primitive's simple collision is a single sphere, capsule or box
+	// that its scale keeps the same shape, or if the primitive uses complex collision as simple.
+	static bool MakeAnalyticShape(UPrimitiveComponent* const Primitive, FKPCAnalyticShape& OutShape);
+
+	// Analytic capsule sweeps. A sphere is a capsule with a zero half length. The hit is filled in the same way as a physics sweep against the shape, with
+	// bStartPenetrating, Normal and PenetrationDepth set when the capsule overlaps the shape at Start. The sphere, capsule and box sweeps return true on a
+	// blocking hit and false on a miss or an unresolved sweep, so use SweepCapsuleAgainstShape where the two must be told apart.
+	static EKPCAnalyticSweepResult SweepCapsuleAgainstShape(FHitResult& OutHit,
+		const FVector& Start,
+		const FVector& End,
+		const FQuat& CapsuleRotation,
+		const float CapsuleRadius,
+		const float CapsuleHalfLength,
+		const FKPCAnalyticShape& Shape);
+
+	static bool SweepCapsuleAgainstPlane(FHitResult& OutHit,
+		const FVector& Start,
+		const FVector& End,
+		const FQuat& CapsuleRotation,
+		const float CapsuleRadius,
+		const float CapsuleHalfLength,
+		const FVector& PlanePoint,
+		const FVector& PlaneNormal);
+
+	static bool SweepCapsuleAgainstSphere(FHitResult& OutHit,
+		const FVector& Start,
+		const FVector& End,
+		const FQuat& CapsuleRotation,
+		const float CapsuleRadius,
+		const float CapsuleHalfLength,
+		const FVector& SphereCenter,
+		const float SphereRadius);
+
+	static bool SweepCapsuleAgainstCapsule(FHitResult& OutHit,
+		const FVector& Start,
+		const FVector& End,
+		const FQuat& CapsuleRotation,
+		const float CapsuleRadius,
+		const float CapsuleHalfLength,
+		const FVector& OtherCenter,
+		const FQuat& OtherRotation,
+		const float OtherRadius,
+		const float OtherHalfLength);
+
+	static bool SweepCapsuleAgainstBox(FHitResult& OutHit,
+		const FVector& Start,
+		const FVector& End,
+		const FQuat& CapsuleRotation,
+		const float CapsuleRadius,
+		const float CapsuleHalfLength,
+		const FVector& BoxCenter,
+		const FQuat& BoxRotation,
+		const FVector& BoxExtent);
+
+	// Computes the minimum translation that separates the capsule from the shape. Returns false if they do not overlap.
+	static bool ComputeCapsulePenetration(FVector& OutDirection,
+		double& OutDepth,
+		const FVector& Location,
+		const FQuat& CapsuleRotation,
+		const float CapsuleRadius,
+		const float CapsuleHalfLength,
+		const FKPCAnalyticShape& Shape);
+
+	// Physics thread queries against a single body's particle, using the particle's physics thread transform and geometry instead of the game thread scene.
+	// Must only be called on the physics thread. Hits are filled in the same way as a physics sweep, with bStartPenetrating, Normal and PenetrationDepth set
+	// when the shape overlaps the particle at Start. The hit's component is left for the caller to fill in. Return false if the particle has been removed.
+	static bool SweepShapeAgainstParticle_Internal(FHitResult& OutHit,
+		const FVector& Start,
+		const FVector& End,
+		const FQuat& ShapeRotation,
+		const FCollisionShape& Shape,
+		FPhysicsActorHandle Particle);
+
+	static bool LineTraceAgainstParticle_Internal(FHitResult& OutHit,
+		const FVector& Start,
+		const FVector& End,
+		FPhysicsActorHandle Particle);
+
+	// Computes the minimum translation that moves the shape out of the particle. Returns false if they do not overlap or the particle has been removed.
+	static bool ComputePenetrationAgainstParticle_Internal(FVector& OutDirection,
+		double& OutDepth,
+		const FVector& Location,
+		const FQuat& ShapeRotation,
+		const FCollisionShape& Shape,
+		FPhysicsActorHandle Particle);
+
+	static bool GetParticleTransform_Internal(FTransform& OutTransform, FPhysicsActorHandle Particle);
 };
@@ -45,6 +45,54 @@ double UMathUtilityLibrary::NumericalDistance(const double A, const double B)
 
 FVector UMathUtilityLibrary::MatchVectorToSlope(const FVector& Up, const FVector& Vector, const FVector& Normal)
 {
-	const FVector Right = FVector::CrossProduct(Up, Vector.GetSafeNormal()).GetSafeNormal();
-	return FVector::CrossProduct(Right, Normal).GetSafeNormal() * Vector.Length();
+	// Only the direction of the intermediate right vector matters, so scale the result once instead of normalizing each step.
+	const FVector Slope = FVector::CrossProduct(FVector::CrossProduct(Up, Vector), Normal);
+	const double SlopeSizeSquared = Slope.SizeSquared();
+	return (SlopeSizeSquared > UE_SMALL_NUMBER) ? (Slope * FMath::Sqrt(Vector.SizeSquared() / SlopeSizeSquared)) : FVector::ZeroVector;
+}
+
+double UMathUtilityLibrary::WalkableFloorZFromAngle(const float MaxWalkableSlopeAngle)
+{
+	return FMath::Cos(FMath::DegreesToRadians(static_cast<double>(MaxWalkableSlopeAngle)));
+}
+
+void UMathUtilityLibrary::IsWalkableBatch(TConstArrayView<FVector> Normals, const double WalkableFloorZ, TArrayView<bool> OutWalkable)
+{
+	check(OutWalkable.Num() >= Normals.Num());
+
+	// Compare the Z components of four normals at a time.
+	const VectorRegister Threshold = MakeVectorRegisterDouble(WalkableFloorZ, WalkableFloorZ, WalkableFloorZ, WalkableFloorZ);
+	const int32 NumVectorized = Normals.Num() & ~3;
+	for (int32 i = 0; i < NumVectorized; i += 4)
+	{
+		const VectorRegister NormalZ = MakeVectorRegisterDouble(Normals[i].Z, Normals[i + 1].Z, Normals[i + 2].Z, Normals[i + 3].Z);
+		const int32 Mask = VectorMaskBits(VectorCompareGE(NormalZ, Threshold));
+		OutWalkable[i] = ((Mask & 1) != 0);
+		OutWalkable[i + 1] = ((Mask & 2) != 0);
+		OutWalkable[i + 2] = ((Mask & 4) != 0);
+		OutWalkable[i + 3] = ((Mask & 8) != 0);
+	}
+
+	for (int32 i = NumVectorized; i < Normals.Num(); ++i)
+	{
+		OutWalkable[i] = IsWalkable(Normals[i], WalkableFloorZ);
+	}
+}
+
+void UMathUtilityLibrary::MatchVectorToSlopeBatch(const FVector& Up, TConstArrayView<FVector> Vectors, TConstArrayView<FVector> Normals, TArrayView<FVector> OutVectors)
+{
+	check(Normals.Num() == Vectors.Num());
+	check(OutVectors.Num() >= Vectors.Num());
+
+	const VectorRegister UpVector = VectorLoadFloat3_W0(&Up.X);
+	const VectorRegister Epsilon = MakeVectorRegisterDouble(UE_SMALL_NUMBER, UE_SMALL_NUMBER, UE_SMALL_NUMBER, UE_SMALL_NUMBER);
+	const VectorRegister Zero = MakeVectorRegisterDouble(0.0, 0.0, 0.0, 0.0);
+	for (int32 i = 0; i < Vectors.Num(); ++i)
+	{
+		const VectorRegister Vector = VectorLoadFloat3_W0(&Vectors[i].X);
+		const VectorRegister Slope = VectorCross(VectorCross(UpVector, Vector), VectorLoadFloat3_W0(&Normals[i].X));
+		const VectorRegister SlopeSizeSquared = VectorDot3(Slope, Slope);
+		const VectorRegister Scale = VectorSqrt(VectorDivide(VectorDot3(Vector, Vector), VectorMax(SlopeSizeSquared, Epsilon)));
+		VectorStoreFloat3(VectorSelect(VectorCompareGT(SlopeSizeSquared, Epsilon), VectorMultiply(Slope, Scale), Zero), &OutVectors[i].X);
+	}
 }
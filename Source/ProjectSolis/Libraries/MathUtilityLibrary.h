@@ -35,4 +35,15 @@ public:
 
 	// Returns the input vector rotated to match the slope plane with input normal. Returned vector retains the original length.
 	static FVector MatchVectorToSlope(const FVector& Up, const FVector& Vector, const FVector& Normal);
+
+	// Returns the minimum Z component of the normal of a walkable surface, the cosine of the maximum walkable slope angle. Precompute it when the angle changes
+	// and test surfaces with IsWalkable instead of comparing angles.
+	static double WalkableFloorZFromAngle(const float MaxWalkableSlopeAngle);
+
+	// Returns true if the surface with the normalized normal is walkable.
+	static bool IsWalkable(const FVector& Normal, const double WalkableFloorZ) { return (Normal.Z >= WalkableFloorZ); }
+
+	// Batched versions of IsWalkable and MatchVectorToSlope. Output views must be at least as long as the inputs.
+	static void IsWalkableBatch(TConstArrayView<FVector> Normals, const double WalkableFloorZ, TArrayView<bool> OutWalkable);
+	static void MatchVectorToSlopeBatch(const FVector& Up, TConstArrayView<FVector> Vectors, TConstArrayView<FVector> Normals, TArrayView<FVector> OutVectors);
 };
@@ -0,0 +1,17 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ProjectCommandlet.generated.h"
+
+/**
+ * 
+ */
+UCLASS(Abstract)
+class PROJECTSOLIS_API UProjectCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+	
+};
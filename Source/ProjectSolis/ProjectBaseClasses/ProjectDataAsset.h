@@ -0,0 +1,17 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ProjectDataAsset.generated.h"
+
+/**
+ * 
+ */
+UCLASS(Abstract)
+class PROJECTSOLIS_API UProjectDataAsset : public UDataAsset
+{
+	GENERATED_BODY()
+	
+};
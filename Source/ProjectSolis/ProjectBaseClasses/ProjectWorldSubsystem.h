@@ -0,0 +1,17 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectWorldSubsystem.generated.h"
+
+/**
+ * 
+ */
+UCLASS(Abstract)
+class PROJECTSOLIS_API UProjectWorldSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+	
+};
@@ -0,0 +1,148 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CameraCollisionSubsystem.h"
+#include "Engine/World.h"
+
+void FCameraCollisionProbeTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (IsValid(Subsystem))
+	{
+		Subsystem->IssueProbes();
+	}
+}
+
+FString FCameraCollisionProbeTickFunction::DiagnosticMessage()
+{
+	return TEXT("FCameraCollisionProbeTickFunction");
+}
+
+FName FCameraCollisionProbeTickFunction::DiagnosticContext(bool bDetailed)
+{
+	return FName(TEXT("CameraCollisionProbeTick"));
+}
+
+void UCameraCollisionSubsystem::RegisterCamera(const AActor* Camera)
+{
+	if (FindProbe(Camera) == nullptr)
+	{
+		FKPCCameraProbe& Probe = Probes.AddDefaulted_GetRef();
+		Probe.Camera = Camera;
+	}
+}
+
+void UCameraCollisionSubsystem::UnregisterCamera(const AActor* Camera)
+{
+	// A probe still in flight is dropped along with its result.
+	Probes.RemoveAllSwap([Camera](const FKPCCameraProbe& Probe) { return (Probe.Camera == Camera); }, false);
+}
+
+void UCameraCollisionSubsystem::RequestProbe(const AActor* Camera, const FVector& Start, const FVector& End, float Radius, ECollisionChannel Channel, const AActor* IgnoredActor)
+{
+	FKPCCameraProbe* Probe = FindProbe(Camera);
+	if (Probe == nullptr)
+	{
+		return;
+	}
+
+	Probe->bHasRequest = true;
+	Probe->Start = Start;
+	Probe->End = End;
+	Probe->Radius = Radius;
+	Probe->Channel = Channel;
+	Probe->IgnoredActor = IgnoredActor;
+}
+
+bool UCameraCollisionSubsystem::GetProbeResult(const AActor* Camera, float& OutFreeFraction)
+{
+	CollectProbeResults();
+
+	const FKPCCameraProbe* Probe = FindProbe(Camera);
+	if ((Probe == nullptr) || (!Probe->bHasResult))
+	{
+		return false;
+	}
+
+	OutFreeFraction = Probe->FreeFraction;
+	return true;
+}
+
+void UCameraCollisionSubsystem::IssueProbes()
+{
+	// Results of last frame's probes are lost once new probes are issued, so collect them first even if no camera asked for them.
+	CollectProbeResults();
+
+	UWorld* World = GetWorld();
+	for (FKPCCameraProbe& Probe : Probes)
+	{
+		if (!Probe.bHasRequest)
+		{
+			continue;
+		}
+
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(CameraCollisionProbe), false, Probe.Camera);
+		QueryParams.AddIgnoredActor(Probe.IgnoredActor.Get());
+		Probe.Handle = World->AsyncSweepByChannel(EAsyncTraceType::Single, Probe.Start, Probe.End, FQuat::Identity, Probe.Channel, FCollisionShape::MakeSphere(Probe.Radius), QueryParams);
+		Probe.bHasRequest = false;
+	}
+}
+
+FKPCCameraProbe* UCameraCollisionSubsystem::FindProbe(const AActor* Camera)
+{
+	return Probes.FindByPredicate([Camera](const FKPCCameraProbe& Probe) { return (Probe.Camera == Camera); });
+}
+
+void UCameraCollisionSubsystem::CollectProbeResults()
+{
+	if (CollectedFrame == GFrameCounter)
+	{
+		return;
+	}
+	CollectedFrame = GFrameCounter;
+
+	UWorld* World = GetWorld();
+	for (FKPCCameraProbe& Probe : Probes)
+	{
+		FTraceDatum Datum = {};
+		if ((!Probe.Handle.IsValid()) || (!World->QueryTraceData(Probe.Handle, Datum)))
+		{
+			continue;
+		}
+
+		const FHitResult* Hit = FHitResult::GetFirstBlockingHit(Datum.OutHits);
+		Probe.FreeFraction = (Hit != nullptr) ? Hit->Time : 1.0f;
+		Probe.bHasResult = true;
+		Probe.Handle = FTraceHandle();
+	}
+}
+
+bool UCameraCollisionSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return ((WorldType == EWorldType::Game) || (WorldType == EWorldType::PIE));
+}
+
+void UCameraCollisionSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Cameras request probes when they tick after the pawns they follow or when the camera managers build their views, both of which happen before this tick
+	// group, so every probe of the frame is issued together.
+	ProbeTickFunction.Subsystem = this;
+	ProbeTickFunction.bCanEverTick = true;
+	ProbeTickFunction.bStartWithTickEnabled = true;
+	ProbeTickFunction.TickGroup = ETickingGroup::TG_PostUpdateWork;
+	ProbeTickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+}
+
+void UCameraCollisionSubsystem::Deinitialize()
+{
+	if (ProbeTickFunction.IsTickFunctionRegistered())
+	{
+		ProbeTickFunction.UnRegisterTickFunction();
+	}
+	ProbeTickFunction.Subsystem = nullptr;
+
+	Probes.Reset();
+
+	Super::Deinitialize();
+}
@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Engine/EngineTypes.h"
+#include "WorldCollision.h"
+#include "../ProjectSolisWorldSubsystem.h"
+#include "CameraCollisionSubsystem.generated.h"
+
+class UCameraCollisionSubsystem;
+
+// Tick function that issues the collision probes requested by cameras this frame.
+USTRUCT()
+struct FCameraCollisionProbeTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UCameraCollisionSubsystem* Subsystem = nullptr;
+
+	// FTickFunction interface.
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	virtual FName DiagnosticContext(bool bDetailed) override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FCameraCollisionProbeTickFunction> : public TStructOpsTypeTraitsBase2<FCameraCollisionProbeTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+// Collision probe of a single camera from its pivot to its desired location.
+struct FKPCCameraProbe
+{
+	const AActor* Camera = nullptr;
+	// The probe requested this frame. Issued by the subsystem after every camera has ticked.
+	bool bHasRequest = false;
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+	float Radius = 0.0f;
+	ECollisionChannel Channel = ECollisionChannel::ECC_Camera;
+	TWeakObjectPtr<const AActor> IgnoredActor = nullptr;
+	// Handle of the probe issued last frame. Invalid once its result has been collected.
+	FTraceHandle Handle = {};
+	// Fraction of the last completed probe that is free of blocking geometry.
+	bool bHasResult = false;
+	float FreeFraction = 1.0f;
+};
+
+/**
+ * Batches the collision probes of every local camera into async sweeps. Cameras request a probe while they tick, the requests are issued together once every
+ * camera has ticked and the results are collected together the next frame, so cameras never wait on a scene query and always consume last frame's result.
+ */
+UCLASS()
+class PROJECTSOLIS_API UCameraCollisionSubsystem : public UProjectSolisWorldSubsystem
+{
+	GENERATED_BODY()
+
+private:
+	FCameraCollisionProbeTickFunction ProbeTickFunction = {};
+
+	TArray<FKPCCameraProbe> Probes = {};
+
+	// The frame results were last collected on. Async trace results are only kept for the frame after they were issued.
+	uint64 CollectedFrame = 0;
+
+public:
+	void RegisterCamera(const AActor* Camera);
+	void UnregisterCamera(const AActor* Camera);
+
+	// Requests a sphere sweep for the camera that is issued at the end of this frame. Replaces any previous request made by the camera this frame.
+	void RequestProbe(const AActor* Camera, const FVector& Start, const FVector& End, float Radius, ECollisionChannel Channel, const AActor* IgnoredActor);
+
+	// Gets the fraction of the camera's last completed probe that is free of blocking geometry. Returns false if the camera has no completed probe yet.
+	bool GetProbeResult(const AActor* Camera, float& OutFreeFraction);
+
+	// Issues every probe requested this frame.
+	void IssueProbes();
+
+private:
+	FKPCCameraProbe* FindProbe(const AActor* Camera);
+
+	// Collects the results of every probe issued last frame. Does nothing if results have already been collected this frame.
+	void CollectProbeResults();
+
+	// UWorldSubsystem interface.
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+};
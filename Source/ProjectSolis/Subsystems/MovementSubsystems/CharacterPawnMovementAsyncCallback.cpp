@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CharacterPawnMovementAsyncCallback.h"
+#include "../../ActorComponents/MovementComponents/KinematicPawnStats.h"
+
+void FCharacterPawnMovementAsyncCallback::RegisterComponent_External(UCharacterPawnMovementComponent* Component)
+{
+	FWriteScopeLock WriteLock(ComponentsLock);
+	Components.Add(Component);
+}
+
+void FCharacterPawnMovementAsyncCallback::UnregisterComponent_External(UCharacterPawnMovementComponent* Component)
+{
+	FWriteScopeLock WriteLock(ComponentsLock);
+	Components.Remove(Component);
+}
+
+FName FCharacterPawnMovementAsyncCallback::GetFNameForStatId() const
+{
+	const static FLazyName StaticName("FCharacterPawnMovementAsyncCallback");
+	return StaticName;
+}
+
+void FCharacterPawnMovementAsyncCallback::OnPreSimulate_Internal()
+{
+	KPC_SCOPE_CYCLE_COUNTER(STAT_KPCAsyncPhysicsTick, KinematicPawn_AsyncPhysicsTick);
+
+	// No input is written on frames without any registered components.
+	const FKPCAsyncMovementInput* Input = GetConsumerInput_Internal();
+	if (Input == nullptr)
+	{
+		return;
+	}
+
+	FKPCAsyncMovementOutput& Output = GetProducerOutputData_Internal();
+	Output.Entries.Reset(Input->Entries.Num());
+
+	// Hold the lock for the whole step so a component can not be unregistered and destroyed while it is being simulated.
+	FReadScopeLock ReadLock(ComponentsLock);
+
+	const float DeltaTime = static_cast<float>(GetDeltaTime_Internal());
+	for (const FKPCAsyncMovementInputEntry& Entry : Input->Entries)
+	{
+		if (Components.Contains(Entry.Component))
+		{
+			Entry.Component->SimulateAsyncPhysicsStep(Entry, DeltaTime, Output.Entries.AddDefaulted_GetRef());
+		}
+	}
+}
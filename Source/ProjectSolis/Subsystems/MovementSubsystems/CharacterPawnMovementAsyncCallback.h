@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chaos/SimCallbackInput.h"
+#include "Chaos/SimCallbackObject.h"
+#include "../../ActorComponents/MovementComponents/CharacterPawnMovementComponent.h"
+
+// A body near a component simulated on the physics thread, gathered on the game thread with the component's input. Physics thread queries read the body's
+// transform and geometry from its physics thread particle, so they see the state the solver moves kinematic platforms with and never the game thread scene.
+struct FKPCAsyncCollisionPrimitive
+{
+	// Only compared and written to hit results on the physics thread. Never dereferenced there.
+	UPrimitiveComponent* Component = nullptr;
+	// Made on the game thread so the physics thread can hand the primitive back to the game thread without touching the object.
+	TWeakObjectPtr<UPrimitiveComponent> ComponentHandle = nullptr;
+	AActor* Owner = nullptr;
+	int32 Item = INDEX_NONE;
+	FPhysicsActorHandle Particle = nullptr;
+	// Whether the primitive was movable when gathered and so can carry the pawn as a movement base.
+	bool bMovable = false;
+};
+
+// Movement input of a single component marshalled from the game thread to the physics thread.
+struct FKPCAsyncMovementInputEntry
+{
+	UCharacterPawnMovementComponent* Component = nullptr;
+	FVector InputDirection = FVector::ZeroVector;
+	float InputScale = 0.0f;
+	bool bIsAnimMontagePlaying = false;
+	// The updated component's collision shape. Depends on the component's scale, which the game thread may change while the physics thread simulates.
+	FCollisionShape CollisionShape = {};
+	// Every one-shot event the physics thread has not reported as applied yet, oldest first.
+	TArray<FKPCAsyncMovementEvents, TInlineAllocator<2>> Events = {};
+	// Every body the pawn can reach before the next input is sent and the area they were gathered from. Physics thread queries only test these bodies.
+	TArray<FKPCAsyncCollisionPrimitive, TInlineAllocator<16>> CollisionPrimitives = {};
+	FBox CollisionBounds = FBox(ForceInit);
+};
+
+// Result of a single physics step of a component marshalled from the physics thread back to the game thread.
+struct FKPCAsyncMovementOutputEntry
+{
+	UCharacterPawnMovementComponent* Component = nullptr;
+	FVector Location = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	FVector Velocity = FVector::ZeroVector;
+	bool bGrounded = false;
+	TWeakObjectPtr<UPrimitiveComponent> MovementBase = nullptr;
+	// The frame of the newest event applied by the physics thread.
+	int32 LastAppliedEventFrame = 0;
+};
+
+struct FKPCAsyncMovementInput : public Chaos::FSimCallbackInput
+{
+	TArray<FKPCAsyncMovementInputEntry> Entries = {};
+
+	void Reset()
+	{
+		Entries.Reset();
+	}
+};
+
+struct FKPCAsyncMovementOutput : public Chaos::FSimCallbackOutput
+{
+	TArray<FKPCAsyncMovementOutputEntry> Entries = {};
+
+	void Reset()
+	{
+		Entries.Reset();
+	}
+};
+
+/**
+ * Runs the walking simulation of every component using the async physics tick at the start of each physics step on the physics thread. Input is written by the
+ * character pawn movement subsystem before physics starts each frame and results are read back by the subsystem on the following frames.
+ */
+class FCharacterPawnMovementAsyncCallback : public Chaos::TSimCallbackObject<FKPCAsyncMovementInput, FKPCAsyncMovementOutput, Chaos::ESimCallbackOptions::Presimulate>
+{
+private:
+	// Components that may be simulated. Input already sent can outlive a component, so entries for components that are no longer registered are skipped. Written
+	// on the game thread and read on the physics thread under the lock.
+	TSet<UCharacterPawnMovementComponent*> Components = {};
+	FRWLock ComponentsLock;
+
+public:
+	void RegisterComponent_External(UCharacterPawnMovementComponent* Component);
+
+	// Blocks until any physics step simulating the component has finished. The component is never simulated again after this returns.
+	void UnregisterComponent_External(UCharacterPawnMovementComponent* Component);
+
+	// Game thread only.
+	bool IsComponentRegistered_External(UCharacterPawnMovementComponent* Component) const { return Components.Contains(Component); }
+
+private:
+	// Chaos::ISimCallbackObject interface.
+	virtual FName GetFNameForStatId() const override;
+	virtual void OnPreSimulate_Internal() override;
+};
@@ -0,0 +1,306 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CharacterPawnMovementSubsystem.h"
+#include "CharacterPawnMovementAsyncCallback.h"
+#include "../../ActorComponents/MovementComponents/CharacterPawnMovementComponent.h"
+#include "../../ActorComponents/MovementComponents/KinematicPawnStats.h"
+#include "Async/ParallelFor.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "PhysicsEngine/PhysicsSettings.h"
+#include "PBDRigidsSolver.h"
+
+void FCharacterPawnMovementBatchTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (IsValid(Subsystem))
+	{
+		Subsystem->TickBatch(DeltaTime);
+	}
+}
+
+FString FCharacterPawnMovementBatchTickFunction::DiagnosticMessage()
+{
+	return TEXT("FCharacterPawnMovementBatchTickFunction");
+}
+
+FName FCharacterPawnMovementBatchTickFunction::DiagnosticContext(bool bDetailed)
+{
+	return FName(TEXT("CharacterPawnMovementBatchTick"));
+}
+
+void FCharacterPawnMovementAsyncTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (IsValid(Subsystem))
+	{
+		Subsystem->TickAsync(DeltaTime);
+	}
+}
+
+FString FCharacterPawnMovementAsyncTickFunction::DiagnosticMessage()
+{
+	return TEXT("FCharacterPawnMovementAsyncTickFunction");
+}
+
+FName FCharacterPawnMovementAsyncTickFunction::DiagnosticContext(bool bDetailed)
+{
+	return FName(TEXT("CharacterPawnMovementAsyncTick"));
+}
+
+void UCharacterPawnMovementSubsystem::RegisterComponent(UCharacterPawnMovementComponent* Component)
+{
+	check(IsValid(Component));
+	if (Components.Contains(Component))
+	{
+		return;
+	}
+
+	Components.Add(Component);
+	HotStates.Add(*Component->HotState);
+	BindHotStates();
+
+	BatchTickFunction.SetTickFunctionEnable(true);
+}
+
+void UCharacterPawnMovementSubsystem::UnregisterComponent(UCharacterPawnMovementComponent* Component)
+{
+	const int32 Index = Components.IndexOfByKey(Component);
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	// Hand the hot state back to the component before its slot is reused.
+	Component->OwnHotState = HotStates[Index];
+	Component->HotState = &Component->OwnHotState;
+
+	Components.RemoveAtSwap(Index, 1, false);
+	HotStates.RemoveAtSwap(Index, 1, false);
+	BindHotStates();
+
+	if (Components.IsEmpty())
+	{
+		BatchTickFunction.SetTickFunctionEnable(false);
+	}
+}
+
+void UCharacterPawnMovementSubsystem::BindHotStates()
+{
+	for (int32 i = 0; i < Components.Num(); ++i)
+	{
+		Components[i]->HotState = &HotStates[i];
+	}
+}
+
+void UCharacterPawnMovementSubsystem::TickBatch(float DeltaTime)
+{
+	KPC_SCOPE_CYCLE_COUNTER(STAT_KPCBatchTick, KinematicPawn_BatchTick);
+	CSV_SCOPED_TIMING_STAT(KinematicPawn, BatchTick);
+
+	// Consuming root motion touches the root motion mesh so must happen on the game thread.
+	int32 MaxSubsteps = 0;
+	for (UCharacterPawnMovementComponent* Component : Components)
+	{
+		MaxSubsteps = FMath::Max(MaxSubsteps, Component->BeginMovementFrame(DeltaTime));
+	}
+
+	// Components using a fixed timestep may run a different number of substeps this frame. Step every component that still has a substep to run together.
+	for (int32 SubstepIndex = 0; SubstepIndex < MaxSubsteps; ++SubstepIndex)
+	{
+		SubstepComponents.Reset();
+		for (UCharacterPawnMovementComponent* Component : Components)
+		{
+			if (Component->NumSubstepsThisFrame > SubstepIndex)
+			{
+				SubstepComponents.Add(Component);
+			}
+		}
+
+		if ((bParallelMovementTick) && (SubstepComponents.Num() >= MinComponentsForParallelMovementTick))
+		{
+			TickComponentsParallel(SubstepIndex);
+		}
+		else
+		{
+			TickComponentsSerial(SubstepIndex);
+		}
+	}
+
+	for (UCharacterPawnMovementComponent* Component : Components)
+	{
+		Component->EndMovementFrame();
+	}
+}
+
+void UCharacterPawnMovementSubsystem::RegisterAsyncComponent(UCharacterPawnMovementComponent* Component)
+{
+	check(IsValid(Component));
+	check(AsyncCallback != nullptr);
+	if (AsyncComponents.Contains(Component))
+	{
+		return;
+	}
+
+	Component->BeginAsyncPhysicsTick();
+	AsyncComponents.Add(Component);
+	AsyncCallback->RegisterComponent_External(Component);
+
+	AsyncTickFunction.SetTickFunctionEnable(true);
+}
+
+void UCharacterPawnMovementSubsystem::UnregisterAsyncComponent(UCharacterPawnMovementComponent* Component)
+{
+	const int32 Index = AsyncComponents.IndexOfByKey(Component);
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	AsyncComponents.RemoveAtSwap(Index, 1, false);
+	AsyncCallback->UnregisterComponent_External(Component);
+
+	if (AsyncComponents.IsEmpty())
+	{
+		AsyncTickFunction.SetTickFunctionEnable(false);
+	}
+}
+
+void UCharacterPawnMovementSubsystem::TickAsync(float DeltaTime)
+{
+	KPC_SCOPE_CYCLE_COUNTER(STAT_KPCAsyncMarshalling, KinematicPawn_AsyncMarshalling);
+
+	// Apply every result produced since the last frame in the order the physics steps ran. Results of components unregistered since are dropped.
+	while (Chaos::TSimCallbackOutputHandle<FKPCAsyncMovementOutput> Output = AsyncCallback->PopOutputData_External())
+	{
+		for (const FKPCAsyncMovementOutputEntry& Entry : Output->Entries)
+		{
+			if (AsyncCallback->IsComponentRegistered_External(Entry.Component))
+			{
+				Entry.Component->ApplyAsyncPhysicsOutput(Entry, static_cast<double>(Output->InternalTime));
+			}
+		}
+	}
+
+	const double ResultsTime = static_cast<double>(GetWorld()->GetPhysicsScene()->GetSolver()->GetPhysicsResultsTime_External());
+	for (UCharacterPawnMovementComponent* Component : AsyncComponents)
+	{
+		Component->UpdateInterpolatedTransformAsync(ResultsTime);
+	}
+
+	// Send this frame's input. It is marshalled to the physics thread when physics starts this frame.
+	FKPCAsyncMovementInput* Input = AsyncCallback->GetProducerInputData_External();
+	Input->Entries.Reset(AsyncComponents.Num());
+	for (UCharacterPawnMovementComponent* Component : AsyncComponents)
+	{
+		Component->GatherAsyncPhysicsInput(Input->Entries.AddDefaulted_GetRef());
+	}
+}
+
+void UCharacterPawnMovementSubsystem::TickComponentsSerial(int32 SubstepIndex)
+{
+	// Run each phase of the movement substep for every component before moving on to the next phase.
+	for (UCharacterPawnMovementComponent* Component : SubstepComponents)
+	{
+		Component->BeginMovementSubstep(SubstepIndex);
+	}
+
+	for (UCharacterPawnMovementComponent* Component : SubstepComponents)
+	{
+		Component->UpdatePawnRotation(Component->GetSubstepDeltaTime());
+	}
+
+	for (UCharacterPawnMovementComponent* Component : SubstepComponents)
+	{
+		Component->ResolveInitialPenetration();
+	}
+
+	for (UCharacterPawnMovementComponent* Component : SubstepComponents)
+	{
+		Component->TickMovementMode(Component->GetSubstepDeltaTime());
+	}
+}
+
+void UCharacterPawnMovementSubsystem::TickComponentsParallel(int32 SubstepIndex)
+{
+	// The simulation only reads the scene through scene queries and only writes to the component's own state and working transform. Components see each other at
+	// their transforms from the previous frame.
+	ParallelFor(SubstepComponents.Num(), [this, SubstepIndex](int32 Index)
+		{
+			UCharacterPawnMovementComponent* Component = SubstepComponents[Index];
+			Component->BeginMovementSubstep(SubstepIndex);
+			Component->UpdatePawnRotation(Component->GetSubstepDeltaTime());
+			Component->ResolveInitialPenetration();
+			Component->TickMovementMode(Component->GetSubstepDeltaTime());
+		});
+
+	// Working transforms are committed serially on the game thread by EndMovementFrame().
+}
+
+bool UCharacterPawnMovementSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return ((WorldType == EWorldType::Game) || (WorldType == EWorldType::PIE));
+}
+
+void UCharacterPawnMovementSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Tick in the same group as the per component tick. Owning controllers tick in an earlier group so their input is always added before the batch tick.
+	BatchTickFunction.Subsystem = this;
+	BatchTickFunction.bCanEverTick = true;
+	BatchTickFunction.bStartWithTickEnabled = !Components.IsEmpty();
+	BatchTickFunction.TickGroup = ETickingGroup::TG_PostPhysics;
+	BatchTickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+
+	// Create the physics thread callback if the project ticks physics asynchronously. Input must be written before physics starts each frame.
+	if (UPhysicsSettings::Get()->bTickPhysicsAsync)
+	{
+		if (FPhysScene* PhysScene = InWorld.GetPhysicsScene())
+		{
+			AsyncCallback = PhysScene->GetSolver()->CreateAndRegisterSimCallbackObject_External<FCharacterPawnMovementAsyncCallback>();
+		}
+	}
+
+	AsyncTickFunction.Subsystem = this;
+	AsyncTickFunction.bCanEverTick = true;
+	AsyncTickFunction.bStartWithTickEnabled = false;
+	AsyncTickFunction.TickGroup = ETickingGroup::TG_PrePhysics;
+	AsyncTickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+}
+
+void UCharacterPawnMovementSubsystem::Deinitialize()
+{
+	if (BatchTickFunction.IsTickFunctionRegistered())
+	{
+		BatchTickFunction.UnRegisterTickFunction();
+	}
+	BatchTickFunction.Subsystem = nullptr;
+
+	if (AsyncTickFunction.IsTickFunctionRegistered())
+	{
+		AsyncTickFunction.UnRegisterTickFunction();
+	}
+	AsyncTickFunction.Subsystem = nullptr;
+
+	// The solver frees the callback once the physics thread has stopped using it.
+	if (AsyncCallback != nullptr)
+	{
+		if (FPhysScene* PhysScene = GetWorld()->GetPhysicsScene())
+		{
+			PhysScene->GetSolver()->UnregisterAndFreeSimCallbackObject_External(AsyncCallback);
+		}
+		AsyncCallback = nullptr;
+	}
+
+	for (int32 i = 0; i < Components.Num(); ++i)
+	{
+		Components[i]->OwnHotState = HotStates[i];
+		Components[i]->HotState = &Components[i]->OwnHotState;
+	}
+
+	Components.Reset();
+	HotStates.Reset();
+	SubstepComponents.Reset();
+	AsyncComponents.Reset();
+
+	Super::Deinitialize();
+}
@@ -0,0 +1,147 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "../ProjectSolisWorldSubsystem.h"
+#include "../../ActorComponents/MovementComponents/CharacterPawnMovementComponent.h"
+#include "CharacterPawnMovementSubsystem.generated.h"
+
+class UCharacterPawnMovementSubsystem;
+class UCharacterPawnMovementComponent;
+class FCharacterPawnMovementAsyncCallback;
+
+// Tick function that ticks every character pawn movement component registered with the character pawn movement subsystem.
+USTRUCT()
+struct FCharacterPawnMovementBatchTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UCharacterPawnMovementSubsystem* Subsystem = nullptr;
+
+	// FTickFunction interface.
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	virtual FName DiagnosticContext(bool bDetailed) override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FCharacterPawnMovementBatchTickFunction> : public TStructOpsTypeTraitsBase2<FCharacterPawnMovementBatchTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+// Tick function that exchanges input and results with the physics thread for every component using the async physics tick.
+USTRUCT()
+struct FCharacterPawnMovementAsyncTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UCharacterPawnMovementSubsystem* Subsystem = nullptr;
+
+	// FTickFunction interface.
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	virtual FName DiagnosticContext(bool bDetailed) override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FCharacterPawnMovementAsyncTickFunction> : public TStructOpsTypeTraitsBase2<FCharacterPawnMovementAsyncTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+/**
+ * Owns every character pawn movement component that has opted into batched ticking and ticks them all from a single tick function. Each phase of the movement
+ * tick is run for every registered component before moving on to the next phase. Also owns the physics thread callback that simulates components using the async
+ * physics tick.
+ */
+UCLASS(Config = Game)
+class PROJECTSOLIS_API UCharacterPawnMovementSubsystem : public UProjectSolisWorldSubsystem
+{
+	GENERATED_BODY()
+
+private:
+	// If enabled the movement of every registered component is simulated in parallel on worker threads against the read-only scene. Transform changes are buffered
+	// per component and committed serially on the game thread once all components have finished simulating.
+	UPROPERTY(Config)
+	bool bParallelMovementTick = false;
+
+	// The minimum number of registered components required before the parallel movement tick is used.
+	UPROPERTY(Config)
+	int32 MinComponentsForParallelMovementTick = 16;
+
+	FCharacterPawnMovementBatchTickFunction BatchTickFunction = {};
+
+	// Registered components and their hot states packed contiguously. The same index refers to the same component in both arrays. Each component simulates with
+	// its slot in HotStates while registered, so the phases stride through one array instead of each component's own memory, and components simulated in
+	// parallel never share a cache line.
+	TArray<UCharacterPawnMovementComponent*> Components = {};
+	TArray<FKPCMovementHotState> HotStates = {};
+
+	// Components that still have a substep to run in the substep currently being ticked.
+	TArray<UCharacterPawnMovementComponent*> SubstepComponents = {};
+
+	// Async physics tick. The callback is only created when the project ticks physics asynchronously.
+	FCharacterPawnMovementAsyncTickFunction AsyncTickFunction = {};
+	FCharacterPawnMovementAsyncCallback* AsyncCallback = nullptr;
+	TArray<UCharacterPawnMovementComponent*> AsyncComponents = {};
+
+public:
+	// Adds the component to the batch tick. The component's own tick function should be disabled by the caller.
+	void RegisterComponent(UCharacterPawnMovementComponent* Component);
+
+	// Removes the component from the batch tick.
+	void UnregisterComponent(UCharacterPawnMovementComponent* Component);
+
+	// Returns the tick function that ticks registered components. Use this to add tick dependencies on batched movement.
+	FTickFunction& GetBatchTickFunction() { return BatchTickFunction; }
+
+	// Ticks every registered component.
+	void TickBatch(float DeltaTime);
+
+	// Overrides the configured bParallelMovementTick.
+	void SetParallelMovementTick(bool bEnabled) { bParallelMovementTick = bEnabled; }
+
+	// Returns true if components can hand their simulation over to the physics thread.
+	bool CanUseAsyncPhysicsTick() const { return (AsyncCallback != nullptr); }
+
+	// Hands the component's simulation over to the physics thread. The component's own tick function should be disabled by the caller.
+	void RegisterAsyncComponent(UCharacterPawnMovementComponent* Component);
+
+	// Stops simulating the component on the physics thread. Blocks until any physics step simulating the component has finished.
+	void UnregisterAsyncComponent(UCharacterPawnMovementComponent* Component);
+
+	// Returns the tick function that applies physics thread results and sends input for components using the async physics tick.
+	FTickFunction& GetAsyncTickFunction() { return AsyncTickFunction; }
+
+	// Applies results from the physics thread and sends this frame's input.
+	void TickAsync(float DeltaTime);
+
+	int32 GetNumAsyncComponents() const { return AsyncComponents.Num(); }
+
+	int32 GetNumComponents() const { return Components.Num(); }
+	const TArray<UCharacterPawnMovementComponent*>& GetComponents() const { return Components; }
+
+private:
+	// Points every registered component at its slot in HotStates. Call whenever HotStates is added to or removed from.
+	void BindHotStates();
+
+	// Runs the movement substep phases for every component in SubstepComponents on the game thread.
+	void TickComponentsSerial(int32 SubstepIndex);
+
+	// Runs the movement substep for every component in SubstepComponents on worker threads.
+	void TickComponentsParallel(int32 SubstepIndex);
+
+	// UWorldSubsystem interface.
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+};
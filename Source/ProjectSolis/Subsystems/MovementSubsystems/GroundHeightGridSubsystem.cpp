@@ -0,0 +1,295 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GroundHeightGridSubsystem.h"
+#include "../../ActorComponents/MovementComponents/KinematicPawnStats.h"
+#include "Components/PrimitiveComponent.h"
+#include "EngineUtils.h"
+#include "Engine/Level.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+
+void FGroundHeightGridStreamingTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (IsValid(Subsystem))
+	{
+		Subsystem->TickStreaming();
+	}
+}
+
+FString FGroundHeightGridStreamingTickFunction::DiagnosticMessage()
+{
+	return TEXT("FGroundHeightGridStreamingTickFunction");
+}
+
+FName FGroundHeightGridStreamingTickFunction::DiagnosticContext(bool bDetailed)
+{
+	return FName(TEXT("GroundHeightGridStreamingTick"));
+}
+
+bool UGroundHeightGridSubsystem::SampleGround(const FBox& QueryBounds, double& OutHeight, FVector& OutNormal) const
+{
+	// The grid only contains static geometry so anything movable near the query has to be found with a scene query. Query bounds are pawn sized so only cover a
+	// few cells.
+	const FIntPoint MinCell = GetDynamicCell(QueryBounds.Min.X, QueryBounds.Min.Y);
+	const FIntPoint MaxCell = GetDynamicCell(QueryBounds.Max.X, QueryBounds.Max.Y);
+	for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+	{
+		for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+		{
+			if (DynamicCells.Contains(FIntPoint(CellX, CellY)))
+			{
+				return false;
+			}
+		}
+	}
+
+	const FVector Center = QueryBounds.GetCenter();
+	return Grid.SampleGround(Center.X, Center.Y, OutHeight, OutNormal);
+}
+
+void UGroundHeightGridSubsystem::MapTilesInRadius(const FVector& Location, float Radius)
+{
+	if (!Grid.IsOpen())
+	{
+		return;
+	}
+
+	const FIntPoint Min = Grid.GetTileCoordinates(Location.X - static_cast<double>(Radius), Location.Y - static_cast<double>(Radius));
+	const FIntPoint Max = Grid.GetTileCoordinates(Location.X + static_cast<double>(Radius), Location.Y + static_cast<double>(Radius));
+	for (int32 TileY = Min.Y; TileY <= Max.Y; ++TileY)
+	{
+		for (int32 TileX = Min.X; TileX <= Max.X; ++TileX)
+		{
+			if (Grid.MapTile(TileX, TileY))
+			{
+				MappedTiles.Add(FIntPoint(TileX, TileY));
+			}
+		}
+	}
+}
+
+void UGroundHeightGridSubsystem::TickStreaming()
+{
+	KPC_SCOPE_CYCLE_COUNTER(STAT_KPCGroundGridStreaming, KinematicPawn_GroundGridStreaming);
+
+	UWorld* World = GetWorld();
+
+	// Player views are the default world partition streaming sources.
+	TArray<FVector, TInlineAllocator<4>> ViewLocations = {};
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if ((IsValid(PlayerController)) && (PlayerController->IsLocalController()))
+		{
+			FVector ViewLocation = FVector::ZeroVector;
+			FRotator ViewRotation = FRotator::ZeroRotator;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			ViewLocations.Add(ViewLocation);
+		}
+	}
+
+	// Unmap tiles that are out of range of every view.
+	const double UnloadingRangeSquared = FMath::Square(static_cast<double>(TileLoadingRange + TileUnloadingHysteresis));
+	for (int32 i = MappedTiles.Num() - 1; i >= 0; --i)
+	{
+		const FBox2D TileBounds = Grid.GetTileBounds(MappedTiles[i].X, MappedTiles[i].Y);
+		bool bInRange = false;
+		for (const FVector& ViewLocation : ViewLocations)
+		{
+			bInRange |= (TileBounds.ComputeSquaredDistanceToPoint(FVector2D(ViewLocation)) <= UnloadingRangeSquared);
+		}
+
+		if (!bInRange)
+		{
+			Grid.UnmapTile(MappedTiles[i].X, MappedTiles[i].Y);
+			MappedTiles.RemoveAtSwap(i, 1, false);
+		}
+	}
+
+	for (const FVector& ViewLocation : ViewLocations)
+	{
+		MapTilesInRadius(ViewLocation, TileLoadingRange);
+	}
+
+	UpdateDynamicCells();
+
+	SET_DWORD_STAT(STAT_KPCGroundGridMappedTiles, MappedTiles.Num());
+}
+
+void UGroundHeightGridSubsystem::UpdateDynamicCells()
+{
+	// There is no notification of a primitive's mobility changing, so check a few of the primitives that were not movable when found each tick.
+	const int32 NumChecks = FMath::Min(MobilityChecksPerTick, NonMovablePrimitives.Num());
+	for (int32 i = 0; i < NumChecks; ++i)
+	{
+		if (NextMobilityCheck >= NonMovablePrimitives.Num())
+		{
+			NextMobilityCheck = 0;
+		}
+
+		const UPrimitiveComponent* Primitive = NonMovablePrimitives[NextMobilityCheck].Get();
+		if ((Primitive == nullptr) || (Primitive->Mobility == EComponentMobility::Movable))
+		{
+			if (Primitive != nullptr)
+			{
+				DynamicPrimitives.Add(NonMovablePrimitives[NextMobilityCheck]);
+			}
+			NonMovablePrimitives.RemoveAtSwap(NextMobilityCheck, 1, false);
+		}
+		else
+		{
+			++NextMobilityCheck;
+		}
+	}
+
+	// Forget movable primitives that have been destroyed.
+	DynamicPrimitives.RemoveAllSwap([](const TWeakObjectPtr<UPrimitiveComponent>& DynamicPrimitive) { return !DynamicPrimitive.IsValid(); }, false);
+
+	DynamicCells.Reset();
+	for (const TWeakObjectPtr<UPrimitiveComponent>& DynamicPrimitive : DynamicPrimitives)
+	{
+		AddDynamicCells(*DynamicPrimitive.Get());
+	}
+}
+
+void UGroundHeightGridSubsystem::AddDynamicCells(const UPrimitiveComponent& Primitive)
+{
+	const FBox Bounds = Primitive.Bounds.GetBox().ExpandBy(static_cast<double>(DynamicPrimitiveMargin));
+	const FIntPoint MinCell = GetDynamicCell(Bounds.Min.X, Bounds.Min.Y);
+	const FIntPoint MaxCell = GetDynamicCell(Bounds.Max.X, Bounds.Max.Y);
+	for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+	{
+		for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+		{
+			DynamicCells.Add(FIntPoint(CellX, CellY));
+		}
+	}
+}
+
+FIntPoint UGroundHeightGridSubsystem::GetDynamicCell(double X, double Y) const
+{
+	return FIntPoint(FMath::FloorToInt32(X / static_cast<double>(DynamicCellSize)), FMath::FloorToInt32(Y / static_cast<double>(DynamicCellSize)));
+}
+
+void UGroundHeightGridSubsystem::AddDynamicPrimitives(AActor* Actor)
+{
+	// Pawns are not part of the ground.
+	if ((!IsValid(Actor)) || (Actor->IsA<APawn>()))
+	{
+		return;
+	}
+
+	Actor->ForEachComponent<UPrimitiveComponent>(false, [this](UPrimitiveComponent* Primitive)
+		{
+			if (!Primitive->IsQueryCollisionEnabled())
+			{
+				return;
+			}
+
+			if (Primitive->Mobility == EComponentMobility::Movable)
+			{
+				// Spawning happens on the game thread outside of the movement tick, so the primitive's cells can be added straight away.
+				DynamicPrimitives.Add(Primitive);
+				AddDynamicCells(*Primitive);
+			}
+			else
+			{
+				NonMovablePrimitives.Add(Primitive);
+			}
+		});
+}
+
+void UGroundHeightGridSubsystem::OnLevelAddedToWorld(ULevel* Level, UWorld* InWorld)
+{
+	if ((InWorld != GetWorld()) || (Level == nullptr))
+	{
+		return;
+	}
+
+	for (AActor* Actor : Level->Actors)
+	{
+		AddDynamicPrimitives(Actor);
+	}
+}
+
+void UGroundHeightGridSubsystem::OnLevelRemovedFromWorld(ULevel* Level, UWorld* InWorld)
+{
+	if (InWorld != GetWorld())
+	{
+		return;
+	}
+
+	// A null level means every level is being removed. The cells of removed movable primitives are dropped by the next streaming tick.
+	const auto IsInRemovedLevel = [Level](const TWeakObjectPtr<UPrimitiveComponent>& It)
+	{
+		const UPrimitiveComponent* Primitive = It.Get();
+		return ((Primitive == nullptr) || (Level == nullptr) || (Primitive->GetComponentLevel() == Level));
+	};
+	DynamicPrimitives.RemoveAllSwap(IsInRemovedLevel, false);
+	NonMovablePrimitives.RemoveAllSwap(IsInRemovedLevel, false);
+	NextMobilityCheck = 0;
+}
+
+bool UGroundHeightGridSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return ((WorldType == EWorldType::Game) || (WorldType == EWorldType::PIE));
+}
+
+void UGroundHeightGridSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Opening the grid only maps its header. Tiles are mapped as they come into range.
+	const FString MapPackageName = UWorld::RemovePIEPrefix(InWorld.GetOutermost()->GetName());
+	if (!Grid.Open(FKPCGroundHeightGrid::GetGridPathForMap(MapPackageName)))
+	{
+		return;
+	}
+
+	UE_LOG(LogKinematicPawn, Log, TEXT("Opened ground height grid for %s with %dx%d tiles."), *MapPackageName, Grid.GetNumTilesX(), Grid.GetNumTilesY());
+
+	for (TActorIterator<AActor> It(&InWorld); It; ++It)
+	{
+		AddDynamicPrimitives(*It);
+	}
+	ActorSpawnedHandle = InWorld.AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UGroundHeightGridSubsystem::AddDynamicPrimitives));
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UGroundHeightGridSubsystem::OnLevelAddedToWorld);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UGroundHeightGridSubsystem::OnLevelRemovedFromWorld);
+
+	// Tick functions run on the game thread and the parallel movement tick finishes within its own tick function, so tiles are never mapped or unmapped while
+	// movement is reading them. Pawns using the async physics tick simulate while tiles stream and so never use the grid.
+	StreamingTickFunction.Subsystem = this;
+	StreamingTickFunction.bCanEverTick = true;
+	StreamingTickFunction.bStartWithTickEnabled = true;
+	StreamingTickFunction.TickGroup = ETickingGroup::TG_PrePhysics;
+	StreamingTickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+}
+
+void UGroundHeightGridSubsystem::Deinitialize()
+{
+	if (StreamingTickFunction.IsTickFunctionRegistered())
+	{
+		StreamingTickFunction.UnRegisterTickFunction();
+	}
+	StreamingTickFunction.Subsystem = nullptr;
+
+	if (ActorSpawnedHandle.IsValid())
+	{
+		GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+		ActorSpawnedHandle.Reset();
+	}
+
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+	LevelAddedHandle.Reset();
+	LevelRemovedHandle.Reset();
+
+	DynamicPrimitives.Reset();
+	DynamicCells.Reset();
+	NonMovablePrimitives.Reset();
+	MappedTiles.Reset();
+	Grid.Close();
+
+	Super::Deinitialize();
+}
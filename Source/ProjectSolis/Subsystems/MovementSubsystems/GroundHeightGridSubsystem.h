@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "../ProjectSolisWorldSubsystem.h"
+#include "../../ActorComponents/MovementComponents/GroundHeightGrid.h"
+#include "GroundHeightGridSubsystem.generated.h"
+
+class UGroundHeightGridSubsystem;
+
+// Tick function that maps and unmaps ground height grid tiles around the world's streaming sources.
+USTRUCT()
+struct FGroundHeightGridStreamingTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UGroundHeightGridSubsystem* Subsystem = nullptr;
+
+	// FTickFunction interface.
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	virtual FName DiagnosticContext(bool bDetailed) override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FGroundHeightGridStreamingTickFunction> : public TStructOpsTypeTraitsBase2<FGroundHeightGridStreamingTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+/**
+ * Owns the baked ground height grid of the world's map and streams its tiles in and out around player views, in the same way world partition streams cells.
+ * Tiles are aligned to the world partition runtime grid when the grid is baked with the runtime grid's cell size. Also buckets movable primitives into coarse
+ * cells so grid lookups near geometry the grid can not represent fall back to scene queries.
+ */
+UCLASS(Config = Game)
+class PROJECTSOLIS_API UGroundHeightGridSubsystem : public UProjectSolisWorldSubsystem
+{
+	GENERATED_BODY()
+
+private:
+	// Tiles overlapping this distance (in cm) around a player's view are mapped. Match the loading range of the world partition runtime grid.
+	UPROPERTY(Config)
+	float TileLoadingRange = 25600.0f;
+
+	// Mapped tiles are kept until they are this much further (in cm) than the loading range from every view to avoid mapping the same tile repeatedly.
+	UPROPERTY(Config)
+	float TileUnloadingHysteresis = 2000.0f;
+
+	// The distance (in cm) around a movable primitive's bounds within which grid lookups fall back to scene queries.
+	UPROPERTY(Config)
+	float DynamicPrimitiveMargin = 100.0f;
+
+	// The size (in cm) of the cells movable primitives are bucketed into. Lookups in any cell a movable primitive overlaps fall back to scene queries.
+	UPROPERTY(Config)
+	float DynamicCellSize = 400.0f;
+
+	// The number of primitives that were not movable when found that are checked each tick for having been made movable since.
+	UPROPERTY(Config)
+	int32 MobilityChecksPerTick = 512;
+
+	FGroundHeightGridStreamingTickFunction StreamingTickFunction = {};
+
+	FKPCGroundHeightGrid Grid = {};
+	TArray<FIntPoint> MappedTiles = {};
+
+	// Movable primitives that can block movement and are not part of the grid. Pawns are not tracked.
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> DynamicPrimitives = {};
+	// The cells overlapped by the movable primitives' bounds expanded by the margin. Rebuilt on the game thread by every streaming tick so lookups never read
+	// primitive bounds.
+	TSet<FIntPoint> DynamicCells = {};
+	// Primitives that can block movement and were not movable when found, checked in turn for having been made movable.
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> NonMovablePrimitives = {};
+	int32 NextMobilityCheck = 0;
+	FDelegateHandle ActorSpawnedHandle = {};
+	FDelegateHandle LevelAddedHandle = {};
+	FDelegateHandle LevelRemovedHandle = {};
+
+public:
+	// Returns true if a grid was found for the world's map.
+	bool HasGrid() const { return Grid.IsOpen(); }
+
+	// Returns the collision channel the grid was baked on.
+	ECollisionChannel GetCollisionChannel() const { return Grid.GetCollisionChannel(); }
+
+	// Samples the ground under the query bounds. Returns false if the grid has no valid ground there or the query bounds are in a cell a movable primitive is near.
+	// Safe to call from movement running on worker threads.
+	bool SampleGround(const FBox& QueryBounds, double& OutHeight, FVector& OutNormal) const;
+
+	// Maps every tile overlapping the radius around the location. Used by tools that simulate movement without player views.
+	void MapTilesInRadius(const FVector& Location, float Radius);
+
+	int32 GetNumMappedTiles() const { return MappedTiles.Num(); }
+
+	// Updates mapped tiles around the player views.
+	void TickStreaming();
+
+private:
+	// Tracks the actor's primitives that can block movement, movable or not.
+	void AddDynamicPrimitives(AActor* Actor);
+
+	// Tracks the primitives of streamed levels, including world partition cells, which neither exist at begin play nor are spawned.
+	void OnLevelAddedToWorld(ULevel* Level, UWorld* InWorld);
+	void OnLevelRemovedFromWorld(ULevel* Level, UWorld* InWorld);
+
+	// Moves primitives that have been made movable since they were found to the movable primitives and rebuilds the cells they overlap.
+	void UpdateDynamicCells();
+
+	void AddDynamicCells(const UPrimitiveComponent& Primitive);
+	FIntPoint GetDynamicCell(double X, double Y) const;
+
+	// UWorldSubsystem interface.
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+};
@@ -0,0 +1,17 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "../ProjectBaseClasses/ProjectWorldSubsystem.h"
+#include "ProjectSolisWorldSubsystem.generated.h"
+
+/**
+ * 
+ */
+UCLASS(Abstract)
+class PROJECTSOLIS_API UProjectSolisWorldSubsystem : public UProjectWorldSubsystem
+{
+	GENERATED_BODY()
+	
+};